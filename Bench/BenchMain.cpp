@@ -0,0 +1,710 @@
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "Rasterizer.h"
+#include "BenchMath.h"
+#include "BenchScene.h"
+
+// Draws the workloads of the demo apps into in-memory targets, without a window
+class CBenchWorkload
+{
+public:
+    virtual ~CBenchWorkload() = default;
+
+    virtual const char* GetName() const = 0;
+
+    virtual bool Initialize( const std::string& resourcesDirectory ) = 0;
+
+    // Issues the draws of one frame and returns the number of triangles submitted
+    virtual uint64_t DrawFrame( uint32_t width, uint32_t height ) = 0;
+};
+
+class CBenchWorkload_HelloTriangle : public CBenchWorkload
+{
+public:
+    virtual const char* GetName() const override { return "hellotriangle"; }
+
+    virtual bool Initialize( const std::string& /*resourcesDirectory*/ ) override
+    {
+        m_Vertices[ 0 ] = { 0.5f, -0.5f, 0.f, 1.f, 0.f, 0.f, 1.f };
+        m_Vertices[ 1 ] = { 0.f, 0.5f, 0.f, 0.f, 1.f, 0.f, 1.f };
+        m_Vertices[ 2 ] = { -0.5f, -0.5f, 0.f, 0.f, 0.f, 1.f, 1.f };
+        return true;
+    }
+
+    virtual uint64_t DrawFrame( uint32_t /*width*/, uint32_t /*height*/ ) override
+    {
+        Rasterizer::SetPositionStream( Rasterizer::SStream( 0, sizeof( SVertex ), sizeof( m_Vertices ), (uint8_t*)m_Vertices ) );
+        Rasterizer::SetColorStream( Rasterizer::SStream( offsetof( SVertex, m_R ), sizeof( SVertex ), sizeof( m_Vertices ), (uint8_t*)m_Vertices ) );
+        Rasterizer::SetWorldViewTransform( BenchMath::Identity() );
+        Rasterizer::SetProjectionTransform( BenchMath::Identity() );
+        Rasterizer::SetMaterial( { { 1.f, 1.f, 1.f, 1.f }, { 1.f, 1.f, 1.f }, 32.f } );
+        Rasterizer::SetCullMode( Rasterizer::ECullMode::eCullCW );
+        Rasterizer::SetPipelineState( Rasterizer::SPipelineState( false, true ) );
+        Rasterizer::Draw( 0, 1 );
+        return 1;
+    }
+
+private:
+    struct SVertex
+    {
+        float m_X, m_Y, m_Z;
+        float m_R, m_G, m_B, m_A;
+    };
+
+    SVertex m_Vertices[ 3 ];
+};
+
+class CBenchWorkload_Cubes : public CBenchWorkload
+{
+public:
+    CBenchWorkload_Cubes( Rasterizer::ETextureFilter textureFilter, Rasterizer::ETextureLayout textureLayout, Rasterizer::ETextureFormat textureFormat )
+        : m_TextureFilter( textureFilter )
+        , m_TextureLayout( textureLayout )
+        , m_TextureFormat( textureFormat )
+    {
+    }
+
+    virtual ~CBenchWorkload_Cubes() override
+    {
+        FreeImage( &m_Texture );
+    }
+
+    virtual const char* GetName() const override { return "cubes"; }
+
+    virtual bool Initialize( const std::string& resourcesDirectory ) override
+    {
+        const SVertex vertices[ 24 ] =
+        {
+            // Front
+            { 1.f, -1.f, -1.f, 1.f, 1.f }, { -1.f, 1.f, -1.f, 0.f, 0.f }, { -1.f, -1.f, -1.f, 0.f, 1.f }, { 1.f, 1.f, -1.f, 1.f, 0.f },
+            // Left
+            { -1.f, -1.f, -1.f, 1.f, 1.f }, { -1.f, 1.f, 1.f, 0.f, 0.f }, { -1.f, -1.f, 1.f, 0.f, 1.f }, { -1.f, 1.f, -1.f, 1.f, 0.f },
+            // Right
+            { 1.f, -1.f, 1.f, 1.f, 1.f }, { 1.f, 1.f, -1.f, 0.f, 0.f }, { 1.f, -1.f, -1.f, 0.f, 1.f }, { 1.f, 1.f, 1.f, 1.f, 0.f },
+            // Back
+            { -1.f, -1.f, 1.f, 1.f, 1.f }, { 1.f, 1.f, 1.f, 0.f, 0.f }, { 1.f, -1.f, 1.f, 0.f, 1.f }, { -1.f, 1.f, 1.f, 1.f, 0.f },
+            // Top
+            { 1.f, 1.f, -1.f, 1.f, 1.f }, { -1.f, 1.f, 1.f, 0.f, 0.f }, { -1.f, 1.f, -1.f, 0.f, 1.f }, { 1.f, 1.f, 1.f, 1.f, 0.f },
+            // Bottom
+            { -1.f, -1.f, -1.f, 1.f, 1.f }, { 1.f, -1.f, 1.f, 0.f, 0.f }, { 1.f, -1.f, -1.f, 0.f, 1.f }, { -1.f, -1.f, 1.f, 1.f, 0.f },
+        };
+        memcpy( m_Vertices, vertices, sizeof( m_Vertices ) );
+
+        for ( uint16_t face = 0; face < 6; ++face )
+        {
+            const uint16_t base = face * 4;
+            const uint16_t indices[ 6 ] = { base, (uint16_t)( base + 1 ), (uint16_t)( base + 2 ), (uint16_t)( base + 1 ), base, (uint16_t)( base + 3 ) };
+            memcpy( m_Indices + face * 6, indices, sizeof( indices ) );
+        }
+
+        const std::string textureFilename = resourcesDirectory + "/BRICK_1A.PNG";
+        if ( !LoadImageFromFile( textureFilename, m_TextureLayout, m_TextureFormat, &m_Texture ) )
+        {
+            fprintf( stderr, "%s: %s can't be decoded, using a checker texture instead\n", GetName(), textureFilename.c_str() );
+            CreateCheckerImage( 256, 32, m_TextureLayout, m_TextureFormat, &m_Texture );
+        }
+        return true;
+    }
+
+    virtual uint64_t DrawFrame( uint32_t width, uint32_t height ) override
+    {
+        m_Yall += BenchMath::ConvertToRadians( 0.5f );
+        m_Roll += BenchMath::ConvertToRadians( 0.3f );
+
+        Rasterizer::SetPositionStream( Rasterizer::SStream( 0, sizeof( SVertex ), sizeof( m_Vertices ), (uint8_t*)m_Vertices ) );
+        Rasterizer::SetTexcoordStream( Rasterizer::SStream( offsetof( SVertex, m_TexU ), sizeof( SVertex ), sizeof( m_Vertices ), (uint8_t*)m_Vertices ) );
+        Rasterizer::SetIndexStream( Rasterizer::SStream( 0, 2, sizeof( m_Indices ), (uint8_t*)m_Indices ) );
+        Rasterizer::SetIndexType( Rasterizer::EIndexType::e16bit );
+
+        const Rasterizer::SVector4 diffuseColors[] = { { 1.f, 1.f, 1.0f, 1.0f }, { 0.8f, 0.4f, 0.0f, 1.0f }, { 0.8f, 0.2f, 0.5f, 1.0f }, { 0.3f, 0.5f, 0.28f, 1.0f } };
+        const Rasterizer::SMatrix rotationMatrix = BenchMath::RotationRollPitchYaw( 0.f, m_Yall, m_Roll );
+        const Rasterizer::SMatrix viewMatrix = BenchMath::Translation( 0.f, 0.f, 10.f );
+        Rasterizer::SetProjectionTransform( BenchMath::PerspectiveFovLH( 1.0f, (float)width / height, 2.f, 1000.f ) );
+
+        Rasterizer::SetTexture( m_Texture );
+        Rasterizer::SetPipelineState( Rasterizer::SPipelineState( true, false, false, false, Rasterizer::ELightingModel::eUnlit, Rasterizer::ELightType::eDirectional, m_TextureFilter ) );
+        Rasterizer::SetAlphaRef( 0x80 );
+        Rasterizer::SetCullMode( Rasterizer::ECullMode::eCullCW );
+
+        const int32_t cubeCount = 3;
+        const float cubeSpacing = 3.f;
+        const float cubeCenterMin = -( cubeCount - 1 ) * cubeSpacing * 0.5f;
+        for ( int32_t z = 0; z < cubeCount; ++z )
+        {
+            for ( int32_t y = 0; y < cubeCount; ++y )
+            {
+                for ( int32_t x = 0; x < cubeCount; ++x )
+                {
+                    const int32_t index = z * cubeCount * cubeCount + y * cubeCount + x;
+                    Rasterizer::SetMaterialDiffuse( diffuseColors[ index % 4 ] );
+                    const Rasterizer::SMatrix translationMatrix = BenchMath::Translation( cubeCenterMin + cubeSpacing * x, cubeCenterMin + cubeSpacing * y, cubeCenterMin + cubeSpacing * z );
+                    const Rasterizer::SMatrix worldMatrix = BenchMath::Multiply( translationMatrix, rotationMatrix );
+                    Rasterizer::SetWorldViewTransform( BenchMath::Multiply( worldMatrix, viewMatrix ) );
+                    Rasterizer::DrawIndexed( 0, 0, 12 );
+                }
+            }
+        }
+        return cubeCount * cubeCount * cubeCount * 12;
+    }
+
+private:
+    struct SVertex
+    {
+        float m_X, m_Y, m_Z;
+        float m_TexU, m_TexV;
+    };
+
+    SVertex m_Vertices[ 24 ];
+    uint16_t m_Indices[ 36 ];
+    Rasterizer::SImage m_Texture = {};
+    Rasterizer::ETextureFilter m_TextureFilter;
+    Rasterizer::ETextureLayout m_TextureLayout;
+    Rasterizer::ETextureFormat m_TextureFormat;
+    float m_Roll = 0.f, m_Yall = 0.f;
+};
+
+// Issues the draw on a context or records it into a command buffer, which have the same functions
+template <typename TTarget>
+static uint64_t DrawMesh( TTarget& target, const SBenchMeshDraw& draw, const Rasterizer::SMatrix& viewMatrix )
+{
+    target.SetPositionStream( draw.m_PositionStream );
+    target.SetNormalStream( draw.m_NormalStream );
+    target.SetColorStream( draw.m_ColorStream );
+    target.SetTexcoordStream( draw.m_TexcoordStream );
+    target.SetWorldViewTransform( BenchMath::Multiply( draw.m_WorldMatrix, viewMatrix ) );
+    if ( draw.m_IndexStream.m_Data )
+    {
+        target.SetIndexStream( draw.m_IndexStream );
+        target.SetIndexType( draw.m_IndexType );
+        target.DrawIndexed( 0, 0, draw.m_PrimitiveCount );
+    }
+    else
+    {
+        target.Draw( 0, draw.m_PrimitiveCount );
+    }
+    return draw.m_PrimitiveCount;
+}
+
+class CBenchWorkload_Lighting : public CBenchWorkload
+{
+public:
+    virtual const char* GetName() const override { return "lighting"; }
+
+    virtual bool Initialize( const std::string& resourcesDirectory ) override
+    {
+        const std::string modelFilename = resourcesDirectory + "/Teapot.glb";
+        if ( !m_Scene.LoadFromGLTFFile( modelFilename ) )
+        {
+            fprintf( stderr, "%s: %s can't be loaded, using a sphere instead\n", GetName(), modelFilename.c_str() );
+            m_Scene.CreateSpheres( 1, 128, false );
+        }
+        return true;
+    }
+
+    virtual uint64_t DrawFrame( uint32_t width, uint32_t height ) override
+    {
+        m_LightOrbitAngle += BenchMath::ConvertToRadians( 0.5f );
+
+        Rasterizer::SetProjectionTransform( BenchMath::PerspectiveFovLH( BenchMath::ConvertToRadians( 40.f ), (float)width / height, 2.f, 1000.f ) );
+        const Rasterizer::SMatrix viewMatrix = BenchMath::Translation( 0.f, 0.f, 9.f );
+
+        Rasterizer::SLight light;
+        light.m_Diffuse = Rasterizer::SVector3( 1.f, 1.f, 1.f );
+        light.m_Specular = Rasterizer::SVector3( 1.f, 1.f, 1.f );
+        light.m_Ambient = Rasterizer::SVector3( 0.05f, 0.06f, 0.05f );
+        const Rasterizer::SMatrix lightWorldViewMatrix = BenchMath::Multiply( BenchMath::RotationRollPitchYaw( 0.f, m_LightOrbitAngle, 0.f ), viewMatrix );
+        light.m_Position = BenchMath::Normalize( BenchMath::TransformNormal( Rasterizer::SVector3( -3.1f, 0.f, 0.f ), lightWorldViewMatrix ) );
+        Rasterizer::SetLight( light );
+
+        Rasterizer::SetMaterial( { { 0.5f, 0.6f, 0.5f, 1.f }, { 0.5f, 0.5f, 0.5f }, 40.f } );
+        Rasterizer::SetPipelineState( Rasterizer::SPipelineState( false, false, false, false, Rasterizer::ELightingModel::eBlinnPhong, Rasterizer::ELightType::eDirectional ) );
+
+        uint64_t trianglesCount = 0;
+        for ( const SBenchMeshDraw& draw : m_Scene.m_Draws )
+        {
+            Rasterizer::SetCullMode( draw.m_TwoSided ? Rasterizer::ECullMode::eNone : Rasterizer::ECullMode::eCullCW );
+            trianglesCount += DrawMesh( Rasterizer::GetDefaultContext(), draw, viewMatrix );
+        }
+        return trianglesCount;
+    }
+
+private:
+    CBenchScene m_Scene;
+    float m_LightOrbitAngle = 0.f;
+};
+
+class CBenchWorkload_ModelViewer : public CBenchWorkload
+{
+public:
+    CBenchWorkload_ModelViewer( const std::string& modelFilename, bool recordCommandBuffers, Rasterizer::ETextureFilter textureFilter, Rasterizer::ETextureLayout textureLayout,
+        Rasterizer::ETextureFormat textureFormat )
+        : m_ModelFilename( modelFilename )
+        , m_CommandBuffers( recordCommandBuffers ? std::max( 1u, std::thread::hardware_concurrency() ) : 0 )
+        , m_TextureFilter( textureFilter )
+        , m_Scene( textureLayout, textureFormat )
+    {
+    }
+
+    virtual const char* GetName() const override { return "modelviewer"; }
+
+    virtual bool Initialize( const std::string& resourcesDirectory ) override
+    {
+        const std::string modelFilename = m_ModelFilename.empty() ? resourcesDirectory + "/Teapot.glb" : m_ModelFilename;
+        if ( !m_Scene.LoadFromGLTFFile( modelFilename ) )
+        {
+            // Only the default model falls back, an explicitly requested one has to load
+            if ( !m_ModelFilename.empty() )
+            {
+                return false;
+            }
+            fprintf( stderr, "%s: %s can't be loaded, using textured spheres instead\n", GetName(), modelFilename.c_str() );
+            m_Scene.CreateSpheres( 3, 64, true );
+        }
+
+        // Orbit around the bounding sphere of the scene like the model viewer does by default
+        Rasterizer::SVector3 extents;
+        for ( uint32_t i = 0; i < 3; ++i )
+        {
+            m_CameraLookAt.m_Data[ i ] = ( m_Scene.m_BoundsMin.m_Data[ i ] + m_Scene.m_BoundsMax.m_Data[ i ] ) * 0.5f;
+            extents.m_Data[ i ] = ( m_Scene.m_BoundsMax.m_Data[ i ] - m_Scene.m_BoundsMin.m_Data[ i ] ) * 0.5f;
+        }
+        m_CameraDistance = sqrtf( extents.m_X * extents.m_X + extents.m_Y * extents.m_Y + extents.m_Z * extents.m_Z ) * 2.2f;
+
+        // Opaque draws before translucent ones
+        auto iterTranslucent = std::stable_partition( m_Scene.m_Draws.begin(), m_Scene.m_Draws.end(), []( const SBenchMeshDraw& draw ) { return !draw.m_AlphaBlend; } );
+        m_TranslucentDrawsStart = std::distance( m_Scene.m_Draws.begin(), iterTranslucent );
+        return true;
+    }
+
+    virtual uint64_t DrawFrame( uint32_t width, uint32_t height ) override
+    {
+        m_CameraYall += BenchMath::ConvertToRadians( 0.5f );
+
+        const Rasterizer::SMatrix cameraRotationMatrix = BenchMath::RotationRollPitchYaw( m_CameraPitch, m_CameraYall, 0.f );
+        const Rasterizer::SVector3 cameraPosition = BenchMath::TransformPoint( Rasterizer::SVector3( 0.f, 0.f, -m_CameraDistance ),
+            BenchMath::Multiply( cameraRotationMatrix, BenchMath::Translation( m_CameraLookAt.m_X, m_CameraLookAt.m_Y, m_CameraLookAt.m_Z ) ) );
+        const Rasterizer::SMatrix viewMatrix = BenchMath::Multiply( BenchMath::Multiply( BenchMath::Translation( -m_CameraLookAt.m_X, -m_CameraLookAt.m_Y, -m_CameraLookAt.m_Z ),
+            BenchMath::Transpose( cameraRotationMatrix ) ), BenchMath::Translation( 0.f, 0.f, m_CameraDistance ) );
+
+        std::vector<std::pair<float, const SBenchMeshDraw*>> sortedDraws;
+        sortedDraws.reserve( m_Scene.m_Draws.size() );
+        for ( const SBenchMeshDraw& draw : m_Scene.m_Draws )
+        {
+            const float dx = draw.m_Center.m_X - cameraPosition.m_X, dy = draw.m_Center.m_Y - cameraPosition.m_Y, dz = draw.m_Center.m_Z - cameraPosition.m_Z;
+            sortedDraws.emplace_back( dx * dx + dy * dy + dz * dz, &draw );
+        }
+        // Opaque draws front to back to minimize overdraw, translucent ones back to front for correct blending
+        std::sort( sortedDraws.begin(), sortedDraws.begin() + m_TranslucentDrawsStart, []( const auto& a, const auto& b ) { return a.first < b.first; } );
+        std::sort( sortedDraws.begin() + m_TranslucentDrawsStart, sortedDraws.end(), []( const auto& a, const auto& b ) { return a.first > b.first; } );
+
+        Rasterizer::CContext& context = Rasterizer::GetDefaultContext();
+        context.SetProjectionTransform( BenchMath::PerspectiveFovLH( BenchMath::ConvertToRadians( 40.f ), (float)width / height, 1.f, 1000.f ) );
+
+        uint64_t trianglesCount = 0;
+        if ( m_CommandBuffers.empty() )
+        {
+            trianglesCount = DrawSortedDraws( context, sortedDraws.data(), sortedDraws.size(), viewMatrix, m_TextureFilter );
+        }
+        else
+        {
+            // Each thread records a contiguous range of the sorted draws, the command buffers are executed in the same order
+            const size_t buffersCount = m_CommandBuffers.size();
+            std::vector<uint64_t> buffersTrianglesCount( buffersCount, 0 );
+            auto recordRange = [ & ]( size_t bufferIndex )
+            {
+                const size_t drawsBegin = sortedDraws.size() * bufferIndex / buffersCount;
+                const size_t drawsEnd = sortedDraws.size() * ( bufferIndex + 1 ) / buffersCount;
+                m_CommandBuffers[ bufferIndex ].Reset();
+                buffersTrianglesCount[ bufferIndex ] = DrawSortedDraws( m_CommandBuffers[ bufferIndex ], sortedDraws.data() + drawsBegin, drawsEnd - drawsBegin, viewMatrix, m_TextureFilter );
+            };
+
+            std::vector<std::thread> threads;
+            for ( size_t i = 1; i < buffersCount; ++i )
+            {
+                threads.emplace_back( recordRange, i );
+            }
+            recordRange( 0 );
+            for ( std::thread& thread : threads )
+            {
+                thread.join();
+            }
+
+            for ( size_t i = 0; i < buffersCount; ++i )
+            {
+                context.ExecuteCommandBuffer( m_CommandBuffers[ i ] );
+                trianglesCount += buffersTrianglesCount[ i ];
+            }
+        }
+        context.SetEnableDepthWrite( true );
+        return trianglesCount;
+    }
+
+private:
+    template <typename TTarget>
+    static uint64_t DrawSortedDraws( TTarget& target, const std::pair<float, const SBenchMeshDraw*>* sortedDraws, size_t drawsCount, const Rasterizer::SMatrix& viewMatrix,
+        Rasterizer::ETextureFilter textureFilter )
+    {
+        uint64_t trianglesCount = 0;
+        for ( size_t i = 0; i < drawsCount; ++i )
+        {
+            const SBenchMeshDraw& draw = *sortedDraws[ i ].second;
+            target.SetMaterial( draw.m_Material );
+            target.SetTexture( draw.m_DiffuseTexture );
+            target.SetCullMode( draw.m_TwoSided ? Rasterizer::ECullMode::eNone : Rasterizer::ECullMode::eCullCW );
+            target.SetAlphaRef( draw.m_AlphaRef );
+            target.SetEnableDepthWrite( !draw.m_AlphaBlend );
+            target.SetPipelineState( Rasterizer::SPipelineState( draw.m_DiffuseTexture.m_Bits != nullptr, draw.m_ColorStream.m_Data != nullptr, draw.m_AlphaTest, draw.m_AlphaBlend,
+                Rasterizer::ELightingModel::eUnlit, Rasterizer::ELightType::eDirectional, textureFilter ) );
+            trianglesCount += DrawMesh( target, draw, viewMatrix );
+        }
+        return trianglesCount;
+    }
+
+    std::string m_ModelFilename;
+    std::vector<Rasterizer::CCommandBuffer> m_CommandBuffers; // Only used when recording, one per recording thread
+    Rasterizer::ETextureFilter m_TextureFilter;
+    CBenchScene m_Scene;
+    ptrdiff_t m_TranslucentDrawsStart = 0;
+    Rasterizer::SVector3 m_CameraLookAt = Rasterizer::SVector3( 0.f, 0.f, 0.f );
+    float m_CameraDistance = 0.f;
+    float m_CameraPitch = 0.f, m_CameraYall = 0.f;
+};
+
+static void AccumulateFrameStats( const Rasterizer::SFrameStats& frameStats, Rasterizer::SFrameStats* stats )
+{
+    static_assert( sizeof( Rasterizer::SFrameStats ) % sizeof( uint64_t ) == 0, "SFrameStats is expected to only have uint64_t fields" );
+    const uint64_t* src = (const uint64_t*)&frameStats;
+    uint64_t* dst = (uint64_t*)stats;
+    for ( size_t i = 0; i < sizeof( Rasterizer::SFrameStats ) / sizeof( uint64_t ); ++i )
+    {
+        dst[ i ] += src[ i ];
+    }
+}
+
+// Per frame averages of the statistics
+static void PrintFrameStats( const Rasterizer::SFrameStats& stats, uint32_t framesCount )
+{
+    const double msScale = 1e-6 / framesCount;
+    printf( "    time ms    transform %.3f  clipping %.3f  perspective division %.3f  setup %.3f  binning %.3f  rasterization %.3f\n",
+        stats.m_VertexTransformTime * msScale, stats.m_ClippingTime * msScale, stats.m_PerspectiveDivisionTime * msScale,
+        stats.m_TriangleSetupTime * msScale, stats.m_BinningTime * msScale, stats.m_RasterizationTime * msScale );
+    printf( "    draws      %llu  vertices %llu\n", (unsigned long long)( stats.m_DrawsCount / framesCount ), (unsigned long long)( stats.m_VerticesTransformed / framesCount ) );
+    printf( "    triangles  submitted %llu  frustum culled %llu  back face culled %llu  clipped %llu  setup culled %llu  rasterized %llu\n",
+        (unsigned long long)( stats.m_TrianglesSubmitted / framesCount ), (unsigned long long)( stats.m_TrianglesFrustumCulled / framesCount ),
+        (unsigned long long)( stats.m_TrianglesBackFaceCulled / framesCount ), (unsigned long long)( stats.m_TrianglesClipped / framesCount ),
+        (unsigned long long)( stats.m_TrianglesSetupCulled / framesCount ), (unsigned long long)( stats.m_TrianglesRasterized / framesCount ) );
+    printf( "    pixels     tested %llu  depth passed %llu  alpha killed %llu  written %llu\n",
+        (unsigned long long)( stats.m_PixelsTested / framesCount ), (unsigned long long)( stats.m_PixelsDepthPassed / framesCount ),
+        (unsigned long long)( stats.m_PixelsAlphaKilled / framesCount ), (unsigned long long)( stats.m_PixelsWritten / framesCount ) );
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: rasterizer_bench [options] [hellotriangle|cubes|lighting|modelviewer ...]\n"
+        "  --frames N        Frames drawn per workload, 100 by default\n"
+        "  --warmup N        Frames drawn before timing, 10 by default\n"
+        "  --size WxH        Size of the render target, 800x600 by default\n"
+        "  --resources DIR   Directory of the demo resources, Resources by default\n"
+        "  --model FILE      glTF binary drawn by the modelviewer workload, the teapot by default\n"
+        "  --isa NAME        sse41, avx2 or avx512, the widest one supported by default\n"
+        "  --dump DIR        Writes the last frame of each workload to DIR/<workload>.png\n"
+        "  --stats           Prints the per frame statistics, requires a build with RASTERIZER_ENABLE_STATS\n"
+        "  --trace DIR       Records the last frame of each workload to DIR/<workload>_0.json, requires a build with RASTERIZER_ENABLE_TRACE\n"
+        "  --workers N       Job system workers, one per hardware thread but one by default\n"
+        "  --pin             Pins the workers to the logical processors from 1 on, leaving the first one to the calling thread\n"
+        "  --record          The modelviewer workload records its draws into command buffers on all hardware threads before executing them\n"
+        "  --filter NAME     Texture filter of the textured workloads, point, bilinear or trilinear, point by default\n"
+        "  --swizzle         The textured workloads store their textures in 4x4 blocks of texels in Morton order instead of rows\n"
+        "  --format NAME     Texel format of the textured workloads, bgra8, bc1 or bc3 compressed at load, bgra8 by default\n"
+        "  --tiled           Draws to render and depth targets stored in 64x64 tiles, the render target is resolved to rows every frame\n"
+        "  --check-decoding  Decodes reference BC7 blocks of every mode and compares them with their expected texels instead of drawing\n" );
+}
+
+int main( int argc, char** argv )
+{
+    uint32_t framesCount = 100;
+    uint32_t warmupFramesCount = 10;
+    uint32_t width = 800, height = 600;
+    std::string resourcesDirectory = "Resources";
+    std::string modelFilename;
+    std::string dumpDirectory;
+    std::string traceDirectory;
+    const char* instructionSetName = nullptr;
+    bool printStats = false;
+    bool recordCommandBuffers = false;
+    bool pinWorkers = false;
+    bool checkTextureDecoding = false;
+    Rasterizer::ETextureFilter textureFilter = Rasterizer::ETextureFilter::ePoint;
+    Rasterizer::ETextureLayout textureLayout = Rasterizer::ETextureLayout::eLinear;
+    Rasterizer::ETextureFormat textureFormat = Rasterizer::ETextureFormat::eB8G8R8A8;
+    Rasterizer::ETextureLayout targetLayout = Rasterizer::ETextureLayout::eLinear;
+    Rasterizer::SJobSystemDesc jobSystemDesc;
+    std::vector<std::string> workloadNames;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : nullptr;
+        const bool hasValue = value != nullptr;
+        if ( strcmp( arg, "--frames" ) == 0 && hasValue )
+        {
+            framesCount = (uint32_t)std::max( 1, atoi( value ) );
+        }
+        else if ( strcmp( arg, "--warmup" ) == 0 && hasValue )
+        {
+            warmupFramesCount = (uint32_t)std::max( 0, atoi( value ) );
+        }
+        else if ( strcmp( arg, "--size" ) == 0 && hasValue )
+        {
+            if ( sscanf( value, "%ux%u", &width, &height ) != 2 || width == 0 || height == 0 )
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if ( strcmp( arg, "--resources" ) == 0 && hasValue )
+        {
+            resourcesDirectory = value;
+        }
+        else if ( strcmp( arg, "--model" ) == 0 && hasValue )
+        {
+            modelFilename = value;
+        }
+        else if ( strcmp( arg, "--isa" ) == 0 && hasValue )
+        {
+            instructionSetName = value;
+        }
+        else if ( strcmp( arg, "--dump" ) == 0 && hasValue )
+        {
+            dumpDirectory = value;
+        }
+        else if ( strcmp( arg, "--trace" ) == 0 && hasValue )
+        {
+            traceDirectory = value;
+        }
+        else if ( strcmp( arg, "--stats" ) == 0 )
+        {
+            printStats = true;
+            continue;
+        }
+        else if ( strcmp( arg, "--workers" ) == 0 && hasValue )
+        {
+            jobSystemDesc.m_WorkersCount = (uint32_t)std::max( 0, atoi( value ) );
+        }
+        else if ( strcmp( arg, "--pin" ) == 0 )
+        {
+            pinWorkers = true;
+            continue;
+        }
+        else if ( strcmp( arg, "--record" ) == 0 )
+        {
+            recordCommandBuffers = true;
+            continue;
+        }
+        else if ( strcmp( arg, "--check-decoding" ) == 0 )
+        {
+            checkTextureDecoding = true;
+            continue;
+        }
+        else if ( strcmp( arg, "--filter" ) == 0 && hasValue )
+        {
+            if ( strcmp( value, "point" ) == 0 )
+            {
+                textureFilter = Rasterizer::ETextureFilter::ePoint;
+            }
+            else if ( strcmp( value, "bilinear" ) == 0 )
+            {
+                textureFilter = Rasterizer::ETextureFilter::eBilinear;
+            }
+            else if ( strcmp( value, "trilinear" ) == 0 )
+            {
+                textureFilter = Rasterizer::ETextureFilter::eTrilinear;
+            }
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if ( strcmp( arg, "--swizzle" ) == 0 )
+        {
+            textureLayout = Rasterizer::ETextureLayout::eSwizzled;
+            continue;
+        }
+        else if ( strcmp( arg, "--tiled" ) == 0 )
+        {
+            targetLayout = Rasterizer::ETextureLayout::eTiled;
+            continue;
+        }
+        else if ( strcmp( arg, "--format" ) == 0 && hasValue )
+        {
+            if ( strcmp( value, "bgra8" ) == 0 )
+            {
+                textureFormat = Rasterizer::ETextureFormat::eB8G8R8A8;
+            }
+            else if ( strcmp( value, "bc1" ) == 0 )
+            {
+                textureFormat = Rasterizer::ETextureFormat::eBC1;
+            }
+            else if ( strcmp( value, "bc3" ) == 0 )
+            {
+                textureFormat = Rasterizer::ETextureFormat::eBC3;
+            }
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if ( arg[ 0 ] != '-' )
+        {
+            workloadNames.emplace_back( arg );
+            continue;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++i;
+    }
+
+    if ( checkTextureDecoding )
+    {
+        return CheckTextureDecoding() ? 0 : 1;
+    }
+
+    std::vector<std::unique_ptr<CBenchWorkload>> workloads;
+    workloads.emplace_back( new CBenchWorkload_HelloTriangle() );
+    workloads.emplace_back( new CBenchWorkload_Cubes( textureFilter, textureLayout, textureFormat ) );
+    workloads.emplace_back( new CBenchWorkload_Lighting() );
+    workloads.emplace_back( new CBenchWorkload_ModelViewer( modelFilename, recordCommandBuffers, textureFilter, textureLayout, textureFormat ) );
+
+    for ( const std::string& name : workloadNames )
+    {
+        if ( std::none_of( workloads.begin(), workloads.end(), [ &name ]( const std::unique_ptr<CBenchWorkload>& workload ) { return name == workload->GetName(); } ) )
+        {
+            fprintf( stderr, "Unknown workload %s\n", name.c_str() );
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::vector<uint32_t> workerCpuIndices;
+    if ( pinWorkers )
+    {
+        const uint32_t hardwareThreadsCount = std::max( 1u, std::thread::hardware_concurrency() );
+        workerCpuIndices.resize( jobSystemDesc.m_WorkersCount != UINT32_MAX ? jobSystemDesc.m_WorkersCount : hardwareThreadsCount - 1 );
+        for ( size_t i = 0; i < workerCpuIndices.size(); ++i )
+        {
+            workerCpuIndices[ i ] = uint32_t( ( i + 1 ) % hardwareThreadsCount );
+        }
+        jobSystemDesc.m_WorkerCpuIndices = workerCpuIndices.data();
+    }
+    Rasterizer::Initialize( jobSystemDesc );
+
+    if ( instructionSetName )
+    {
+        const char* instructionSetNames[] = { "sse41", "avx2", "avx512" };
+        const auto iter = std::find_if( std::begin( instructionSetNames ), std::end( instructionSetNames ), [ instructionSetName ]( const char* name ) { return strcmp( name, instructionSetName ) == 0; } );
+        if ( iter == std::end( instructionSetNames ) || !Rasterizer::SetInstructionSet( (Rasterizer::EInstructionSet)( iter - std::begin( instructionSetNames ) ) ) )
+        {
+            fprintf( stderr, "Instruction set %s is not supported\n", instructionSetName );
+            return 1;
+        }
+    }
+
+    // The tiled targets are padded to whole tiles, the frames are resolved to the linear image. Its rows are streamed to memory
+    // when it starts on a cache line
+    const size_t targetByteSize = Rasterizer::GetImageByteSize( width, height, 1, targetLayout );
+    Rasterizer::SImage renderTarget = { (uint8_t*)malloc( targetByteSize ), width, height, 1, targetLayout, Rasterizer::ETextureFormat::eB8G8R8A8 };
+    Rasterizer::SImage depthTarget = { (uint8_t*)malloc( targetByteSize ), width, height, 1, targetLayout, Rasterizer::ETextureFormat::eB8G8R8A8 };
+    Rasterizer::SImage resolvedImage = renderTarget;
+    uint8_t* resolvedBits = nullptr;
+    if ( targetLayout == Rasterizer::ETextureLayout::eTiled )
+    {
+        resolvedBits = (uint8_t*)malloc( width * height * 4 + 63 );
+        resolvedImage.m_Bits = (uint8_t*)( ( uintptr_t( resolvedBits ) + 63 ) & ~uintptr_t( 63 ) );
+    }
+    Rasterizer::SViewport viewport = { 0, 0, width, height };
+
+    int returnCode = 0;
+    for ( const std::unique_ptr<CBenchWorkload>& workload : workloads )
+    {
+        if ( !workloadNames.empty() && std::find( workloadNames.begin(), workloadNames.end(), workload->GetName() ) == workloadNames.end() )
+        {
+            continue;
+        }
+
+        if ( !workload->Initialize( resourcesDirectory ) )
+        {
+            fprintf( stderr, "%s: failed to load the resources\n", workload->GetName() );
+            returnCode = 1;
+            continue;
+        }
+
+        Rasterizer::SetRenderTarget( renderTarget );
+        Rasterizer::SetDepthTarget( depthTarget );
+        Rasterizer::SetViewport( viewport );
+
+        uint64_t trianglesCount = 0;
+        Rasterizer::SFrameStats stats = {};
+        std::chrono::steady_clock::time_point startTime;
+        for ( uint32_t frame = 0; frame < warmupFramesCount + framesCount; ++frame )
+        {
+            if ( frame == warmupFramesCount )
+            {
+                trianglesCount = 0;
+                startTime = std::chrono::steady_clock::now();
+            }
+
+            if ( !traceDirectory.empty() && frame + 1 == warmupFramesCount + framesCount && !Rasterizer::StartFrameTrace( ( traceDirectory + "/" + workload->GetName() + "_" ).c_str() ) )
+            {
+                fprintf( stderr, "%s: frame traces require a build with RASTERIZER_ENABLE_TRACE\n", workload->GetName() );
+                returnCode = 1;
+            }
+
+            Rasterizer::BeginFrame();
+            memset( renderTarget.m_Bits, 0, targetByteSize );
+            Rasterizer::ClearDepthTarget( 1.f );
+            trianglesCount += workload->DrawFrame( width, height );
+            if ( targetLayout == Rasterizer::ETextureLayout::eTiled )
+            {
+                resolvedImage = Rasterizer::ResolveImage( renderTarget, resolvedImage.m_Bits );
+            }
+            if ( frame >= warmupFramesCount )
+            {
+                AccumulateFrameStats( Rasterizer::GetFrameStats(), &stats );
+            }
+        }
+        const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+        Rasterizer::StopFrameTrace();
+
+        printf( "%-14s %ux%u %5u frames %10.3f ms/frame %10.3f Mtri/s\n", workload->GetName(), width, height, framesCount,
+            seconds * 1000.0 / framesCount, trianglesCount / seconds * 1e-6 );
+        if ( printStats )
+        {
+            PrintFrameStats( stats, framesCount );
+        }
+
+        if ( !dumpDirectory.empty() && !SaveImageToFile( dumpDirectory + "/" + workload->GetName() + ".png", resolvedImage ) )
+        {
+            fprintf( stderr, "%s: failed to write the frame to %s\n", workload->GetName(), dumpDirectory.c_str() );
+            returnCode = 1;
+        }
+    }
+
+    free( resolvedBits );
+    free( renderTarget.m_Bits );
+    free( depthTarget.m_Bits );
+    return returnCode;
+}
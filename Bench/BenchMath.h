@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cmath>
+#include "Rasterizer.h"
+
+// The subset of DirectXMath the demos use, row vectors and left handed like DirectXMath
+namespace BenchMath
+{
+    inline Rasterizer::SMatrix Identity()
+    {
+        return Rasterizer::SMatrix(
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f,
+            0.f, 0.f, 0.f, 1.f );
+    }
+
+    inline Rasterizer::SMatrix Multiply( const Rasterizer::SMatrix& a, const Rasterizer::SMatrix& b )
+    {
+        Rasterizer::SMatrix result;
+        for ( uint32_t row = 0; row < 4; ++row )
+        {
+            for ( uint32_t column = 0; column < 4; ++column )
+            {
+                float sum = 0.f;
+                for ( uint32_t i = 0; i < 4; ++i )
+                {
+                    sum += a.m_Data[ row * 4 + i ] * b.m_Data[ i * 4 + column ];
+                }
+                result.m_Data[ row * 4 + column ] = sum;
+            }
+        }
+        return result;
+    }
+
+    inline Rasterizer::SMatrix Transpose( const Rasterizer::SMatrix& m )
+    {
+        return Rasterizer::SMatrix(
+            m.m_00, m.m_10, m.m_20, m.m_30,
+            m.m_01, m.m_11, m.m_21, m.m_31,
+            m.m_02, m.m_12, m.m_22, m.m_32,
+            m.m_03, m.m_13, m.m_23, m.m_33 );
+    }
+
+    inline Rasterizer::SMatrix Translation( float x, float y, float z )
+    {
+        return Rasterizer::SMatrix(
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f,
+            x, y, z, 1.f );
+    }
+
+    inline Rasterizer::SMatrix Scaling( float x, float y, float z )
+    {
+        return Rasterizer::SMatrix(
+            x, 0.f, 0.f, 0.f,
+            0.f, y, 0.f, 0.f,
+            0.f, 0.f, z, 0.f,
+            0.f, 0.f, 0.f, 1.f );
+    }
+
+    // Same as XMMatrixRotationRollPitchYaw, rolls around z first, then pitches around x and yaws around y
+    inline Rasterizer::SMatrix RotationRollPitchYaw( float pitch, float yaw, float roll )
+    {
+        const float cp = cosf( pitch ), sp = sinf( pitch );
+        const float cy = cosf( yaw ), sy = sinf( yaw );
+        const float cr = cosf( roll ), sr = sinf( roll );
+        const Rasterizer::SMatrix rollMatrix( cr, sr, 0.f, 0.f, -sr, cr, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f );
+        const Rasterizer::SMatrix pitchMatrix( 1.f, 0.f, 0.f, 0.f, 0.f, cp, sp, 0.f, 0.f, -sp, cp, 0.f, 0.f, 0.f, 0.f, 1.f );
+        const Rasterizer::SMatrix yawMatrix( cy, 0.f, -sy, 0.f, 0.f, 1.f, 0.f, 0.f, sy, 0.f, cy, 0.f, 0.f, 0.f, 0.f, 1.f );
+        return Multiply( Multiply( rollMatrix, pitchMatrix ), yawMatrix );
+    }
+
+    inline Rasterizer::SMatrix RotationQuaternion( float x, float y, float z, float w )
+    {
+        return Rasterizer::SMatrix(
+            1.f - 2.f * ( y * y + z * z ), 2.f * ( x * y + z * w ), 2.f * ( x * z - y * w ), 0.f,
+            2.f * ( x * y - z * w ), 1.f - 2.f * ( x * x + z * z ), 2.f * ( y * z + x * w ), 0.f,
+            2.f * ( x * z + y * w ), 2.f * ( y * z - x * w ), 1.f - 2.f * ( x * x + y * y ), 0.f,
+            0.f, 0.f, 0.f, 1.f );
+    }
+
+    inline Rasterizer::SMatrix PerspectiveFovLH( float fovAngleY, float aspectRatio, float nearZ, float farZ )
+    {
+        const float height = 1.f / tanf( fovAngleY * 0.5f );
+        const float width = height / aspectRatio;
+        const float range = farZ / ( farZ - nearZ );
+        return Rasterizer::SMatrix(
+            width, 0.f, 0.f, 0.f,
+            0.f, height, 0.f, 0.f,
+            0.f, 0.f, range, 1.f,
+            0.f, 0.f, -range * nearZ, 0.f );
+    }
+
+    inline Rasterizer::SVector3 TransformPoint( const Rasterizer::SVector3& v, const Rasterizer::SMatrix& m )
+    {
+        return Rasterizer::SVector3(
+            v.m_X * m.m_00 + v.m_Y * m.m_10 + v.m_Z * m.m_20 + m.m_30,
+            v.m_X * m.m_01 + v.m_Y * m.m_11 + v.m_Z * m.m_21 + m.m_31,
+            v.m_X * m.m_02 + v.m_Y * m.m_12 + v.m_Z * m.m_22 + m.m_32 );
+    }
+
+    inline Rasterizer::SVector3 TransformNormal( const Rasterizer::SVector3& v, const Rasterizer::SMatrix& m )
+    {
+        return Rasterizer::SVector3(
+            v.m_X * m.m_00 + v.m_Y * m.m_10 + v.m_Z * m.m_20,
+            v.m_X * m.m_01 + v.m_Y * m.m_11 + v.m_Z * m.m_21,
+            v.m_X * m.m_02 + v.m_Y * m.m_12 + v.m_Z * m.m_22 );
+    }
+
+    inline Rasterizer::SVector3 Normalize( const Rasterizer::SVector3& v )
+    {
+        const float length = sqrtf( v.m_X * v.m_X + v.m_Y * v.m_Y + v.m_Z * v.m_Z );
+        return length > 0.f ? Rasterizer::SVector3( v.m_X / length, v.m_Y / length, v.m_Z / length ) : v;
+    }
+
+    inline float ConvertToRadians( float degrees )
+    {
+        return degrees * ( 3.141592654f / 180.f );
+    }
+}
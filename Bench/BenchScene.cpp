@@ -0,0 +1,519 @@
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "BenchScene.h"
+#include "BenchMath.h"
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#if defined( _MSC_VER )
+#pragma warning( disable : 4018 )
+#pragma warning( disable : 4267 )
+#endif
+#include "tinygltf/tiny_gltf.h"
+#if defined( _MSC_VER )
+#pragma warning( default : 4018 )
+#pragma warning( default : 4267 )
+#endif
+
+static void SwapRedAndBlue( uint8_t* pixels, uint32_t pixelsCount )
+{
+    for ( uint32_t i = 0; i < pixelsCount; ++i )
+    {
+        std::swap( pixels[ i * 4 ], pixels[ i * 4 + 2 ] );
+    }
+}
+
+// Allocates an image with room for its full mip chain, the levels are generated once the first one is filled
+static void AllocateTexture( uint32_t width, uint32_t height, Rasterizer::SImage* image )
+{
+    image->m_Width = width;
+    image->m_Height = height;
+    image->m_MipLevelsCount = Rasterizer::GetMipLevelsCount( width, height );
+    image->m_Layout = Rasterizer::ETextureLayout::eLinear;
+    image->m_Format = Rasterizer::ETextureFormat::eB8G8R8A8;
+    image->m_Bits = (uint8_t*)malloc( Rasterizer::GetImageByteSize( width, height, image->m_MipLevelsCount ) );
+}
+
+// Moves the texels of a linear texture to the layout or the block compressed format it is sampled from once its mip levels are generated
+static void SetTextureLayout( Rasterizer::ETextureLayout layout, Rasterizer::ETextureFormat format, Rasterizer::SImage* image )
+{
+    if ( format != Rasterizer::ETextureFormat::eB8G8R8A8 )
+    {
+        uint8_t* bits = (uint8_t*)malloc( Rasterizer::GetImageByteSize( image->m_Width, image->m_Height, image->m_MipLevelsCount, layout, format ) );
+        const Rasterizer::SImage compressedImage = Rasterizer::CompressImage( *image, format, bits );
+        free( image->m_Bits );
+        *image = compressedImage;
+    }
+    else if ( layout == Rasterizer::ETextureLayout::eSwizzled )
+    {
+        uint8_t* bits = (uint8_t*)malloc( Rasterizer::GetImageByteSize( image->m_Width, image->m_Height, image->m_MipLevelsCount, layout ) );
+        const Rasterizer::SImage swizzledImage = Rasterizer::SwizzleImage( *image, bits );
+        free( image->m_Bits );
+        *image = swizzledImage;
+    }
+}
+
+bool LoadImageFromFile( const std::string& filename, Rasterizer::ETextureLayout layout, Rasterizer::ETextureFormat format, Rasterizer::SImage* image )
+{
+    int width = 0, height = 0, components = 0;
+    uint8_t* pixels = stbi_load( filename.c_str(), &width, &height, &components, 4 );
+    if ( !pixels )
+    {
+        return false;
+    }
+
+    AllocateTexture( (uint32_t)width, (uint32_t)height, image );
+    memcpy( image->m_Bits, pixels, image->m_Width * image->m_Height * 4 );
+    SwapRedAndBlue( image->m_Bits, image->m_Width * image->m_Height );
+    Rasterizer::GenerateMips( *image );
+    SetTextureLayout( layout, format, image );
+    stbi_image_free( pixels );
+    return true;
+}
+
+void CreateCheckerImage( uint32_t size, uint32_t checkerSize, Rasterizer::ETextureLayout layout, Rasterizer::ETextureFormat format, Rasterizer::SImage* image )
+{
+    AllocateTexture( size, size, image );
+    uint32_t* pixels = (uint32_t*)image->m_Bits;
+    for ( uint32_t y = 0; y < size; ++y )
+    {
+        for ( uint32_t x = 0; x < size; ++x )
+        {
+            pixels[ y * size + x ] = ( ( x / checkerSize ) ^ ( y / checkerSize ) ) & 1 ? 0xFFB08040 : 0xFFE0E0D0;
+        }
+    }
+    Rasterizer::GenerateMips( *image );
+    SetTextureLayout( layout, format, image );
+}
+
+void FreeImage( Rasterizer::SImage* image )
+{
+    free( image->m_Bits );
+    image->m_Bits = nullptr;
+}
+
+bool SaveImageToFile( const std::string& filename, const Rasterizer::SImage& image )
+{
+    std::vector<uint8_t> pixels( image.m_Bits, image.m_Bits + image.m_Width * image.m_Height * 4 );
+    SwapRedAndBlue( pixels.data(), image.m_Width * image.m_Height );
+    for ( uint32_t i = 0; i < image.m_Width * image.m_Height; ++i )
+    {
+        pixels[ i * 4 + 3 ] = 0xFF;
+    }
+    return stbi_write_png( filename.c_str(), (int)image.m_Width, (int)image.m_Height, 4, pixels.data(), (int)image.m_Width * 4 ) != 0;
+}
+
+struct SReferenceBlock
+{
+    uint8_t m_Bits[ 16 ];
+    uint32_t m_Texels[ 16 ]; // B8G8R8A8 in rows
+};
+
+// Random blocks of every BC7 mode, along with the rotations and the index selection of modes 4 and 5. The expected texels were decoded
+// by an independent decoder
+static const SReferenceBlock s_BC7ReferenceBlocks[] =
+{
+    { // Mode 0
+        { 0x79, 0x2E, 0xBA, 0x94, 0x4D, 0x33, 0xE3, 0xB9, 0x68, 0xC1, 0xB7, 0xC2, 0x43, 0x88, 0x3E, 0xA2 },
+        { 0xFF46ACEB, 0xFFA6A14F, 0xFF50A856, 0xFF5A9CBD, 0xFF7B6BCE, 0xFF34AB58, 0xFF18AD5A, 0xFF6689A4,
+          0xFF5C91DF, 0xFF18AD5A, 0xFFA6A14F, 0xFFAD1808, 0xFF3BB9F1, 0xFF50A856, 0xFF8AA351, 0xFF71778A },
+    },
+    { // Mode 1
+        { 0xD2, 0xBC, 0x7F, 0x5A, 0x6A, 0x86, 0xBA, 0x9D, 0xF6, 0x37, 0x4F, 0x8B, 0xB4, 0x54, 0x84, 0x13 },
+        { 0xFFF68E71, 0xFF77B18B, 0xFF64B852, 0xFFF59873, 0xFF77B18B, 0xFF77B18B, 0xFFFA706C, 0xFFF59873,
+          0xFF8CAAC6, 0xFFF9796D, 0xFFF3AB76, 0xFF95A6E3, 0xFFF8836F, 0xFFF68E71, 0xFF8CAAC6, 0xFF9FA3FF },
+    },
+    { // Mode 2
+        { 0xBC, 0xC6, 0xFF, 0xDD, 0x34, 0xB0, 0xC0, 0xBA, 0x77, 0xEC, 0xB5, 0xD4, 0xDF, 0xA7, 0x25, 0x88 },
+        { 0xFF641E59, 0xFF641E59, 0xFFFF5ADE, 0xFFFF5ADE, 0xFFFA1E5A, 0xFFF43C5A, 0xFFB33C9D, 0xFF641E59,
+          0xFF44BD8B, 0xFF31BD52, 0xFFFA1E5A, 0xFF180018, 0xFF31BD52, 0xFF58BDC6, 0xFFFF005A, 0xFFB33C9D },
+    },
+    { // Mode 3
+        { 0x38, 0xDE, 0x69, 0xFA, 0x0E, 0xC5, 0x59, 0xA0, 0x6A, 0x77, 0x1F, 0xB9, 0xBE, 0x23, 0xC3, 0x53 },
+        { 0xFFC24EA0, 0xFF699D77, 0xFFB73E75, 0xFF3BA9E5, 0xFFC24EA0, 0xFFEE28B4, 0xFFB73E75, 0xFF7875AE,
+          0xFFB73E75, 0xFFF40A3E, 0xFFEE28B4, 0xFF699D77, 0xFF3BA9E5, 0xFFF40A3E, 0xFFC24EA0, 0xFFC24EA0 },
+    },
+    { // Mode 4, rotation 1 and index selection
+        { 0xB0, 0x54, 0x58, 0xCB, 0x33, 0x53, 0x6D, 0x6A, 0x51, 0x91, 0x36, 0xE7, 0xDE, 0x68, 0x3A, 0x34 },
+        { 0x663CB5DC, 0x253CB5D2, 0x4F55B5D9, 0x6630B5DC, 0x253CB5D2, 0x3A3CB5D5, 0x1055B5CE, 0x2549B5D2,
+          0xA530B5E7, 0x3A49B5D5, 0x9049B5E3, 0x3A49B5D5, 0x6630B5DC, 0xA549B5E7, 0x3A30B5D5, 0x903CB5E3 },
+    },
+    { // Mode 4, rotation 3
+        { 0x70, 0xBF, 0x39, 0xC3, 0x04, 0xF8, 0xDD, 0x42, 0xD8, 0x81, 0x51, 0xC5, 0xF5, 0x91, 0xCD, 0xB4 },
+        { 0x48CE5D82, 0x106B3181, 0x2B9C477E, 0x48CE5D81, 0x48CE5D7F, 0x63FF7380, 0x2B9C477E, 0x63FF737D,
+          0x63FF7381, 0x106B3181, 0x2B9C477E, 0x106B317E, 0x63FF737F, 0x63FF7381, 0x63FF737E, 0x106B317E },
+    },
+    { // Mode 5, rotation 2
+        { 0xA0, 0x9D, 0x1C, 0x54, 0xD9, 0xA7, 0x9B, 0xC7, 0x3B, 0x3C, 0xFE, 0x76, 0x5D, 0x22, 0x33, 0x5E },
+        { 0xA13AE6FB, 0x9572F1E9, 0x9D4CEAF5, 0xA13AEAFB, 0x9960EDEF, 0x9572E6E9, 0x9D4CEDF5, 0xA13AE6FB,
+          0x9572F1E9, 0x9572E6E9, 0x9572F1E9, 0x9D4CE6F5, 0x9572EDE9, 0x9960F1EF, 0x9572EAE9, 0x9960EAEF },
+    },
+    { // Mode 5
+        { 0x20, 0x98, 0xD6, 0xA0, 0x24, 0x43, 0x63, 0x9F, 0x56, 0x55, 0xF0, 0xB5, 0xFF, 0xB6, 0x77, 0xDC },
+        { 0xC83E1C88, 0xA74C34AD, 0xA74C34AD, 0xA74C34AD, 0xB74C34AD, 0xC84C34AD, 0xA74C34AD, 0xB7300664,
+          0xA7300664, 0xC84C34AD, 0xA75A4AD1, 0xC85A4AD1, 0xD84C34AD, 0xA74C34AD, 0xC83E1C88, 0xA75A4AD1 },
+    },
+    { // Mode 6
+        { 0x40, 0xAF, 0xB2, 0xC4, 0xDC, 0x21, 0x54, 0xEC, 0x34, 0x94, 0xAF, 0x10, 0x19, 0xF0, 0xD7, 0x2C },
+        { 0x67B75669, 0x70B55B62, 0x78B25F5C, 0xA3A5793A, 0xD8949810, 0xADA17F32, 0x55BD4B77, 0x5DBA5071,
+          0xA3A5793A, 0x5DBA5071, 0x55BD4B77, 0xD8949810, 0x92AA6F47, 0xC69A8D1E, 0xBD9C8825, 0x67B75669 },
+    },
+    { // Mode 7
+        { 0x80, 0xE6, 0x26, 0x70, 0xB4, 0x3C, 0x59, 0x3A, 0x14, 0x32, 0xCD, 0x48, 0x3D, 0xB1, 0x76, 0x9A },
+        { 0x89A08C46, 0x20186182, 0x4E628A9A, 0xAF5FAC3F, 0x65869EA6, 0xAF5FAC3F, 0x89A08C46, 0x4E628A9A,
+          0xD320CB38, 0x373C758E, 0x20186182, 0x65DF6D4D, 0x4E628A9A, 0xD320CB38, 0x65DF6D4D, 0x4E628A9A },
+    },
+};
+
+bool CheckTextureDecoding()
+{
+    // The blocks are decoded side by side as a single level image
+    const uint32_t blocksCount = sizeof( s_BC7ReferenceBlocks ) / sizeof( SReferenceBlock );
+    Rasterizer::SImage image;
+    image.m_Width = blocksCount * 4;
+    image.m_Height = 4;
+    image.m_Format = Rasterizer::ETextureFormat::eBC7;
+    std::vector<uint8_t> blocks( blocksCount * 16 );
+    for ( uint32_t i = 0; i < blocksCount; ++i )
+    {
+        memcpy( blocks.data() + i * 16, s_BC7ReferenceBlocks[ i ].m_Bits, 16 );
+    }
+    image.m_Bits = blocks.data();
+
+    std::vector<uint32_t> texels( image.m_Width * image.m_Height );
+    Rasterizer::DecompressImage( image, (uint8_t*)texels.data() );
+    uint32_t mismatchesCount = 0;
+    for ( uint32_t i = 0; i < blocksCount; ++i )
+    {
+        for ( uint32_t j = 0; j < 16; ++j )
+        {
+            const uint32_t texel = texels[ ( j >> 2 ) * image.m_Width + i * 4 + ( j & 3 ) ];
+            if ( texel != s_BC7ReferenceBlocks[ i ].m_Texels[ j ] )
+            {
+                fprintf( stderr, "bc7: texel %u of reference block %u is %08X instead of %08X\n", j, i, texel, s_BC7ReferenceBlocks[ i ].m_Texels[ j ] );
+                ++mismatchesCount;
+            }
+        }
+    }
+    printf( "bc7: %u reference blocks decoded, %u texels mismatch\n", blocksCount, mismatchesCount );
+    return mismatchesCount == 0;
+}
+
+static Rasterizer::SStream TranslateAccessor( const tinygltf::Model& model, std::vector<std::vector<uint8_t>>& buffers, const tinygltf::Accessor& accessor, uint32_t defaultStride )
+{
+    const tinygltf::BufferView& bufferView = model.bufferViews[ accessor.bufferView ];
+    const uint32_t stride = bufferView.byteStride != 0 ? (uint32_t)bufferView.byteStride : defaultStride;
+    const uint32_t offset = (uint32_t)( bufferView.byteOffset + accessor.byteOffset );
+    return Rasterizer::SStream( offset, stride, (uint32_t)accessor.count * stride, buffers[ bufferView.buffer ].data() );
+}
+
+static bool FindAttribute( const tinygltf::Model& model, const tinygltf::Primitive& primitive, const char* name, const tinygltf::Accessor** accessor )
+{
+    auto iter = primitive.attributes.find( name );
+    if ( iter == primitive.attributes.end() )
+    {
+        return false;
+    }
+    *accessor = &model.accessors[ iter->second ];
+    return (*accessor)->componentType == TINYGLTF_COMPONENT_TYPE_FLOAT;
+}
+
+static Rasterizer::SMatrix GetNodeLocalTransform( const tinygltf::Node& node )
+{
+    if ( !node.matrix.empty() )
+    {
+        Rasterizer::SMatrix matrix;
+        for ( uint32_t i = 0; i < 16; ++i )
+        {
+            matrix.m_Data[ i ] = (float)node.matrix[ i ];
+        }
+        return matrix;
+    }
+
+    Rasterizer::SMatrix matrix = BenchMath::Identity();
+    if ( !node.scale.empty() )
+    {
+        matrix = BenchMath::Scaling( (float)node.scale[ 0 ], (float)node.scale[ 1 ], (float)node.scale[ 2 ] );
+    }
+    if ( !node.rotation.empty() )
+    {
+        matrix = BenchMath::Multiply( matrix, BenchMath::RotationQuaternion( (float)node.rotation[ 0 ], (float)node.rotation[ 1 ], (float)node.rotation[ 2 ], (float)node.rotation[ 3 ] ) );
+    }
+    if ( !node.translation.empty() )
+    {
+        matrix = BenchMath::Multiply( matrix, BenchMath::Translation( (float)node.translation[ 0 ], (float)node.translation[ 1 ], (float)node.translation[ 2 ] ) );
+    }
+    return matrix;
+}
+
+CBenchScene::~CBenchScene()
+{
+    for ( Rasterizer::SImage& image : m_Images )
+    {
+        FreeImage( &image );
+    }
+}
+
+bool CBenchScene::LoadFromGLTFFile( const std::string& filename )
+{
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    std::string err, warn;
+    if ( !loader.LoadBinaryFromFile( &model, &err, &warn, filename ) )
+    {
+        fprintf( stderr, "%s\n%s\n", err.c_str(), warn.c_str() );
+        return false;
+    }
+
+    m_Buffers.reserve( model.buffers.size() );
+    for ( tinygltf::Buffer& buffer : model.buffers )
+    {
+        m_Buffers.emplace_back( std::move( buffer.data ) );
+    }
+
+    // Tinygltf decodes the images to RGBA already
+    m_Images.reserve( model.images.size() );
+    for ( const tinygltf::Image& srcImage : model.images )
+    {
+        Rasterizer::SImage image = {};
+        if ( srcImage.component == 4 && srcImage.bits == 8 && !srcImage.image.empty() )
+        {
+            AllocateTexture( (uint32_t)srcImage.width, (uint32_t)srcImage.height, &image );
+            memcpy( image.m_Bits, srcImage.image.data(), srcImage.image.size() );
+            SwapRedAndBlue( image.m_Bits, image.m_Width * image.m_Height );
+            Rasterizer::GenerateMips( image );
+            SetTextureLayout( m_TextureLayout, m_TextureFormat, &image );
+        }
+        m_Images.push_back( image );
+    }
+
+    // Node world transforms, the root nodes are flipped to left hand coordinate
+    std::vector<int32_t> parents( model.nodes.size(), -1 );
+    for ( size_t nodeIndex = 0; nodeIndex < model.nodes.size(); ++nodeIndex )
+    {
+        for ( int32_t child : model.nodes[ nodeIndex ].children )
+        {
+            parents[ child ] = (int32_t)nodeIndex;
+        }
+    }
+
+    std::vector<Rasterizer::SMatrix> localTransforms;
+    localTransforms.reserve( model.nodes.size() );
+    for ( size_t nodeIndex = 0; nodeIndex < model.nodes.size(); ++nodeIndex )
+    {
+        localTransforms.push_back( GetNodeLocalTransform( model.nodes[ nodeIndex ] ) );
+        if ( parents[ nodeIndex ] == -1 )
+        {
+            Rasterizer::SMatrix& matrix = localTransforms.back();
+            matrix.m_00 = -matrix.m_00;
+            matrix.m_10 = -matrix.m_10;
+            matrix.m_20 = -matrix.m_20;
+        }
+    }
+
+    m_BoundsMin = Rasterizer::SVector3( FLT_MAX, FLT_MAX, FLT_MAX );
+    m_BoundsMax = Rasterizer::SVector3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+
+    for ( size_t nodeIndex = 0; nodeIndex < model.nodes.size(); ++nodeIndex )
+    {
+        const tinygltf::Node& node = model.nodes[ nodeIndex ];
+        if ( node.mesh == -1 )
+        {
+            continue;
+        }
+
+        Rasterizer::SMatrix worldMatrix = localTransforms[ nodeIndex ];
+        for ( int32_t parent = parents[ nodeIndex ]; parent != -1; parent = parents[ parent ] )
+        {
+            worldMatrix = BenchMath::Multiply( worldMatrix, localTransforms[ parent ] );
+        }
+
+        for ( const tinygltf::Primitive& primitive : model.meshes[ node.mesh ].primitives )
+        {
+            const tinygltf::Accessor* accessor = nullptr;
+            if ( primitive.mode != TINYGLTF_MODE_TRIANGLES || !FindAttribute( model, primitive, "POSITION", &accessor ) || accessor->type != TINYGLTF_TYPE_VEC3 )
+            {
+                continue;
+            }
+
+            SBenchMeshDraw draw;
+            draw.m_WorldMatrix = worldMatrix;
+            draw.m_PositionStream = TranslateAccessor( model, m_Buffers, *accessor, 12 );
+            draw.m_PrimitiveCount = (uint32_t)accessor->count / 3;
+
+            // World space bounding box from the corners of the local one
+            Rasterizer::SVector3 boxMin( FLT_MAX, FLT_MAX, FLT_MAX ), boxMax( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+            if ( accessor->minValues.size() == 3 && accessor->maxValues.size() == 3 )
+            {
+                for ( uint32_t corner = 0; corner < 8; ++corner )
+                {
+                    const Rasterizer::SVector3 localCorner(
+                        (float)( corner & 1 ? accessor->maxValues[ 0 ] : accessor->minValues[ 0 ] ),
+                        (float)( corner & 2 ? accessor->maxValues[ 1 ] : accessor->minValues[ 1 ] ),
+                        (float)( corner & 4 ? accessor->maxValues[ 2 ] : accessor->minValues[ 2 ] ) );
+                    const Rasterizer::SVector3 worldCorner = BenchMath::TransformPoint( localCorner, worldMatrix );
+                    for ( uint32_t i = 0; i < 3; ++i )
+                    {
+                        boxMin.m_Data[ i ] = std::min( boxMin.m_Data[ i ], worldCorner.m_Data[ i ] );
+                        boxMax.m_Data[ i ] = std::max( boxMax.m_Data[ i ], worldCorner.m_Data[ i ] );
+                    }
+                }
+            }
+            else
+            {
+                boxMin = boxMax = BenchMath::TransformPoint( Rasterizer::SVector3( 0.f, 0.f, 0.f ), worldMatrix );
+            }
+
+            for ( uint32_t i = 0; i < 3; ++i )
+            {
+                draw.m_Center.m_Data[ i ] = ( boxMin.m_Data[ i ] + boxMax.m_Data[ i ] ) * 0.5f;
+                m_BoundsMin.m_Data[ i ] = std::min( m_BoundsMin.m_Data[ i ], boxMin.m_Data[ i ] );
+                m_BoundsMax.m_Data[ i ] = std::max( m_BoundsMax.m_Data[ i ], boxMax.m_Data[ i ] );
+            }
+
+            if ( FindAttribute( model, primitive, "NORMAL", &accessor ) && accessor->type == TINYGLTF_TYPE_VEC3 )
+            {
+                draw.m_NormalStream = TranslateAccessor( model, m_Buffers, *accessor, 12 );
+            }
+
+            if ( FindAttribute( model, primitive, "TEXCOORD_0", &accessor ) && accessor->type == TINYGLTF_TYPE_VEC2 )
+            {
+                draw.m_TexcoordStream = TranslateAccessor( model, m_Buffers, *accessor, 8 );
+            }
+
+            if ( FindAttribute( model, primitive, "COLOR_0", &accessor ) && ( accessor->type == TINYGLTF_TYPE_VEC3 || accessor->type == TINYGLTF_TYPE_VEC4 ) )
+            {
+                draw.m_ColorStream = TranslateAccessor( model, m_Buffers, *accessor, accessor->type == TINYGLTF_TYPE_VEC3 ? 12 : 16 );
+            }
+
+            if ( primitive.indices != -1 )
+            {
+                const tinygltf::Accessor& indexAccessor = model.accessors[ primitive.indices ];
+                const bool is32BitIndex = indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT || indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_INT;
+                const bool is16BitIndex = indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT || indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_SHORT;
+                if ( indexAccessor.type != TINYGLTF_TYPE_SCALAR || ( !is32BitIndex && !is16BitIndex ) )
+                {
+                    continue;
+                }
+                draw.m_IndexStream = TranslateAccessor( model, m_Buffers, indexAccessor, is32BitIndex ? 4 : 2 );
+                draw.m_IndexType = is32BitIndex ? Rasterizer::EIndexType::e32bit : Rasterizer::EIndexType::e16bit;
+                draw.m_PrimitiveCount = (uint32_t)indexAccessor.count / 3;
+            }
+
+            // The specular-glossiness extension is not supported, the metallic-roughness base color is used instead
+            draw.m_Material.m_Diffuse = Rasterizer::SVector4( 1.f, 1.f, 1.f, 1.f );
+            draw.m_Material.m_Specular = Rasterizer::SVector3( 0.f, 0.f, 0.f );
+            draw.m_Material.m_Power = 1.f;
+            if ( primitive.material != -1 )
+            {
+                const tinygltf::Material& material = model.materials[ primitive.material ];
+                const std::vector<double>& baseColorFactor = material.pbrMetallicRoughness.baseColorFactor;
+                draw.m_Material.m_Diffuse = Rasterizer::SVector4( (float)baseColorFactor[ 0 ], (float)baseColorFactor[ 1 ], (float)baseColorFactor[ 2 ], (float)baseColorFactor[ 3 ] );
+
+                const int32_t diffuseTexture = material.pbrMetallicRoughness.baseColorTexture.index;
+                if ( diffuseTexture != -1 && model.textures[ diffuseTexture ].source != -1 )
+                {
+                    draw.m_DiffuseTexture = m_Images[ model.textures[ diffuseTexture ].source ];
+                }
+
+                draw.m_AlphaRef = (uint8_t)( material.alphaCutoff * 255.f + 0.5f );
+                draw.m_AlphaTest = material.alphaMode == "MASK";
+                draw.m_AlphaBlend = material.alphaMode == "BLEND";
+                draw.m_TwoSided = material.doubleSided;
+            }
+
+            m_Draws.push_back( draw );
+        }
+    }
+
+    return true;
+}
+
+void CBenchScene::CreateSpheres( uint32_t spheresCountPerAxis, uint32_t segmentsCount, bool textured )
+{
+    struct SVertex
+    {
+        float m_Position[ 3 ];
+        float m_Normal[ 3 ];
+        float m_Texcoord[ 2 ];
+    };
+
+    // Rings from the north to the south pole, the seam vertices are duplicated for the texcoords
+    const uint32_t ringsCount = segmentsCount / 2;
+    const uint32_t verticesCount = ( ringsCount + 1 ) * ( segmentsCount + 1 );
+    const uint32_t trianglesCount = ringsCount * segmentsCount * 2;
+    assert( verticesCount <= 0x10000 );
+
+    const uint32_t vertexBufferSize = verticesCount * sizeof( SVertex );
+    const uint32_t indexBufferSize = trianglesCount * 3 * sizeof( uint16_t );
+    m_Buffers.emplace_back( vertexBufferSize + indexBufferSize );
+    uint8_t* buffer = m_Buffers.back().data();
+
+    SVertex* vertex = (SVertex*)buffer;
+    for ( uint32_t ring = 0; ring <= ringsCount; ++ring )
+    {
+        const float theta = 3.141592654f * ring / ringsCount;
+        for ( uint32_t segment = 0; segment <= segmentsCount; ++segment )
+        {
+            const float phi = 2.f * 3.141592654f * segment / segmentsCount;
+            const float normal[ 3 ] = { sinf( theta ) * cosf( phi ), cosf( theta ), sinf( theta ) * sinf( phi ) };
+            memcpy( vertex->m_Position, normal, sizeof( normal ) );
+            memcpy( vertex->m_Normal, normal, sizeof( normal ) );
+            vertex->m_Texcoord[ 0 ] = (float)segment / segmentsCount;
+            vertex->m_Texcoord[ 1 ] = (float)ring / ringsCount;
+            ++vertex;
+        }
+    }
+
+    uint16_t* index = (uint16_t*)( buffer + vertexBufferSize );
+    for ( uint32_t ring = 0; ring < ringsCount; ++ring )
+    {
+        for ( uint32_t segment = 0; segment < segmentsCount; ++segment )
+        {
+            const uint16_t v0 = (uint16_t)( ring * ( segmentsCount + 1 ) + segment );
+            const uint16_t v1 = (uint16_t)( v0 + segmentsCount + 1 );
+            const uint16_t quad[ 6 ] = { v0, (uint16_t)( v0 + 1 ), v1, (uint16_t)( v0 + 1 ), (uint16_t)( v1 + 1 ), v1 };
+            memcpy( index, quad, sizeof( quad ) );
+            index += 6;
+        }
+    }
+
+    if ( textured )
+    {
+        m_Images.emplace_back();
+        CreateCheckerImage( 256, 32, m_TextureLayout, m_TextureFormat, &m_Images.back() );
+    }
+
+    const float spacing = 2.5f;
+    const float centerMin = -( spheresCountPerAxis - 1.f ) * spacing * 0.5f;
+    for ( uint32_t z = 0; z < spheresCountPerAxis; ++z )
+    {
+        for ( uint32_t y = 0; y < spheresCountPerAxis; ++y )
+        {
+            for ( uint32_t x = 0; x < spheresCountPerAxis; ++x )
+            {
+                SBenchMeshDraw draw;
+                draw.m_Center = Rasterizer::SVector3( centerMin + spacing * x, centerMin + spacing * y, centerMin + spacing * z );
+                draw.m_WorldMatrix = BenchMath::Translation( draw.m_Center.m_X, draw.m_Center.m_Y, draw.m_Center.m_Z );
+                draw.m_PositionStream = Rasterizer::SStream( offsetof( SVertex, m_Position ), sizeof( SVertex ), vertexBufferSize, buffer );
+                draw.m_NormalStream = Rasterizer::SStream( offsetof( SVertex, m_Normal ), sizeof( SVertex ), vertexBufferSize, buffer );
+                draw.m_TexcoordStream = Rasterizer::SStream( offsetof( SVertex, m_Texcoord ), sizeof( SVertex ), vertexBufferSize, buffer );
+                draw.m_IndexStream = Rasterizer::SStream( vertexBufferSize, sizeof( uint16_t ), indexBufferSize, buffer );
+                draw.m_IndexType = Rasterizer::EIndexType::e16bit;
+                draw.m_PrimitiveCount = trianglesCount;
+                draw.m_Material = { { 1.f, 1.f, 1.f, 1.f }, { 0.f, 0.f, 0.f }, 1.f };
+                draw.m_DiffuseTexture = textured ? m_Images.back() : Rasterizer::SImage();
+                m_Draws.push_back( draw );
+            }
+        }
+    }
+
+    const float extent = -centerMin + 1.f;
+    m_BoundsMin = Rasterizer::SVector3( -extent, -extent, -extent );
+    m_BoundsMax = Rasterizer::SVector3( extent, extent, extent );
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Rasterizer.h"
+
+// Mirrors SMeshDrawCommand of the demos, without the DirectXMath types
+struct SBenchMeshDraw
+{
+    Rasterizer::SMatrix m_WorldMatrix;
+    Rasterizer::SVector3 m_Center; // World space center of the bounding box
+    Rasterizer::SStream m_PositionStream;
+    Rasterizer::SStream m_NormalStream;
+    Rasterizer::SStream m_TexcoordStream;
+    Rasterizer::SStream m_ColorStream;
+    Rasterizer::SStream m_IndexStream;
+    Rasterizer::EIndexType m_IndexType = Rasterizer::EIndexType::e16bit;
+    uint32_t m_PrimitiveCount = 0;
+    Rasterizer::SMaterial m_Material;
+    Rasterizer::SImage m_DiffuseTexture = {};
+    uint8_t m_AlphaRef = 0;
+    bool m_AlphaTest = false;
+    bool m_AlphaBlend = false;
+    bool m_TwoSided = false;
+};
+
+// A glTF scene loaded without WIC or DirectXMath, flipped to left hand coordinate like the demos do
+class CBenchScene
+{
+public:
+    // The textures are stored in textureLayout and textureFormat
+    explicit CBenchScene( Rasterizer::ETextureLayout textureLayout = Rasterizer::ETextureLayout::eLinear,
+        Rasterizer::ETextureFormat textureFormat = Rasterizer::ETextureFormat::eB8G8R8A8 )
+        : m_TextureLayout( textureLayout )
+        , m_TextureFormat( textureFormat )
+    {
+    }
+
+    CBenchScene( const CBenchScene& ) = delete;
+    CBenchScene& operator=( const CBenchScene& ) = delete;
+    ~CBenchScene();
+
+    bool LoadFromGLTFFile( const std::string& filename );
+
+    // Stand-in for the glTF files, a grid of UV spheres with normals and texcoords, textured with a checker if requested
+    void CreateSpheres( uint32_t spheresCountPerAxis, uint32_t segmentsCount, bool textured );
+
+    std::vector<SBenchMeshDraw> m_Draws;
+    Rasterizer::SVector3 m_BoundsMin = Rasterizer::SVector3( 0.f, 0.f, 0.f );
+    Rasterizer::SVector3 m_BoundsMax = Rasterizer::SVector3( 0.f, 0.f, 0.f );
+
+private:
+    std::vector<std::vector<uint8_t>> m_Buffers;
+    std::vector<Rasterizer::SImage> m_Images;
+    Rasterizer::ETextureLayout m_TextureLayout;
+    Rasterizer::ETextureFormat m_TextureFormat;
+};
+
+// Decodes an image file to 32bpp BGRA followed by its mip levels. The texels are stored in layout, or compressed unless format is eB8G8R8A8
+bool LoadImageFromFile( const std::string& filename, Rasterizer::ETextureLayout layout, Rasterizer::ETextureFormat format, Rasterizer::SImage* image );
+
+// Stand-in for the image files, a checker of two colors with its mip levels
+void CreateCheckerImage( uint32_t size, uint32_t checkerSize, Rasterizer::ETextureLayout layout, Rasterizer::ETextureFormat format, Rasterizer::SImage* image );
+
+void FreeImage( Rasterizer::SImage* image );
+
+// Writes a 32bpp BGRA image to a PNG file
+bool SaveImageToFile( const std::string& filename, const Rasterizer::SImage& image );
+
+// Decodes reference BC7 blocks of every mode with DecompressImage and compares them with their expected texels, prints the mismatches
+bool CheckTextureDecoding();
@@ -37,9 +37,22 @@ static bool CreateTextureFromFile( IWICImagingFactory* factory, const wchar_t* f
         return false;
     }
 
+    // The mip levels follow the first one
     const uint32_t byteSize = texture->m_Width * texture->m_Height * 4;
-    texture->m_Bits = (uint8_t*)malloc( byteSize );
-    return SUCCEEDED( convertedFrame->CopyPixels( nullptr, texture->m_Width * 4, byteSize, (BYTE*)texture->m_Bits ) );
+    texture->m_MipLevelsCount = Rasterizer::GetMipLevelsCount( texture->m_Width, texture->m_Height );
+    texture->m_Bits = (uint8_t*)malloc( Rasterizer::GetImageByteSize( texture->m_Width, texture->m_Height, texture->m_MipLevelsCount ) );
+    if ( FAILED( convertedFrame->CopyPixels( nullptr, texture->m_Width * 4, byteSize, (BYTE*)texture->m_Bits ) ) )
+    {
+        return false;
+    }
+    Rasterizer::GenerateMips( *texture );
+
+    // The cubes rotate freely, the swizzled layout keeps the texels sampled by any rotation in few cache lines
+    uint8_t* swizzledBits = (uint8_t*)malloc( Rasterizer::GetImageByteSize( texture->m_Width, texture->m_Height, texture->m_MipLevelsCount, Rasterizer::ETextureLayout::eSwizzled ) );
+    uint8_t* linearBits = texture->m_Bits;
+    *texture = Rasterizer::SwizzleImage( *texture, swizzledBits );
+    free( linearBits );
+    return true;
 }
 
 class CDemoApp_Cubes : public CDemoApp
@@ -65,6 +78,7 @@ class CDemoApp_Cubes : public CDemoApp
 
     uint32_t m_CurrentTextureIndex = 0;
     bool m_AlphaTestEnabled = false;
+    Rasterizer::ETextureFilter m_TextureFilter = Rasterizer::ETextureFilter::eTrilinear;
     Rasterizer::ECullMode m_CullMode = Rasterizer::ECullMode::eCullCW;
 
     float m_Roll = 0.f, m_Pitch = 0.f, m_Yall = 0.f;
@@ -89,6 +103,10 @@ bool CDemoApp_Cubes::OnWndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM l
             {
                 m_CullMode = (Rasterizer::ECullMode)( ( (uint32_t)m_CullMode + 1 ) % 3 );
             }
+            else if ( wParam == 'F' )
+            {
+                m_TextureFilter = (Rasterizer::ETextureFilter)( ( (uint32_t)m_TextureFilter + 1 ) % 3 );
+            }
         }
         break;
     }
@@ -249,16 +267,13 @@ void CDemoApp_Cubes::OnDestroy()
 
 void CDemoApp_Cubes::OnUpdate()
 {
+    Rasterizer::BeginFrame();
+
     m_Yall += XMConvertToRadians( 0.5f );
     m_Roll += XMConvertToRadians( 0.3f );
 
     ZeroMemory( m_RenderTarget.m_Bits, m_RenderTarget.m_Width * m_RenderTarget.m_Height * 4 );
-    float* depthBit = (float*)m_DepthTarget.m_Bits;
-    for ( uint32_t i = 0; i < m_DepthTarget.m_Width * m_DepthTarget.m_Height; ++i )
-    {
-        *depthBit = 1.f;
-        ++depthBit;
-    }
+    Rasterizer::ClearDepthTarget( 1.f );
 
     Rasterizer::SVector4 diffuseColors[] = { { 1.f, 1.f, 1.0f, 1.0f }, { 0.8f, 0.4f, 0.0f, 1.0f }, { 0.8f, 0.2f, 0.5f, 1.0f }, { 0.3f, 0.5f, 0.28f, 1.0f } };
 
@@ -279,6 +294,7 @@ void CDemoApp_Cubes::OnUpdate()
 
     Rasterizer::SPipelineState pipelineState( true, false );
     pipelineState.m_EnableAlphaTest = m_AlphaTestEnabled;
+    pipelineState.m_TextureFilter = m_TextureFilter;
     Rasterizer::SetPipelineState( pipelineState );
 
     Rasterizer::SetAlphaRef( 0x80 );
@@ -85,12 +85,7 @@ bool CDemoApp_HelloTriangle::OnInit()
     Rasterizer::SetPipelineState( pipelineState );
 
     ZeroMemory( renderTarget.m_Bits, renderTarget.m_Width * renderTarget.m_Height * 4 );
-    float* depthBit = (float*)depthTarget.m_Bits;
-    for ( uint32_t i = 0; i < depthTarget.m_Width * depthTarget.m_Height; ++i )
-    {
-        *depthBit = 1.f;
-        ++depthBit;
-    }
+    Rasterizer::ClearDepthTarget( 1.f );
 
     Rasterizer::Draw( 0, 1 );
 
@@ -90,15 +90,12 @@ void CDemoApp_Lighting::DestroyRenderData()
 
 void CDemoApp_Lighting::OnUpdate()
 {
+    Rasterizer::BeginFrame();
+
     m_LightOrbitAngle += XMConvertToRadians( 0.5f );
 
     ZeroMemory( m_RenderTarget.m_Bits, m_RenderTarget.m_Width * m_RenderTarget.m_Height * 4 );
-    float* depthBit = (float*)m_DepthTarget.m_Bits;
-    for ( uint32_t i = 0; i < m_DepthTarget.m_Width * m_DepthTarget.m_Height; ++i )
-    {
-        *depthBit = 1.f;
-        ++depthBit;
-    }
+    Rasterizer::ClearDepthTarget( 1.f );
 
     Rasterizer::SMatrix matrix;
 
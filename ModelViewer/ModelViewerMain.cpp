@@ -177,6 +177,8 @@ void CDemoApp_ModelViewer::UpdateCamera()
 
 void CDemoApp_ModelViewer::OnUpdate()
 {
+    Rasterizer::BeginFrame();
+
     UpdateCamera();
 
     XMMATRIX cameraWorldMatrix = XMMatrixTranslation( 0.f, 0.f, m_CameraMode == ECameraMode::Orbit ? -m_CameraDistance : 0.f );
@@ -206,12 +208,7 @@ void CDemoApp_ModelViewer::OnUpdate()
     }
 
     ZeroMemory( m_RenderTarget.m_Bits, m_RenderTarget.m_Width * m_RenderTarget.m_Height * 4 );
-    float* depthBit = (float*)m_DepthTarget.m_Bits;
-    for ( uint32_t i = 0; i < m_DepthTarget.m_Width * m_DepthTarget.m_Height; ++i )
-    {
-        *depthBit = 1.f;
-        ++depthBit;
-    }
+    Rasterizer::ClearDepthTarget( 1.f );
 
     Rasterizer::SMatrix matrix;
 
@@ -247,6 +244,7 @@ void CDemoApp_ModelViewer::OnUpdate()
         pipelineState.m_UseVertexColor = command.m_ColorStream.m_Data != nullptr;
         pipelineState.m_EnableAlphaTest = command.m_AlphaTest;
         pipelineState.m_EnableAlphaBlend = command.m_AlphaBlend;
+        pipelineState.m_TextureFilter = Rasterizer::ETextureFilter::eTrilinear;
         Rasterizer::SetPipelineState( pipelineState );
 
         if ( command.m_IndexStream.m_Data )
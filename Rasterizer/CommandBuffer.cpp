@@ -0,0 +1,276 @@
+#include "PCH.h"
+#include "Rasterizer.h"
+
+using namespace Rasterizer;
+
+enum class ECommand : uint8_t
+{
+    eSetPositionStream,
+    eSetNormalStream,
+    eSetTexcoordStream,
+    eSetColorStream,
+    eSetIndexStream,
+    eSetWorldViewTransform,
+    eSetProjectionTransform,
+    eSetViewport,
+    eSetRenderTarget,
+    eSetDepthTarget,
+    eClearDepthTarget,
+    eSetMaterialDiffuse,
+    eSetMaterial,
+    eSetLight,
+    eSetTexture,
+    eSetAlphaRef,
+    eSetEnableDepthWrite,
+    eSetCullMode,
+    eSetIndexType,
+    eSetPipelineState,
+    eDraw,
+    eDrawIndexed, // Scans the indices for their range
+    eDrawIndexedRange,
+};
+
+// Shared by the three draw commands, the unused fields are still recorded to keep a single layout
+struct SDrawCommand
+{
+    uint32_t baseVertexLocation;
+    uint32_t baseIndexLocation;
+    uint32_t trianglesCount;
+    uint32_t minVertexIndex;
+    uint32_t verticesCount;
+};
+
+template <typename T>
+static inline T ReadPayload( const uint8_t** cursor )
+{
+    static_assert( std::is_trivially_copyable<T>::value, "Command payloads are copied as bytes" );
+    T payload;
+    memcpy( &payload, *cursor, sizeof( T ) ); // The payloads are packed, so not aligned
+    *cursor += sizeof( T );
+    return payload;
+}
+
+void CCommandBuffer::Record( uint8_t command, const void* payload, size_t payloadSize )
+{
+    const size_t offset = m_Commands.size();
+    m_Commands.resize( offset + 1 + payloadSize );
+    m_Commands[ offset ] = command;
+    memcpy( m_Commands.data() + offset + 1, payload, payloadSize );
+}
+
+void CCommandBuffer::Reset()
+{
+    m_Commands.clear();
+}
+
+void CCommandBuffer::SetPositionStream( const SStream& stream )
+{
+    Record( (uint8_t)ECommand::eSetPositionStream, &stream, sizeof( stream ) );
+}
+
+void CCommandBuffer::SetNormalStream( const SStream& stream )
+{
+    Record( (uint8_t)ECommand::eSetNormalStream, &stream, sizeof( stream ) );
+}
+
+void CCommandBuffer::SetTexcoordStream( const SStream& stream )
+{
+    Record( (uint8_t)ECommand::eSetTexcoordStream, &stream, sizeof( stream ) );
+}
+
+void CCommandBuffer::SetColorStream( const SStream& stream )
+{
+    Record( (uint8_t)ECommand::eSetColorStream, &stream, sizeof( stream ) );
+}
+
+void CCommandBuffer::SetIndexStream( const SStream& stream )
+{
+    Record( (uint8_t)ECommand::eSetIndexStream, &stream, sizeof( stream ) );
+}
+
+void CCommandBuffer::SetWorldViewTransform( const SMatrix& matrix )
+{
+    Record( (uint8_t)ECommand::eSetWorldViewTransform, &matrix, sizeof( matrix ) );
+}
+
+void CCommandBuffer::SetProjectionTransform( const SMatrix& matrix )
+{
+    Record( (uint8_t)ECommand::eSetProjectionTransform, &matrix, sizeof( matrix ) );
+}
+
+void CCommandBuffer::SetViewport( const SViewport& viewport )
+{
+    Record( (uint8_t)ECommand::eSetViewport, &viewport, sizeof( viewport ) );
+}
+
+void CCommandBuffer::SetRenderTarget( const SImage& image )
+{
+    Record( (uint8_t)ECommand::eSetRenderTarget, &image, sizeof( image ) );
+}
+
+void CCommandBuffer::SetDepthTarget( const SImage& image )
+{
+    Record( (uint8_t)ECommand::eSetDepthTarget, &image, sizeof( image ) );
+}
+
+void CCommandBuffer::ClearDepthTarget( float depth )
+{
+    Record( (uint8_t)ECommand::eClearDepthTarget, &depth, sizeof( depth ) );
+}
+
+void CCommandBuffer::SetMaterialDiffuse( SVector4 color )
+{
+    Record( (uint8_t)ECommand::eSetMaterialDiffuse, &color, sizeof( color ) );
+}
+
+void CCommandBuffer::SetMaterial( const SMaterial& material )
+{
+    Record( (uint8_t)ECommand::eSetMaterial, &material, sizeof( material ) );
+}
+
+void CCommandBuffer::SetLight( const SLight& light )
+{
+    Record( (uint8_t)ECommand::eSetLight, &light, sizeof( light ) );
+}
+
+void CCommandBuffer::SetTexture( const SImage& image )
+{
+    Record( (uint8_t)ECommand::eSetTexture, &image, sizeof( image ) );
+}
+
+void CCommandBuffer::SetAlphaRef( uint8_t value )
+{
+    Record( (uint8_t)ECommand::eSetAlphaRef, &value, sizeof( value ) );
+}
+
+void CCommandBuffer::SetEnableDepthWrite( bool enable )
+{
+    Record( (uint8_t)ECommand::eSetEnableDepthWrite, &enable, sizeof( enable ) );
+}
+
+void CCommandBuffer::SetCullMode( ECullMode mode )
+{
+    Record( (uint8_t)ECommand::eSetCullMode, &mode, sizeof( mode ) );
+}
+
+void CCommandBuffer::SetIndexType( EIndexType type )
+{
+    Record( (uint8_t)ECommand::eSetIndexType, &type, sizeof( type ) );
+}
+
+void CCommandBuffer::SetPipelineState( const SPipelineState& state )
+{
+    Record( (uint8_t)ECommand::eSetPipelineState, &state, sizeof( state ) );
+}
+
+void CCommandBuffer::Draw( uint32_t baseVertexIndex, uint32_t trianglesCount )
+{
+    const SDrawCommand command = { baseVertexIndex, 0, trianglesCount, 0, 0 };
+    Record( (uint8_t)ECommand::eDraw, &command, sizeof( command ) );
+}
+
+void CCommandBuffer::DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount )
+{
+    const SDrawCommand command = { baseVertexLocation, baseIndexLocation, trianglesCount, 0, 0 };
+    Record( (uint8_t)ECommand::eDrawIndexed, &command, sizeof( command ) );
+}
+
+void CCommandBuffer::DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount, uint32_t minVertexIndex, uint32_t verticesCount )
+{
+    const SDrawCommand command = { baseVertexLocation, baseIndexLocation, trianglesCount, minVertexIndex, verticesCount };
+    Record( (uint8_t)ECommand::eDrawIndexedRange, &command, sizeof( command ) );
+}
+
+void CContext::ExecuteCommandBuffer( const CCommandBuffer& commandBuffer )
+{
+    const uint8_t* cursor = commandBuffer.m_Commands.data();
+    const uint8_t* end = cursor + commandBuffer.m_Commands.size();
+    while ( cursor < end )
+    {
+        const ECommand command = (ECommand)*cursor++;
+        switch ( command )
+        {
+        case ECommand::eSetPositionStream:
+            SetPositionStream( ReadPayload<SStream>( &cursor ) );
+            break;
+        case ECommand::eSetNormalStream:
+            SetNormalStream( ReadPayload<SStream>( &cursor ) );
+            break;
+        case ECommand::eSetTexcoordStream:
+            SetTexcoordStream( ReadPayload<SStream>( &cursor ) );
+            break;
+        case ECommand::eSetColorStream:
+            SetColorStream( ReadPayload<SStream>( &cursor ) );
+            break;
+        case ECommand::eSetIndexStream:
+            SetIndexStream( ReadPayload<SStream>( &cursor ) );
+            break;
+        case ECommand::eSetWorldViewTransform:
+            SetWorldViewTransform( ReadPayload<SMatrix>( &cursor ) );
+            break;
+        case ECommand::eSetProjectionTransform:
+            SetProjectionTransform( ReadPayload<SMatrix>( &cursor ) );
+            break;
+        case ECommand::eSetViewport:
+            SetViewport( ReadPayload<SViewport>( &cursor ) );
+            break;
+        case ECommand::eSetRenderTarget:
+            SetRenderTarget( ReadPayload<SImage>( &cursor ) );
+            break;
+        case ECommand::eSetDepthTarget:
+            SetDepthTarget( ReadPayload<SImage>( &cursor ) );
+            break;
+        case ECommand::eClearDepthTarget:
+            ClearDepthTarget( ReadPayload<float>( &cursor ) );
+            break;
+        case ECommand::eSetMaterialDiffuse:
+            SetMaterialDiffuse( ReadPayload<SVector4>( &cursor ) );
+            break;
+        case ECommand::eSetMaterial:
+            SetMaterial( ReadPayload<SMaterial>( &cursor ) );
+            break;
+        case ECommand::eSetLight:
+            SetLight( ReadPayload<SLight>( &cursor ) );
+            break;
+        case ECommand::eSetTexture:
+            SetTexture( ReadPayload<SImage>( &cursor ) );
+            break;
+        case ECommand::eSetAlphaRef:
+            SetAlphaRef( ReadPayload<uint8_t>( &cursor ) );
+            break;
+        case ECommand::eSetEnableDepthWrite:
+            SetEnableDepthWrite( ReadPayload<bool>( &cursor ) );
+            break;
+        case ECommand::eSetCullMode:
+            SetCullMode( ReadPayload<ECullMode>( &cursor ) );
+            break;
+        case ECommand::eSetIndexType:
+            SetIndexType( ReadPayload<EIndexType>( &cursor ) );
+            break;
+        case ECommand::eSetPipelineState:
+            SetPipelineState( ReadPayload<SPipelineState>( &cursor ) );
+            break;
+        case ECommand::eDraw:
+        {
+            const SDrawCommand draw = ReadPayload<SDrawCommand>( &cursor );
+            Draw( draw.baseVertexLocation, draw.trianglesCount );
+            break;
+        }
+        case ECommand::eDrawIndexed:
+        {
+            const SDrawCommand draw = ReadPayload<SDrawCommand>( &cursor );
+            DrawIndexed( draw.baseVertexLocation, draw.baseIndexLocation, draw.trianglesCount );
+            break;
+        }
+        case ECommand::eDrawIndexedRange:
+        {
+            const SDrawCommand draw = ReadPayload<SDrawCommand>( &cursor );
+            DrawIndexed( draw.baseVertexLocation, draw.baseIndexLocation, draw.trianglesCount, draw.minVertexIndex, draw.verticesCount );
+            break;
+        }
+        default:
+            assert( false );
+            return;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include "PCH.h"
+#include "FrameTrace.h"
+
+void CFrameTrace::Start( const char* filenamePrefix )
+{
+    Stop();
+    m_FilenamePrefix = filenamePrefix;
+    m_FrameIndex = 0;
+    m_IsStarted = true;
+}
+
+void CFrameTrace::Stop()
+{
+    if ( m_IsRecording )
+    {
+        WriteFrame();
+    }
+    m_IsStarted = false;
+    m_IsRecording = false;
+}
+
+void CFrameTrace::BeginFrame()
+{
+    if ( m_IsRecording )
+    {
+        WriteFrame();
+        ++m_FrameIndex;
+    }
+    m_IsRecording = m_IsStarted;
+    m_FrameStart = std::chrono::steady_clock::now();
+}
+
+void CFrameTrace::WriteFrame()
+{
+    const std::string filename = m_FilenamePrefix + std::to_string( m_FrameIndex ) + ".json";
+    FILE* file = fopen( filename.c_str(), "w" );
+    if ( file )
+    {
+        fprintf( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+        // Name the lanes of the threads which have any event
+        uint32_t threadsCount = 1;
+        for ( const SEvent& event : m_Events )
+        {
+            threadsCount = std::max( threadsCount, event.threadIndex + 1 );
+        }
+        fprintf( file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"Draw thread\"}}" );
+        for ( uint32_t i = 1; i < threadsCount; ++i )
+        {
+            fprintf( file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"Raster worker %u\"}}", i, i );
+        }
+
+        // Complete events, the timestamps are in microseconds
+        for ( const SEvent& event : m_Events )
+        {
+            fprintf( file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{", event.name, event.threadIndex,
+                event.begin * 1e-3, ( event.end - event.begin ) * 1e-3 );
+            for ( uint32_t i = 0; i < 2 && event.argNames[ i ]; ++i )
+            {
+                fprintf( file, "%s\"%s\":%lld", i > 0 ? "," : "", event.argNames[ i ], (long long)event.argValues[ i ] );
+            }
+            fprintf( file, "}}" );
+        }
+
+        fprintf( file, "\n]}\n" );
+        fclose( file );
+    }
+    m_Events.clear();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#if defined( RASTERIZER_ENABLE_TRACE )
+#define RASTERIZER_TRACE( statement ) statement
+#else
+#define RASTERIZER_TRACE( statement )
+#endif
+
+// Timeline of the draws of one frame, written as Chrome trace event JSON which chrome://tracing and ui.perfetto.dev open.
+// Events are only added from the thread calling the draws, the raster workers hand theirs over through the raster jobs
+class CFrameTrace
+{
+public:
+    struct SEvent
+    {
+        const char* name;
+        uint64_t begin; // Nanoseconds since the start of the frame
+        uint64_t end;
+        uint32_t threadIndex; // 0 is the thread calling the draws, the raster workers start from 1
+        const char* argNames[ 2 ]; // Null for the unused arguments
+        int64_t argValues[ 2 ];
+    };
+
+    // Every frame from the next call to BeginFrame on is written to <filenamePrefix><frame number>.json
+    void Start( const char* filenamePrefix );
+
+    // Writes the frame being recorded if any
+    void Stop();
+
+    // Writes the frame being recorded if any and starts recording the next one
+    void BeginFrame();
+
+    bool IsRecording() const
+    {
+        return m_IsRecording;
+    }
+
+    uint64_t Now() const
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - m_FrameStart ).count();
+    }
+
+    void AddEvent( const SEvent& event )
+    {
+        m_Events.push_back( event );
+    }
+
+private:
+    void WriteFrame();
+
+    std::string m_FilenamePrefix;
+    std::vector<SEvent> m_Events;
+    std::chrono::steady_clock::time_point m_FrameStart;
+    uint32_t m_FrameIndex = 0;
+    bool m_IsStarted = false;
+    bool m_IsRecording = false;
+};
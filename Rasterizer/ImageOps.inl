@@ -9,6 +9,17 @@ static inline void R8G8B8A8Unorm_To_Float( uint32_t rgba, float* r, float* g, fl
     *b = ( rgba & 0xFF ) * denorm;
 }
 
+static inline void __vectorcall R8G8B8A8Unorm_To_Float( SIMDMath::VInt rgba, SIMDMath::VFloat* r, SIMDMath::VFloat* g, SIMDMath::VFloat* b, SIMDMath::VFloat* a )
+{
+    using namespace SIMDMath;
+    const VFloat denorm = Set1( 1.f / 255.f );
+    const VInt byteMask = Set1( 0xFF );
+    *a = Mul( ConvertToFloat( And( ShiftRightLogical( rgba, 24 ), byteMask ) ), denorm );
+    *r = Mul( ConvertToFloat( And( ShiftRightLogical( rgba, 16 ), byteMask ) ), denorm );
+    *g = Mul( ConvertToFloat( And( ShiftRightLogical( rgba, 8 ), byteMask ) ), denorm );
+    *b = Mul( ConvertToFloat( And( rgba, byteMask ) ), denorm );
+}
+
 /*  Bilinear filtering
     |----|----|
     | v0 | v1 |
@@ -35,24 +46,131 @@ static inline void SampleTexture_PointClamp( const Rasterizer::SImage& texture,
     R8G8B8A8Unorm_To_Float( texel, r, g, b, a );
 }
 
+static inline void __vectorcall SampleTexture_PointClamp( const Rasterizer::SImage& texture, SIMDMath::VFloat texU, SIMDMath::VFloat texV,
+    SIMDMath::VFloat* r, SIMDMath::VFloat* g, SIMDMath::VFloat* b, SIMDMath::VFloat* a )
+{
+    using namespace SIMDMath;
+    const VInt maxX = Set1( int32_t( texture.m_Width - 1 ) );
+    const VInt maxY = Set1( int32_t( texture.m_Height - 1 ) );
+    const VInt zero = Set1( 0 );
+    const VInt texelPosX = Max( Min( ConvertToInt( Mul( texU, Set1( (float)texture.m_Width ) ) ), maxX ), zero );
+    const VInt texelPosY = Max( Min( ConvertToInt( Mul( texV, Set1( (float)texture.m_Height ) ) ), maxY ), zero );
+    const VInt texel = Gather( (const uint32_t*)texture.m_Bits, Add( Mul( texelPosY, Set1( (int32_t)texture.m_Width ) ), texelPosX ) );
+    R8G8B8A8Unorm_To_Float( texel, r, g, b, a );
+}
+
+// Offsets of the texels of a row and of a column from the first texel of their mip level, their sum is the offset of the texel
+template <Rasterizer::ETextureLayout Layout>
+static inline SIMDMath::VInt __vectorcall TexelRowOffset( SIMDMath::VInt texelPosY, SIMDMath::VInt pitch )
+{
+    using namespace SIMDMath;
+    if ( Layout == Rasterizer::ETextureLayout::eSwizzled )
+    {
+        // The bits of y go to the odd bits of the Morton index inside of the block
+        const VInt mortonY = Or( ShiftLeft( And( texelPosY, Set1( 1 ) ), 1 ), ShiftLeft( And( texelPosY, Set1( 2 ) ), 2 ) );
+        return Add( Mul( ShiftRightLogical( texelPosY, 2 ), pitch ), mortonY );
+    }
+    return Mul( texelPosY, pitch );
+}
+
+template <Rasterizer::ETextureLayout Layout>
+static inline SIMDMath::VInt __vectorcall TexelColumnOffset( SIMDMath::VInt texelPosX )
+{
+    using namespace SIMDMath;
+    if ( Layout == Rasterizer::ETextureLayout::eSwizzled )
+    {
+        // The bits of x go to the even bits of the Morton index inside of the block
+        const VInt mortonX = Or( And( texelPosX, Set1( 1 ) ), ShiftLeft( And( texelPosX, Set1( 2 ) ), 1 ) );
+        return Add( ShiftLeft( ShiftRightLogical( texelPosX, 2 ), 4 ), mortonX );
+    }
+    return texelPosX;
+}
+
+// Texels of the block compressed texture at the positions of every lane, offset and pitch count the blocks of the mip level.
+// Every lane decodes its block to the cache unless the cache holds it already, as the lanes of a pixel block mostly read the same
+// few blocks. The slots of odd levels are offset by 4x4 blocks so that the two levels of trilinear filtering don't evict each other
+static inline SIMDMath::VInt __vectorcall FetchCompressedTexels( const Rasterizer::SImage& texture, STextureBlockCache* blockCache, SIMDMath::VInt level,
+    SIMDMath::VInt offset, SIMDMath::VInt pitch, SIMDMath::VInt texelPosX, SIMDMath::VInt texelPosY )
+{
+    using namespace SIMDMath;
+    const VInt blockX = ShiftRightLogical( texelPosX, 2 );
+    const VInt blockY = ShiftRightLogical( texelPosY, 2 );
+    const VInt slotOffset = ShiftLeft( And( level, Set1( 1 ) ), 2 );
+    const VInt slotMask = Set1( 7 );
+    const VInt texelMask = Set1( 3 );
+
+    alignas( SIMD_PIXEL_WIDTH * 4 ) int32_t blockIndices[ SIMD_PIXEL_WIDTH ], slots[ SIMD_PIXEL_WIDTH ], texelIndices[ SIMD_PIXEL_WIDTH ];
+    Store( blockIndices, Add( offset, Add( Mul( blockY, pitch ), blockX ) ) );
+    Store( slots, Or( ShiftLeft( And( Add( blockY, slotOffset ), slotMask ), 3 ), And( Add( blockX, slotOffset ), slotMask ) ) );
+    Store( texelIndices, Or( ShiftLeft( And( texelPosY, texelMask ), 2 ), And( texelPosX, texelMask ) ) );
+
+    const Rasterizer::ETextureFormat format = texture.m_Format;
+    const size_t blockByteSize = GetBlockByteSize( format );
+    alignas( SIMD_PIXEL_WIDTH * 4 ) int32_t texels[ SIMD_PIXEL_WIDTH ];
+    for ( uint32_t lane = 0; lane < SIMD_PIXEL_WIDTH; ++lane )
+    {
+        const uint8_t* block = texture.m_Bits + blockIndices[ lane ] * blockByteSize;
+        const int32_t slot = slots[ lane ];
+        if ( blockCache->blocks[ slot ] != block )
+        {
+            DecodeTextureBlock( format, block, blockCache->texels[ slot ] );
+            blockCache->blocks[ slot ] = block;
+        }
+        texels[ lane ] = int32_t( blockCache->texels[ slot ][ texelIndices[ lane ] ] );
+    }
+    return Load( texels );
+}
+
+// Texels at the positions of every lane in its mip level, the block compressed textures are decoded through blockCache
+template <Rasterizer::ETextureLayout Layout, bool IsCompressed>
+static inline SIMDMath::VInt __vectorcall FetchTexels( const Rasterizer::SImage& texture, STextureBlockCache* blockCache, SIMDMath::VInt level,
+    SIMDMath::VInt offset, SIMDMath::VInt pitch, SIMDMath::VInt texelPosX, SIMDMath::VInt texelPosY )
+{
+    using namespace SIMDMath;
+    if ( IsCompressed )
+    {
+        return FetchCompressedTexels( texture, blockCache, level, offset, pitch, texelPosX, texelPosY );
+    }
+    const VInt texelOffset = Add( TexelRowOffset<Layout>( texelPosY, pitch ), TexelColumnOffset<Layout>( texelPosX ) );
+    return Gather( (const uint32_t*)texture.m_Bits, Add( offset, texelOffset ) );
+}
+
+// Point sampling of the mip level of each lane
+template <Rasterizer::ETextureLayout Layout, bool IsCompressed>
+static inline void __vectorcall SampleTexture_PointClamp( const Rasterizer::SImage& texture, const STextureMipLevels& mipLevels, STextureBlockCache* blockCache,
+    SIMDMath::VInt level, SIMDMath::VFloat texU, SIMDMath::VFloat texV, SIMDMath::VFloat* r, SIMDMath::VFloat* g, SIMDMath::VFloat* b, SIMDMath::VFloat* a )
+{
+    using namespace SIMDMath;
+    const VInt width = Gather( (const uint32_t*)mipLevels.widths, level );
+    const VInt height = Gather( (const uint32_t*)mipLevels.heights, level );
+    const VInt pitch = Gather( (const uint32_t*)mipLevels.pitches, level );
+    const VInt offset = Gather( (const uint32_t*)mipLevels.offsets, level );
+    const VInt zero = Set1( 0 );
+    const VInt one = Set1( 1 );
+    const VInt texelPosX = Max( Min( ConvertToInt( Mul( texU, ConvertToFloat( width ) ) ), Sub( width, one ) ), zero );
+    const VInt texelPosY = Max( Min( ConvertToInt( Mul( texV, ConvertToFloat( height ) ) ), Sub( height, one ) ), zero );
+    const VInt texel = FetchTexels<Layout, IsCompressed>( texture, blockCache, level, offset, pitch, texelPosX, texelPosY );
+    R8G8B8A8Unorm_To_Float( texel, r, g, b, a );
+}
+
 static inline void SampleTexture_LinearClamp( const Rasterizer::SImage& texture, float texU, float texV, float* r, float* g, float* b, float* a )
 {
     const float texelPosXf = texU * texture.m_Width - 0.5f;
     const float texelPosYf = texV * texture.m_Height - 0.5f;
-    int32_t texelPosMinX = (int32_t)std::floorf( texelPosXf );
-    int32_t texelPosMinY = (int32_t)std::floorf( texelPosYf );
+    int32_t texelPosMinX = (int32_t)std::floor( texelPosXf );
+    int32_t texelPosMinY = (int32_t)std::floor( texelPosYf );
     int32_t texelPosMaxX = texelPosMinX + 1;
     int32_t texelPosMaxY = texelPosMinY + 1;
     const float texelFractionX = texelPosXf - texelPosMinX;
     const float texelFractionY = texelPosYf - texelPosMinY;
 
-    // Clamp to texture border
+    // Clamp to texture border, both ends as the texcoords of the lanes out of the triangle may be anything
     const int32_t maxX = texture.m_Width - 1;
     const int32_t maxY = texture.m_Height - 1;
-    texelPosMinX = std::max( 0, texelPosMinX );
-    texelPosMinY = std::max( 0, texelPosMinY );
-    texelPosMaxX = std::min( maxX, texelPosMaxX );
-    texelPosMaxY = std::min( maxY, texelPosMaxY );
+    texelPosMinX = std::min( maxX, std::max( 0, texelPosMinX ) );
+    texelPosMinY = std::min( maxY, std::max( 0, texelPosMinY ) );
+    texelPosMaxX = std::min( maxX, std::max( 0, texelPosMaxX ) );
+    texelPosMaxY = std::min( maxY, std::max( 0, texelPosMaxY ) );
 
     uint32_t* texelBits = (uint32_t*)texture.m_Bits;
     uint32_t rgba0 = texelBits[ texelPosMinY * texture.m_Width + texelPosMinX ];
@@ -73,4 +191,67 @@ static inline void SampleTexture_LinearClamp( const Rasterizer::SImage& texture,
     *g = BilinearInterpolation( texelFractionX, texelFractionY, g0, g1, g2, g3 );
     *b = BilinearInterpolation( texelFractionX, texelFractionY, b0, b1, b2, b3 );
     *a = BilinearInterpolation( texelFractionX, texelFractionY, a0, a1, a2, a3 );
-}
\ No newline at end of file
+}
+
+// Lerps the 8 bit channels of the texels of every lane, weight is in [0, 256] and weights b.
+// The even and odd channels are spread over the 16 bit halves of the lanes, so one 16 bit multiply weights two channels
+// and a * ( 256 - weight ) + b * weight + 128 fits in the 16 bits of its channel
+static inline SIMDMath::VInt __vectorcall LerpTexels( SIMDMath::VInt a, SIMDMath::VInt b, SIMDMath::VInt weight )
+{
+    using namespace SIMDMath;
+    const VInt evenMask = Set1( 0x00FF00FF );
+    const VInt oddMask = Set1( int32_t( 0xFF00FF00 ) );
+    const VInt round = Set1( 0x00800080 );
+    const VInt weightB = Or( weight, ShiftLeft( weight, 16 ) );
+    const VInt weightA = Sub( Set1( 0x01000100 ), weightB );
+    const VInt even = Add( Add( Mul16( And( a, evenMask ), weightA ), Mul16( And( b, evenMask ), weightB ) ), round );
+    const VInt odd = Add( Add( Mul16( And( ShiftRightLogical( a, 8 ), evenMask ), weightA ), Mul16( And( ShiftRightLogical( b, 8 ), evenMask ), weightB ) ), round );
+    return Or( And( ShiftRightLogical( even, 8 ), evenMask ), And( odd, oddMask ) );
+}
+
+// Bilinear sampling of the mip level of each lane, the filtered texels are returned packed as R8G8B8A8.
+// The four texels of every lane are fetched and filtered with 8 bits of subtexel precision, all lanes at once
+template <Rasterizer::ETextureLayout Layout, bool IsCompressed>
+static inline SIMDMath::VInt __vectorcall SampleTexels_LinearClamp( const Rasterizer::SImage& texture, const STextureMipLevels& mipLevels, STextureBlockCache* blockCache,
+    SIMDMath::VInt level, SIMDMath::VFloat texU, SIMDMath::VFloat texV )
+{
+    using namespace SIMDMath;
+    const VInt width = Gather( (const uint32_t*)mipLevels.widths, level );
+    const VInt height = Gather( (const uint32_t*)mipLevels.heights, level );
+    const VInt pitch = Gather( (const uint32_t*)mipLevels.pitches, level );
+    const VInt offset = Gather( (const uint32_t*)mipLevels.offsets, level );
+    const VInt zero = Set1( 0 );
+    const VInt one = Set1( 1 );
+    const VInt fractionMask = Set1( 0xFF );
+
+    // Sample positions from the top left texel center in 24.8 fixed point, offset by one texel so the conversion truncates
+    // positive numbers. The lanes further out are clamped to the border like their texels
+    const VFloat fixedScale = Set1( 256.f );
+    const VFloat fixedOffset = Set1( 128.f );
+    const VInt posX = Max( ConvertToInt( MulAdd( texU, Mul( ConvertToFloat( width ), fixedScale ), fixedOffset ) ), zero );
+    const VInt posY = Max( ConvertToInt( MulAdd( texV, Mul( ConvertToFloat( height ), fixedScale ), fixedOffset ) ), zero );
+    const VInt texelPosX = Sub( ShiftRightLogical( posX, 8 ), one );
+    const VInt texelPosY = Sub( ShiftRightLogical( posY, 8 ), one );
+    const VInt maxX = Sub( width, one );
+    const VInt maxY = Sub( height, one );
+    const VInt minX = Min( Max( texelPosX, zero ), maxX );
+    const VInt nextX = Min( Add( texelPosX, one ), maxX );
+    const VInt minY = Min( Max( texelPosY, zero ), maxY );
+    const VInt nextY = Min( Add( texelPosY, one ), maxY );
+
+    const VInt rgba0 = FetchTexels<Layout, IsCompressed>( texture, blockCache, level, offset, pitch, minX, minY );
+    const VInt rgba1 = FetchTexels<Layout, IsCompressed>( texture, blockCache, level, offset, pitch, nextX, minY );
+    const VInt rgba2 = FetchTexels<Layout, IsCompressed>( texture, blockCache, level, offset, pitch, minX, nextY );
+    const VInt rgba3 = FetchTexels<Layout, IsCompressed>( texture, blockCache, level, offset, pitch, nextX, nextY );
+
+    const VInt alpha = And( posX, fractionMask );
+    const VInt beta = And( posY, fractionMask );
+    return LerpTexels( LerpTexels( rgba0, rgba1, alpha ), LerpTexels( rgba2, rgba3, alpha ), beta );
+}
+
+template <Rasterizer::ETextureLayout Layout, bool IsCompressed>
+static inline void __vectorcall SampleTexture_LinearClamp( const Rasterizer::SImage& texture, const STextureMipLevels& mipLevels, STextureBlockCache* blockCache,
+    SIMDMath::VInt level, SIMDMath::VFloat texU, SIMDMath::VFloat texV, SIMDMath::VFloat* r, SIMDMath::VFloat* g, SIMDMath::VFloat* b, SIMDMath::VFloat* a )
+{
+    R8G8B8A8Unorm_To_Float( SampleTexels_LinearClamp<Layout, IsCompressed>( texture, mipLevels, blockCache, level, texU, texV ), r, g, b, a );
+}
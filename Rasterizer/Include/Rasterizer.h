@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
 namespace Rasterizer
 {
     struct alignas( 16 ) SMatrix
@@ -121,11 +125,37 @@ namespace Rasterizer
         uint32_t m_Height;
     };
 
+    // Order of the texels of an image in memory. eLinear stores the rows one after the other, eSwizzled stores blocks of 4x4 texels
+    // one after the other in rows of blocks and the texels of a block in Morton order, so texels close in 2D are close in memory.
+    // eTiled is only for render and depth targets, it stores tiles of 64x64 pixels one after the other in rows of tiles and the rows
+    // of a tile one after the other, so the pixels rasterized by a job are contiguous. Drawing to it requires a viewport whose top left
+    // corner is a multiple of 64 pixels, ResolveImage copies it to the linear layout
+    enum class ETextureLayout : uint8_t
+    {
+        eLinear,
+        eSwizzled,
+        eTiled
+    };
+
+    // Format of the texels of an image. eB8G8R8A8 stores 32bpp texels, the block compressed formats store blocks of 4x4 texels one after
+    // the other in rows of blocks, 8 bytes per block for eBC1 and 16 bytes for eBC3 and eBC7. Their levels are padded to whole blocks and
+    // their layout is ignored. The alpha of eBC1 is 0 or 255 and only read by the alpha test and blending
+    enum class ETextureFormat : uint8_t
+    {
+        eB8G8R8A8,
+        eBC1,
+        eBC3,
+        eBC7
+    };
+
     struct SImage
     {
         uint8_t* m_Bits;
         uint32_t m_Width;
         uint32_t m_Height;
+        uint32_t m_MipLevelsCount = 1; // Only read from textures, the levels follow each other in m_Bits from the full size one. 0 is the same as 1
+        ETextureLayout m_Layout = ETextureLayout::eLinear; // Textures are eLinear or eSwizzled, render and depth targets eLinear or eTiled
+        ETextureFormat m_Format = ETextureFormat::eB8G8R8A8; // Only read from textures, render targets are eB8G8R8A8
     };
 
     enum class ECullMode : uint8_t
@@ -153,6 +183,22 @@ namespace Rasterizer
         eCount
     };
 
+    // Filtering of the texture samples, ePoint and eBilinear read the nearest mip level, eTrilinear blends the two nearest ones
+    enum class ETextureFilter : uint8_t
+    {
+        ePoint,
+        eBilinear,
+        eTrilinear
+    };
+
+    enum class EInstructionSet : uint8_t
+    {
+        eSSE41,
+        eAVX2,
+        eAVX512,
+        eCount
+    };
+
     struct SPipelineState
     {
         SPipelineState()
@@ -162,16 +208,18 @@ namespace Rasterizer
             , m_UseVertexColor( false )
             , m_EnableAlphaTest( false )
             , m_EnableAlphaBlend( false )
+            , m_TextureFilter( ETextureFilter::ePoint )
         {}
         
         SPipelineState( bool useTexture, bool useVertexColor, bool enableAlphaTest = false, bool enableAlphaBlend = false
-            , ELightingModel lightingModel = ELightingModel::eUnlit, ELightType lightType = ELightType::eDirectional )
+            , ELightingModel lightingModel = ELightingModel::eUnlit, ELightType lightType = ELightType::eDirectional, ETextureFilter textureFilter = ETextureFilter::ePoint )
             : m_LightingModel( lightingModel )
             , m_LightType( lightType )
             , m_UseTexture( useTexture )
             , m_UseVertexColor( useVertexColor )
             , m_EnableAlphaTest( enableAlphaTest )
             , m_EnableAlphaBlend( enableAlphaBlend )
+            , m_TextureFilter( textureFilter )
         {
         }
 
@@ -181,9 +229,248 @@ namespace Rasterizer
         bool m_UseVertexColor;
         bool m_EnableAlphaTest;
         bool m_EnableAlphaBlend;
+        ETextureFilter m_TextureFilter;
+    };
+
+    // Totals of the draws since the last BeginFrame. They are only gathered when the library is built with RASTERIZER_ENABLE_STATS,
+    // otherwise they stay zero. The times are the wall time of each stage on the thread calling the draws, in nanoseconds
+    struct SFrameStats
+    {
+        uint64_t m_VertexTransformTime;
+        uint64_t m_ClippingTime;
+        uint64_t m_PerspectiveDivisionTime;
+        uint64_t m_TriangleSetupTime;
+        uint64_t m_BinningTime;
+        uint64_t m_RasterizationTime;
+
+        uint64_t m_DrawsCount;
+        uint64_t m_VerticesTransformed;
+        uint64_t m_TrianglesSubmitted;
+        uint64_t m_TrianglesFrustumCulled; // Outside one of the frustum planes
+        uint64_t m_TrianglesBackFaceCulled; // Back facing in clip space, the clipped triangles are left to triangle setup
+        uint64_t m_TrianglesClipped; // Crossing the near plane or the guard band
+        uint64_t m_TrianglesSetupCulled; // Back facing after snapping, covering no pixel center or behind the Hi-Z
+        uint64_t m_TrianglesRasterized;
+
+        uint64_t m_PixelsTested; // Covered by a triangle in the blocks the Hi-Z doesn't reject
+        uint64_t m_PixelsDepthPassed;
+        uint64_t m_PixelsAlphaKilled;
+        uint64_t m_PixelsWritten;
+    };
+
+    // Threads running the jobs of the draws, along with the threads calling them
+    struct SJobSystemDesc
+    {
+        SJobSystemDesc()
+            : m_WorkersCount( UINT32_MAX )
+            , m_WorkerCpuIndices( nullptr )
+        {}
+
+        uint32_t m_WorkersCount; // UINT32_MAX starts one worker per hardware thread but one
+        const uint32_t* m_WorkerCpuIndices; // The logical processor each worker is pinned to, one entry per worker started. Null leaves the workers unpinned
+    };
+
+    // Number of levels of the mip chain of an image, down to 1x1
+    uint32_t GetMipLevelsCount( uint32_t width, uint32_t height );
+
+    // Size in bytes of the texels of an image along with its mip levels, the swizzled and block compressed levels are padded to whole 4x4 blocks
+    // and the tiled images to whole 64x64 tiles
+    size_t GetImageByteSize( uint32_t width, uint32_t height, uint32_t mipLevelsCount, ETextureLayout layout = ETextureLayout::eLinear,
+        ETextureFormat format = ETextureFormat::eB8G8R8A8 );
+
+    // Computes the mip levels of the linear image from its first level, every texel is the average of 2x2 texels of the level above.
+    // m_Bits must hold GetImageByteSize bytes
+    void GenerateMips( const SImage& image );
+
+    // Copies the texels of the linear image and its mip levels to bits in the swizzled layout and returns the swizzled image.
+    // bits must hold GetImageByteSize bytes of the swizzled layout, the texels padding the blocks repeat the last row and column
+    SImage SwizzleImage( const SImage& image, uint8_t* bits );
+
+    // Compresses the linear image and its mip levels to bits in eBC1 or eBC3 and returns the compressed image. bits must hold GetImageByteSize
+    // bytes of the format. The endpoints of every block are the corners of the bounding box of its colors, which is fast but not the best quality
+    SImage CompressImage( const SImage& image, ETextureFormat format, uint8_t* bits );
+
+    // Decodes the block compressed image and its mip levels to bits in eB8G8R8A8 and returns the linear image, with the texels the samplers read.
+    // bits must hold GetImageByteSize bytes of the linear layout
+    SImage DecompressImage( const SImage& image, uint8_t* bits );
+
+    // Copies the pixels of the tiled render or depth target to bits in the linear layout and returns the linear image, the rows of tiles
+    // are copied in parallel by the job system. bits must hold GetImageByteSize bytes of the linear layout
+    SImage ResolveImage( const SImage& image, uint8_t* bits );
+
+    // Starts the job system workers and selects the kernels, call before drawing with any context
+    void Initialize( const SJobSystemDesc& desc = SJobSystemDesc() );
+
+    bool IsInstructionSetSupported( EInstructionSet instructionSet );
+
+    // Selects the kernels compiled for the instruction set of all contexts, Initialize selects the widest one supported by the host.
+    // No context may be drawing meanwhile
+    bool SetInstructionSet( EInstructionSet instructionSet );
+
+    EInstructionSet GetInstructionSet();
+
+    struct SContextState;
+
+    class CCommandBuffer;
+
+    // Owns the state of the draws and their intermediate memory. Each context can be used by one thread at a time, different contexts can draw
+    // concurrently from different threads. They all share the workers of the job system
+    class CContext
+    {
+    public:
+        CContext();
+
+        ~CContext();
+
+        CContext( const CContext& ) = delete;
+
+        CContext& operator=( const CContext& ) = delete;
+
+        void SetPositionStream( const SStream& stream );
+
+        void SetNormalStream( const SStream& stream );
+
+        void SetTexcoordStream( const SStream& stream );
+
+        void SetColorStream( const SStream& stream );
+
+        void SetIndexStream( const SStream& stream );
+
+        void SetWorldViewTransform( const SMatrix& matrix );
+
+        void SetProjectionTransform( const SMatrix& matrix );
+
+        void SetViewport( const SViewport& viewport );
+
+        void SetRenderTarget( const SImage& image );
+
+        void SetDepthTarget( const SImage& image );
+
+        // Fills the depth target with the depth, it also resets the Hi-Z which is only used from then until the next SetDepthTarget.
+        // Writing to the depth target without calling this function requires calling SetDepthTarget again
+        void ClearDepthTarget( float depth );
+
+        void SetMaterialDiffuse( SVector4 color );
+
+        void SetMaterial( const SMaterial& material );
+
+        void SetLight( const SLight& light );
+
+        void SetTexture( const SImage& image );
+
+        void SetAlphaRef( uint8_t value );
+
+        void SetEnableDepthWrite( bool enable );
+
+        void SetCullMode( ECullMode mode );
+
+        void SetIndexType( EIndexType type );
+
+        void SetPipelineState( const SPipelineState& state );
+
+        // Recycles the intermediate memory of the draws, call once at the beginning of each frame
+        void BeginFrame();
+
+        // Returns the high-water mark of the intermediate memory used by the draws, in bytes
+        size_t GetFrameMemoryPeakUsage();
+
+        const SFrameStats& GetFrameStats();
+
+        // Records the draws of every frame from the next BeginFrame on, each frame is written to <filenamePrefix><frame number>.json as Chrome trace events
+        // when the next one begins. Returns false when the library is built without RASTERIZER_ENABLE_TRACE
+        bool StartFrameTrace( const char* filenamePrefix );
+
+        // Writes the frame being recorded and stops recording
+        void StopFrameTrace();
+
+        // Preallocates the intermediate memory of the draws, e.g. with the peak usage measured in a previous run
+        void ReserveFrameMemory( size_t size );
+
+        void Draw( uint32_t baseVertexIndex, uint32_t trianglesCount );
+
+        // Only the vertices referenced by the indices are processed, their range is found by scanning the indices
+        void DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount );
+
+        // Same as above but skips the scan, all the indices must be in [minVertexIndex, minVertexIndex + verticesCount)
+        void DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount, uint32_t minVertexIndex, uint32_t verticesCount );
+
+        // Applies the commands of the buffer in the recorded order, same as calling the functions they were recorded with
+        void ExecuteCommandBuffer( const CCommandBuffer& commandBuffer );
+
+    private:
+        SContextState* m_State;
     };
 
-    void Initialize();
+    // Records state changes and draws into a compact buffer, replayed later by CContext::ExecuteCommandBuffer. Recording doesn't touch any context,
+    // so different threads can record different command buffers while another one executes. Streams and images are recorded by reference,
+    // their memory has to stay valid until the command buffer is executed
+    class CCommandBuffer
+    {
+    public:
+        // Drops the recorded commands, the memory is kept for the next recording
+        void Reset();
+
+        bool IsEmpty() const
+        {
+            return m_Commands.empty();
+        }
+
+        void SetPositionStream( const SStream& stream );
+
+        void SetNormalStream( const SStream& stream );
+
+        void SetTexcoordStream( const SStream& stream );
+
+        void SetColorStream( const SStream& stream );
+
+        void SetIndexStream( const SStream& stream );
+
+        void SetWorldViewTransform( const SMatrix& matrix );
+
+        void SetProjectionTransform( const SMatrix& matrix );
+
+        void SetViewport( const SViewport& viewport );
+
+        void SetRenderTarget( const SImage& image );
+
+        void SetDepthTarget( const SImage& image );
+
+        void ClearDepthTarget( float depth );
+
+        void SetMaterialDiffuse( SVector4 color );
+
+        void SetMaterial( const SMaterial& material );
+
+        void SetLight( const SLight& light );
+
+        void SetTexture( const SImage& image );
+
+        void SetAlphaRef( uint8_t value );
+
+        void SetEnableDepthWrite( bool enable );
+
+        void SetCullMode( ECullMode mode );
+
+        void SetIndexType( EIndexType type );
+
+        void SetPipelineState( const SPipelineState& state );
+
+        void Draw( uint32_t baseVertexIndex, uint32_t trianglesCount );
+
+        void DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount );
+
+        void DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount, uint32_t minVertexIndex, uint32_t verticesCount );
+
+    private:
+        friend class CContext;
+
+        void Record( uint8_t command, const void* payload, size_t payloadSize );
+
+        std::vector<uint8_t> m_Commands; // Each command is its type followed by its payload
+    };
+
+    // The context used by the functions below, which forward to it
+    CContext& GetDefaultContext();
 
     void SetPositionStream( const SStream& stream );
 
@@ -205,6 +492,8 @@ namespace Rasterizer
 
     void SetDepthTarget( const SImage& image );
 
+    void ClearDepthTarget( float depth );
+
     void SetMaterialDiffuse( SVector4 color );
 
     void SetMaterial( const SMaterial& material );
@@ -223,7 +512,23 @@ namespace Rasterizer
 
     void SetPipelineState( const SPipelineState& state );
 
+    void BeginFrame();
+
+    size_t GetFrameMemoryPeakUsage();
+
+    const SFrameStats& GetFrameStats();
+
+    bool StartFrameTrace( const char* filenamePrefix );
+
+    void StopFrameTrace();
+
+    void ReserveFrameMemory( size_t size );
+
     void Draw( uint32_t baseVertexIndex, uint32_t trianglesCount );
 
     void DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount );
+
+    void DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount, uint32_t minVertexIndex, uint32_t verticesCount );
+
+    void ExecuteCommandBuffer( const CCommandBuffer& commandBuffer );
 }
\ No newline at end of file
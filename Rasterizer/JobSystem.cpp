@@ -0,0 +1,142 @@
+#include "PCH.h"
+#include "JobSystem.h"
+
+static thread_local uint32_t s_ThreadIndex = 0;
+
+void CJobSystem::Start( uint32_t workersCount, const uint32_t* cpuIndices )
+{
+    Stop();
+    m_Quit = false;
+    m_QueuesCount = workersCount + 1;
+    m_Queues.reset( new SQueue[ m_QueuesCount ] );
+    m_Threads.reserve( workersCount );
+    for ( uint32_t i = 0; i < workersCount; ++i )
+    {
+        m_Threads.emplace_back( &CJobSystem::WorkerMain, this, i + 1 );
+        if ( cpuIndices )
+        {
+            Platform::SetThreadAffinity( m_Threads.back(), cpuIndices[ i ] );
+        }
+    }
+}
+
+void CJobSystem::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_SleepMutex );
+        m_Quit = true;
+    }
+    m_WakeCondition.notify_all();
+    for ( std::thread& thread : m_Threads )
+    {
+        thread.join();
+    }
+    m_Threads.clear();
+    m_Queues.reset();
+    m_QueuesCount = 1;
+}
+
+uint32_t CJobSystem::GetThreadIndex()
+{
+    return s_ThreadIndex;
+}
+
+void CJobSystem::Submit( JobFunctionPtr function, void* data, uint32_t begin, uint32_t end, SJobCounter* counter )
+{
+    counter->pendingJobsCount.fetch_add( 1, std::memory_order_relaxed );
+
+    SQueue& queue = m_Queues[ s_ThreadIndex ];
+    {
+        std::lock_guard<std::mutex> lock( queue.mutex );
+        queue.jobs.push_back( { function, data, begin, end, counter } );
+    }
+    m_QueuedJobsCount.fetch_add( 1, std::memory_order_release );
+
+    // Taking the lock orders the wake up after the check of a worker about to sleep
+    {
+        std::lock_guard<std::mutex> lock( m_SleepMutex );
+    }
+    m_WakeCondition.notify_one();
+}
+
+void CJobSystem::Wait( SJobCounter& counter )
+{
+    while ( counter.pendingJobsCount.load( std::memory_order_acquire ) != 0 )
+    {
+        SJob job;
+        if ( PopOrSteal( s_ThreadIndex, &job ) )
+        {
+            Run( job );
+        }
+        else
+        {
+            // The remaining jobs are running on other threads
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool CJobSystem::PopOrSteal( uint32_t threadIndex, SJob* job )
+{
+    if ( m_QueuedJobsCount.load( std::memory_order_acquire ) == 0 )
+    {
+        return false;
+    }
+
+    // The newest job of its own deque is the most likely to have its data in the cache
+    if ( threadIndex != 0 )
+    {
+        SQueue& queue = m_Queues[ threadIndex ];
+        std::lock_guard<std::mutex> lock( queue.mutex );
+        if ( !queue.jobs.empty() )
+        {
+            *job = queue.jobs.back();
+            queue.jobs.pop_back();
+            m_QueuedJobsCount.fetch_sub( 1, std::memory_order_relaxed );
+            return true;
+        }
+    }
+
+    // Steal the oldest jobs of the others, starting with the next one so the thieves spread over the deques
+    for ( uint32_t i = 1; i <= m_QueuesCount; ++i )
+    {
+        const uint32_t victimIndex = ( threadIndex + i ) % m_QueuesCount;
+        SQueue& queue = m_Queues[ victimIndex ];
+        std::lock_guard<std::mutex> lock( queue.mutex );
+        if ( !queue.jobs.empty() )
+        {
+            *job = queue.jobs.front();
+            queue.jobs.pop_front();
+            m_QueuedJobsCount.fetch_sub( 1, std::memory_order_relaxed );
+            return true;
+        }
+    }
+    return false;
+}
+
+void CJobSystem::Run( const SJob& job )
+{
+    job.function( job.data, job.begin, job.end );
+    job.counter->pendingJobsCount.fetch_sub( 1, std::memory_order_release );
+}
+
+void CJobSystem::WorkerMain( uint32_t threadIndex )
+{
+    s_ThreadIndex = threadIndex;
+    while ( true )
+    {
+        SJob job;
+        if ( PopOrSteal( threadIndex, &job ) )
+        {
+            Run( job );
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock( m_SleepMutex );
+        m_WakeCondition.wait( lock, [this] { return m_Quit || m_QueuedJobsCount.load( std::memory_order_acquire ) != 0; } );
+        if ( m_Quit )
+        {
+            return;
+        }
+    }
+}
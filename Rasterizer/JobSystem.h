@@ -0,0 +1,103 @@
+#pragma once
+
+// Counts the jobs of a batch which are not done yet
+struct SJobCounter
+{
+    std::atomic<uint32_t> pendingJobsCount { 0 };
+};
+
+// Work-stealing scheduler shared by all contexts. Each worker owns a deque, it pops its own jobs from the back and steals the oldest jobs
+// from the front of the other deques. The threads which are not workers push their jobs to a shared deque, and all threads waiting on
+// a counter run jobs meanwhile, so the jobs may also be run by the threads calling the draws
+class CJobSystem
+{
+public:
+    typedef void (*JobFunctionPtr)( void* data, uint32_t begin, uint32_t end );
+
+    ~CJobSystem()
+    {
+        Stop();
+    }
+
+    // cpuIndices is optional, it has one logical processor per worker to pin it to
+    void Start( uint32_t workersCount, const uint32_t* cpuIndices );
+
+    // Must not be called while any job is pending
+    void Stop();
+
+    // Including the threads which are not workers, counted as one
+    uint32_t GetThreadsCount() const
+    {
+        return m_QueuesCount;
+    }
+
+    // 0 for the threads which are not workers, the workers start from 1
+    static uint32_t GetThreadIndex();
+
+    // The counter is incremented right away and decremented once function( data, begin, end ) returns
+    void Submit( JobFunctionPtr function, void* data, uint32_t begin, uint32_t end, SJobCounter* counter );
+
+    // Runs jobs until the counter reaches zero
+    void Wait( SJobCounter& counter );
+
+    // Calls function( begin, end ) over chunks of [0, count) in parallel and returns once all are done. The chunks are at least grainSize long,
+    // the calling thread runs the first one
+    template <typename TFunction>
+    void ParallelFor( uint32_t count, uint32_t grainSize, const TFunction& function )
+    {
+        // A few chunks per thread so the ones running late can be stolen
+        const uint32_t chunksCount = std::min( ( count + grainSize - 1 ) / grainSize, m_QueuesCount * 4 );
+        if ( chunksCount <= 1 || m_Threads.empty() )
+        {
+            if ( count > 0 )
+            {
+                function( 0, count );
+            }
+            return;
+        }
+
+        SJobCounter counter;
+        for ( uint32_t i = 1; i < chunksCount; ++i )
+        {
+            Submit( &InvokeFunction<TFunction>, (void*)&function, uint32_t( uint64_t( count ) * i / chunksCount ), uint32_t( uint64_t( count ) * ( i + 1 ) / chunksCount ), &counter );
+        }
+        function( 0, uint32_t( count / chunksCount ) );
+        Wait( counter );
+    }
+
+private:
+    struct SJob
+    {
+        JobFunctionPtr function;
+        void* data;
+        uint32_t begin;
+        uint32_t end;
+        SJobCounter* counter;
+    };
+
+    struct SQueue
+    {
+        std::mutex mutex;
+        std::deque<SJob> jobs;
+    };
+
+    template <typename TFunction>
+    static void InvokeFunction( void* data, uint32_t begin, uint32_t end )
+    {
+        ( *(const TFunction*)data )( begin, end );
+    }
+
+    bool PopOrSteal( uint32_t threadIndex, SJob* job );
+
+    static void Run( const SJob& job );
+
+    void WorkerMain( uint32_t threadIndex );
+
+    std::vector<std::thread> m_Threads;
+    std::unique_ptr<SQueue[]> m_Queues; // Indexed by the thread index, the first one is shared by the threads which are not workers
+    uint32_t m_QueuesCount = 1;
+    std::atomic<uint32_t> m_QueuedJobsCount { 0 };
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeCondition;
+    bool m_Quit = false;
+};
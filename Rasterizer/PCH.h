@@ -4,9 +4,18 @@
 #include <cstdint>
 #include <cmath>
 #include <algorithm>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 
-#include <SDKDDKVer.h>
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-// Windows Header Files
-#include <windows.h>
+#include "Platform.h"
@@ -0,0 +1,70 @@
+#pragma once
+
+// The only compiler and OS specific bits of the rasterizer, everything else is standard C++ and x86 intrinsics
+
+#include <thread>
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined( __linux__ )
+#include <pthread.h>
+#endif
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#include <cpuid.h>
+
+// Only MSVC has the vector calling convention, the other compilers pass __m128 in registers anyway
+#define __vectorcall
+#endif
+
+namespace Platform
+{
+    inline void Cpuid( int info[ 4 ], int leaf, int subleaf = 0 )
+    {
+#if defined( _MSC_VER )
+        __cpuidex( info, leaf, subleaf );
+#else
+        unsigned int* regs = (unsigned int*)info;
+        __cpuid_count( leaf, subleaf, regs[ 0 ], regs[ 1 ], regs[ 2 ], regs[ 3 ] );
+#endif
+    }
+
+    // The caller must check the OSXSAVE bit first
+    inline uint64_t Xgetbv( uint32_t index )
+    {
+#if defined( _MSC_VER )
+        return _xgetbv( index );
+#else
+        // The intrinsic needs -mxsave on GCC and Clang, which the baseline kernels can't assume
+        uint32_t eax, edx;
+        __asm__ volatile( "xgetbv" : "=a"( eax ), "=d"( edx ) : "c"( index ) );
+        return ( (uint64_t)edx << 32 ) | eax;
+#endif
+    }
+
+    // Pins the thread to one logical processor, returns false when the OS doesn't support it
+    inline bool SetThreadAffinity( std::thread& thread, uint32_t cpuIndex )
+    {
+#if defined( _WIN32 )
+        return cpuIndex < sizeof( DWORD_PTR ) * 8 && SetThreadAffinityMask( (HANDLE)thread.native_handle(), DWORD_PTR( 1 ) << cpuIndex ) != 0;
+#elif defined( __linux__ )
+        if ( cpuIndex >= CPU_SETSIZE )
+        {
+            return false;
+        }
+        cpu_set_t cpuSet;
+        CPU_ZERO( &cpuSet );
+        CPU_SET( cpuIndex, &cpuSet );
+        return pthread_setaffinity_np( thread.native_handle(), sizeof( cpuSet ), &cpuSet ) == 0;
+#else
+        (void)thread;
+        (void)cpuIndex;
+        return false;
+#endif
+    }
+}
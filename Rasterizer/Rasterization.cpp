@@ -1,134 +1,136 @@
 #include "PCH.h"
 #include "Rasterizer.h"
-#include "ImageOps.inl"
+#include "RasterizationKernels.h"
 #include "SIMDMath.inl"
 #include "MathHelper.h"
-
-#define SIMD_WIDTH 4
-
-#define VERTEX_TRANSFORM_FUNCTION_TABLE_SIZE 4
-#define PERSPECTIVE_DIVISION_FUNCTION_TABLE_SIZE 16
-#define TRIANGLE_SETUP_FUNCTION_TABLE_SIZE 16
-#define RASTERIZING_FUNCTION_TABLE_SIZE 128
+#include "FrameTrace.h"
+#include "JobSystem.h"
 
 using namespace Rasterizer;
 
-static const int32_t s_SubpixelStep = 16; // 4 bits sub-pixel precision
+static VertexTransformFunctionPtr s_VertexTransformFunctionTable[ VERTEX_TRANSFORM_FUNCTION_TABLE_SIZE ] = {};
+static PerspectiveDivisionFunctionPtr s_PerspectiveDivisionFunctionTable[ PERSPECTIVE_DIVISION_FUNCTION_TABLE_SIZE ] = {};
+static TriangleSetupFunctionPtr s_TriangleSetupFunctionTable[ TRIANGLE_SETUP_FUNCTION_TABLE_SIZE ] = {};
+static RasterizingFunctionPtr s_RasterizingFunctionTable[ RASTERIZING_FUNCTION_TABLE_SIZE ] = {};
+static ResolveTileFunctionPtr s_ResolveTileFunction = nullptr;
+static EInstructionSet s_InstructionSet = EInstructionSet::eSSE41;
 
-struct alignas( 16 ) SFloat4A
+static SRenderState CreateDefaultRenderState()
 {
-    float m_Data[ 4 ];
-};
+    const SMatrix identity(
+        1.f, 0.f, 0.f, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+        0.f, 0.f, 1.f, 0.f,
+        0.f, 0.f, 0.f, 1.f );
+
+    SRenderState state = {};
+    state.worldViewMatrix = identity;
+    state.normalMatrix = identity;
+    state.worldViewProjectionMatrix = identity;
+    state.cullMode = ECullMode::eCullCW;
+    state.indexType = EIndexType::e16bit;
+    state.enableDepthWrite = true;
+    state.alphaRef = 0;
+    state.material = { { 1.f, 1.f, 1.f, 1.f }, { 1.f, 1.f, 1.f }, 32.f };
+    return state;
+}
 
-struct alignas( 16 ) SInt4A
+#if defined( RASTERIZER_ENABLE_STATS )
+// Adds the time elapsed since the previous lap to the total of a stage
+class CStageTimer
 {
-    int32_t m_Data[ 4 ];
-};
+public:
+    CStageTimer()
+        : m_LapStart( std::chrono::steady_clock::now() )
+    {
+    }
 
-struct STriangleAttribute
-{
-    float row, a, b;
+    void Lap( uint64_t* total )
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        *total += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( now - m_LapStart ).count();
+        m_LapStart = now;
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_LapStart;
 };
+#endif
 
-struct STriangleBaseAttributes
+#if defined( RASTERIZER_ENABLE_TRACE )
+static void AddTraceEvent( CFrameTrace& trace, const char* name, uint64_t begin, uint32_t threadIndex, const char* argName0, int64_t argValue0, const char* argName1 = nullptr, int64_t argValue1 = 0 )
 {
-    int32_t minX, maxX, minY, maxY;
-    int32_t imgMinX, imgY;
-    int32_t w0_row, w1_row, w2_row;
-    int32_t a01, a12, a20;
-    int32_t b01, b12, b20;
-    uint8_t faceSign;
-};
+    CFrameTrace::SEvent event;
+    event.name = name;
+    event.begin = begin;
+    event.end = trace.Now();
+    event.threadIndex = threadIndex;
+    event.argNames[ 0 ] = argName0;
+    event.argNames[ 1 ] = argName1;
+    event.argValues[ 0 ] = argValue0;
+    event.argValues[ 1 ] = argValue1;
+    trace.AddEvent( event );
+}
 
-struct SAttributeStreamPtrs
+// Records an event on the thread calling the draws, spanning from the previous lap
+class CTraceTimer
 {
-    union
+public:
+    CTraceTimer( CFrameTrace& trace )
+        : m_Trace( trace ), m_LapStart( trace.Now() )
     {
-        uint8_t* pos;
-        uint8_t* base;
-    };
-    uint8_t* z;
-    union
-    {
-        uint8_t* w;
-        uint8_t* rcpw;
-    };
-    uint8_t* texcoord;
-    uint8_t* color;
-    uint8_t* normal;
-    uint8_t* viewPos;
-};
+    }
 
-using STriangleSetupInput = SAttributeStreamPtrs;
-using STriangleSetupOutput = SAttributeStreamPtrs;
+    void Lap( const char* name, const char* argName, int64_t argValue )
+    {
+        if ( m_Trace.IsRecording() )
+        {
+            AddTraceEvent( m_Trace, name, m_LapStart, 0, argName, argValue );
+        }
+        m_LapStart = m_Trace.Now();
+    }
 
-typedef void (*VertexTransformFunctionPtr)( const uint8_t*, const uint8_t*, uint8_t*, uint8_t*, uint8_t*, uint32_t, uint32_t, uint32_t, uint32_t );
-typedef void (*PerspectiveDivisionFunctionPtr)( const uint8_t*, const uint8_t*, SAttributeStreamPtrs, uint32_t, uint32_t, uint32_t, uint32_t );
-typedef void (*TriangleSetupFunctionPtr)( const STriangleSetupInput&, const uint8_t*, uint32_t, STriangleSetupOutput, uint32_t, uint32_t, uint32_t );
-typedef void (*RasterizingFunctionPtr)( STriangleSetupOutput, uint32_t, uint32_t );
+private:
+    CFrameTrace& m_Trace;
+    uint64_t m_LapStart;
+};
 
-static VertexTransformFunctionPtr s_VertexTransformFunctionTable[ VERTEX_TRANSFORM_FUNCTION_TABLE_SIZE ] = {};
-static PerspectiveDivisionFunctionPtr s_PerspectiveDivisionFunctionTable[ PERSPECTIVE_DIVISION_FUNCTION_TABLE_SIZE ] = {};
-static TriangleSetupFunctionPtr s_TriangleSetupFunctionTable[ TRIANGLE_SETUP_FUNCTION_TABLE_SIZE ] = {};
-static RasterizingFunctionPtr s_RasterizingFunctionTable[ RASTERIZING_FUNCTION_TABLE_SIZE ] = {};
+// Records an event on the thread calling the draws, spanning the lifetime of the scope
+class CTraceScope
+{
+public:
+    CTraceScope( CFrameTrace& trace, const char* name, const char* argName0, int64_t argValue0, const char* argName1, int64_t argValue1 )
+        : m_Trace( trace ), m_Name( name ), m_ArgName0( argName0 ), m_ArgName1( argName1 ), m_ArgValue0( argValue0 ), m_ArgValue1( argValue1 ), m_Begin( trace.Now() )
+    {
+    }
 
-static SPipelineState s_PipelineState;
-static VertexTransformFunctionPtr s_VertexTransformFunction = nullptr;
-static PerspectiveDivisionFunctionPtr s_PerspectiveDivisionFunction = nullptr;
-static TriangleSetupFunctionPtr s_TriangleSetupFunction = nullptr;
-static RasterizingFunctionPtr s_RasterizingFunction = nullptr;
+    ~CTraceScope()
+    {
+        if ( m_Trace.IsRecording() )
+        {
+            AddTraceEvent( m_Trace, m_Name, m_Begin, 0, m_ArgName0, m_ArgValue0, m_ArgName1, m_ArgValue1 );
+        }
+    }
 
-static bool s_EnableDepthWrite = true;
-static ECullMode s_CullMode = ECullMode::eCullCW;
+private:
+    CFrameTrace& m_Trace;
+    const char* m_Name;
+    const char* m_ArgName0;
+    const char* m_ArgName1;
+    int64_t m_ArgValue0;
+    int64_t m_ArgValue1;
+    uint64_t m_Begin;
+};
 
-static SMatrix s_WorldViewMatrix =
-    {
-        1.f, 0.f, 0.f, 0.f,
-        0.f, 1.f, 0.f, 0.f,
-        0.f, 0.f, 1.f, 0.f,
-        0.f, 0.f, 0.f, 1.f,
-    };
-static SMatrix s_NormalMatrix =
-    {
-        1.f, 0.f, 0.f, 0.f,
-        0.f, 1.f, 0.f, 0.f,
-        0.f, 0.f, 1.f, 0.f,
-        0.f, 0.f, 0.f, 1.f,
-    };
-static SMatrix s_ProjectionMatrix =
-    {
-        1.f, 0.f, 0.f, 0.f,
-        0.f, 1.f, 0.f, 0.f,
-        0.f, 0.f, 1.f, 0.f,
-        0.f, 0.f, 0.f, 1.f,
-    };
-static SMatrix s_WorldViewProjectionMatrix = 
-    {
-        1.f, 0.f, 0.f, 0.f,
-        0.f, 1.f, 0.f, 0.f,
-        0.f, 0.f, 1.f, 0.f,
-        0.f, 0.f, 0.f, 1.f,
-    };
-static uint8_t s_AlphaRef = 0;
-static SMaterial s_Material = { { 1.f, 1.f, 1.f, 1.f }, { 1.f, 1.f, 1.f }, 32.f };
-static SLight s_Light;
-
-static SViewport s_Viewport = { 0 };
-static int32_t s_RasterCoordStartX = 0;
-static int32_t s_RasterCoordStartY = 0;
-static int32_t s_RasterCoordEndX = 0;
-static int32_t s_RasterCoordEndY = 0;
-
-static SStream s_StreamSourcePos;
-static SStream s_StreamSourceTex;
-static SStream s_StreamSourceColor;
-static SStream s_StreamSourceNormal;
-static SStream s_StreamSourceIndex;
-static EIndexType s_IndexType = EIndexType::e16bit;
-
-static SImage s_RenderTarget = { 0 };
-static SImage s_DepthTarget = { 0 };
-static SImage s_Texture = { 0 };
+// Time span of one slot of a raster job
+struct SRasterLane
+{
+    uint64_t begin;
+    uint64_t end;
+    uint32_t threadIndex;
+    uint32_t tilesCount;
+};
+#endif
 
 static inline __m128 GatherMatrixColumn( const SMatrix& m, uint32_t column )
 {
@@ -213,1144 +215,556 @@ static SMatrix MatrixMultiply4x4( const SMatrix& lhs, const SMatrix& rhs )
     return result;
 }
 
-static void UpdateNormalMatrix()
+static void UpdateNormalMatrix( SRenderState& state )
 {
     // TODO: This is incorrect if world matrix contains non-uniform scaling
-    s_NormalMatrix = s_WorldViewMatrix;
+    state.normalMatrix = state.worldViewMatrix;
 }
 
-static void UpdateWorldViewProjectionMatrix()
+static void UpdateWorldViewProjectionMatrix( SRenderState& state, const SMatrix& projectionMatrix )
 {
-    s_WorldViewProjectionMatrix = MatrixMultiply4x4( s_WorldViewMatrix, s_ProjectionMatrix );
+    state.worldViewProjectionMatrix = MatrixMultiply4x4( state.worldViewMatrix, projectionMatrix );
 }
 
-static inline __m128 __vectorcall GatherFloat4( const uint8_t* stream, uint32_t stride )
+struct SRasterJob
 {
-    SFloat4A float4;
-    float4.m_Data[ 0 ] = *(float*)( stream );
-    float4.m_Data[ 1 ] = *(float*)( stream + stride );
-    float4.m_Data[ 2 ] = *(float*)( stream + stride + stride );
-    float4.m_Data[ 3 ] = *(float*)( stream + stride + stride + stride );
-    return _mm_load_ps( float4.m_Data );
-}
+    RasterizingFunctionPtr function;
+    const SRenderState* state;
+    STriangleSetupOutput triangles;
+    uint32_t trianglesStride;
+    const uint32_t* binnedTriangles; // Triangle indices of all tiles, each tile keeps the submission order
+    const uint32_t* binOffsets; // Offset to the first triangle index of each tile in binnedTriangles, the last element is the total count
+    const uint32_t* activeTiles; // Indices of the tiles which have any triangle binned
+    uint32_t activeTilesCount;
+    uint32_t tilesCountX;
+    std::atomic<uint32_t> nextTile;
+#if defined( RASTERIZER_ENABLE_STATS )
+    std::mutex statsMutex;
+    SRasterStats stats;
+#endif
+#if defined( RASTERIZER_ENABLE_TRACE )
+    const CFrameTrace* trace;
+    SRasterLane* lanes; // One per slot while the frame is traced, null otherwise
+#endif
+};
 
-static inline void __vectorcall ScatterFloat4( __m128 value, uint8_t* stream, uint32_t stride )
+// Each slot runs on one thread, the slots grab tiles until all active tiles are taken
+static void ExecuteRasterJob( SRasterJob& job, [[maybe_unused]] uint32_t slot )
 {
-    SFloat4A float4;
-    _mm_store_ps( float4.m_Data, value );
-    *(float*)( stream ) = float4.m_Data[ 0 ];
-    *(float*)( stream + stride ) = float4.m_Data[ 1 ];
-    *(float*)( stream + stride + stride ) = float4.m_Data[ 2 ];
-    *(float*)( stream + stride + stride + stride ) = float4.m_Data[ 3 ];
-}
-
-static inline void __vectorcall ScatterInt4( __m128i value, uint8_t* stream, uint32_t stride )
-{
-    SInt4A int4;
-    _mm_store_si128( (__m128i*)int4.m_Data, value );
-    *(int32_t*)( stream ) = int4.m_Data[ 0 ];
-    *(int32_t*)( stream + stride ) = int4.m_Data[ 1 ];
-    *(int32_t*)( stream + stride + stride ) = int4.m_Data[ 2 ];
-    *(int32_t*)( stream + stride + stride + stride ) = int4.m_Data[ 3 ];
-}
-
-template <bool UseNormal, bool UseViewPos>
-static void TransformVertices( 
-    const uint8_t* inPos,
-    const uint8_t* inNormal,
-    uint8_t* outPos,
-    uint8_t* outNormal,
-    uint8_t* outViewPos,
-    uint32_t posStride,
-    uint32_t normalStride,
-    uint32_t outStride,
-    uint32_t count
-    )
-{
-    assert( count % SIMD_WIDTH == 0 );
-    const uint32_t batchCount = count / SIMD_WIDTH;
-
-    __m128 m00 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 0 ] );
-    __m128 m01 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 1 ] );
-    __m128 m02 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 2 ] );
-    __m128 m03 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 3 ] );
-    __m128 m10 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 4 ] );
-    __m128 m11 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 5 ] );
-    __m128 m12 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 6 ] );
-    __m128 m13 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 7 ] );
-    __m128 m20 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 8 ] );
-    __m128 m21 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 9 ] );
-    __m128 m22 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 10 ] );
-    __m128 m23 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 11 ] );
-    __m128 m30 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 12 ] );
-    __m128 m31 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 13 ] );
-    __m128 m32 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 14 ] );
-    __m128 m33 = _mm_set1_ps( s_WorldViewProjectionMatrix.m_Data[ 15 ] );
-
-    __m128 n00, n01, n02, n10, n11, n12, n20, n21, n22, n30, n31, n32;
-    if ( UseViewPos )
-    {
-        n00 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 0 ] );
-        n01 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 1 ] );
-        n02 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 2 ] );
-        n10 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 4 ] );
-        n11 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 5 ] );
-        n12 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 6 ] );
-        n20 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 8 ] );
-        n21 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 9 ] );
-        n22 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 10 ] );
-        n30 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 12 ] );
-        n31 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 13 ] );
-        n32 = _mm_set1_ps( s_WorldViewMatrix.m_Data[ 14 ] );
-    }
+    // Every slot counts the pixels on its own and merges them once it is done with the job
+    SRasterStats* stats = nullptr;
+    RASTERIZER_STATS( SRasterStats threadStats = {}; stats = &threadStats; )
 
-    for ( uint32_t i = 0; i < batchCount; ++i )
-    {
-        __m128 x = GatherFloat4( inPos, posStride );
-        __m128 y = GatherFloat4( sizeof( float ) + inPos, posStride );
-        __m128 z = GatherFloat4( sizeof( float ) * 2 + inPos, posStride );
-        __m128 dotX, dotY, dotZ, dotW;
-
-        // Clip space position
-        SIMDMath::Vec3DotVec4( x, y, z, m00, m10, m20, m30, dotX );
-        SIMDMath::Vec3DotVec4( x, y, z, m01, m11, m21, m31, dotY );
-        SIMDMath::Vec3DotVec4( x, y, z, m02, m12, m22, m32, dotZ );
-        SIMDMath::Vec3DotVec4( x, y, z, m03, m13, m23, m33, dotW );
-        ScatterFloat4( dotX, outPos, outStride );
-        ScatterFloat4( dotY, sizeof( float ) + outPos, outStride );
-        ScatterFloat4( dotZ, sizeof( float ) * 2 + outPos, outStride );
-        ScatterFloat4( dotW, sizeof( float ) * 3 + outPos, outStride );
-
-        inPos += SIMD_WIDTH * posStride;
-        outPos += SIMD_WIDTH * outStride;
-
-        if ( UseViewPos )
-        { 
-            // Get view space position
-            SIMDMath::Vec3DotVec4( x, y, z, n00, n10, n20, n30, dotX );
-            SIMDMath::Vec3DotVec4( x, y, z, n01, n11, n21, n31, dotY );
-            SIMDMath::Vec3DotVec4( x, y, z, n02, n12, n22, n32, dotZ );
-            ScatterFloat4( dotX, outViewPos, outStride );
-            ScatterFloat4( dotY, sizeof(float) + outViewPos, outStride );
-            ScatterFloat4( dotZ, sizeof(float) * 2 + outViewPos, outStride );
-
-            outViewPos += SIMD_WIDTH * outStride;
-        }
+    RASTERIZER_TRACE( const uint64_t laneBegin = job.lanes ? job.trace->Now() : 0; uint32_t laneTilesCount = 0; )
+
+    uint32_t activeTileIndex;
+    while ( ( activeTileIndex = job.nextTile.fetch_add( 1, std::memory_order_relaxed ) ) < job.activeTilesCount )
+    {
+        const uint32_t tileIndex = job.activeTiles[ activeTileIndex ];
+        const int32_t tileX = int32_t( tileIndex % job.tilesCountX );
+        const int32_t tileY = int32_t( tileIndex / job.tilesCountX );
+
+        SRasterTile tile;
+        const SViewport& viewport = job.state->viewport;
+        tile.minX = viewport.m_Left + tileX * s_TileSize;
+        tile.minY = viewport.m_Top + tileY * s_TileSize;
+        tile.maxX = std::min( tile.minX + s_TileSize, int32_t( viewport.m_Left + viewport.m_Width ) ) - 1;
+        tile.maxY = std::min( tile.minY + s_TileSize, int32_t( viewport.m_Top + viewport.m_Height ) ) - 1;
+
+        const uint32_t binOffset = job.binOffsets[ tileIndex ];
+        const uint32_t binSize = job.binOffsets[ tileIndex + 1 ] - binOffset;
+        job.function( *job.state, job.triangles, job.trianglesStride, job.binnedTriangles + binOffset, binSize, tile, stats );
+        RASTERIZER_TRACE( ++laneTilesCount; )
     }
 
-    if ( UseNormal )
-    { 
-        m00 = _mm_set1_ps( s_NormalMatrix.m_Data[ 0 ] );
-        m01 = _mm_set1_ps( s_NormalMatrix.m_Data[ 1 ] );
-        m02 = _mm_set1_ps( s_NormalMatrix.m_Data[ 2 ] );
-        m10 = _mm_set1_ps( s_NormalMatrix.m_Data[ 4 ] );
-        m11 = _mm_set1_ps( s_NormalMatrix.m_Data[ 5 ] );
-        m12 = _mm_set1_ps( s_NormalMatrix.m_Data[ 6 ] );
-        m20 = _mm_set1_ps( s_NormalMatrix.m_Data[ 8 ] );
-        m21 = _mm_set1_ps( s_NormalMatrix.m_Data[ 9 ] );
-        m22 = _mm_set1_ps( s_NormalMatrix.m_Data[ 10 ] );
-
-        for ( uint32_t i = 0; i < batchCount; ++i )
-        {
-            __m128 x = GatherFloat4( inNormal, normalStride );
-            __m128 y = GatherFloat4( sizeof( float ) + inNormal, normalStride );
-            __m128 z = GatherFloat4( sizeof( float ) * 2 + inNormal, normalStride );
-            __m128 dotX, dotY, dotZ;
-            SIMDMath::Vec3DotVec3( x, y, z, m00, m10, m20, dotX );
-            SIMDMath::Vec3DotVec3( x, y, z, m01, m11, m21, dotY );
-            SIMDMath::Vec3DotVec3( x, y, z, m02, m12, m22, dotZ );
-            ScatterFloat4( dotX, outNormal, outStride );
-            ScatterFloat4( dotY, sizeof( float ) + outNormal, outStride );
-            ScatterFloat4( dotZ, sizeof( float ) * 2 + outNormal, outStride );
-
-            inNormal += SIMD_WIDTH * normalStride;
-            outNormal += SIMD_WIDTH * outStride;
-        }
+#if defined( RASTERIZER_ENABLE_TRACE )
+    if ( job.lanes )
+    {
+        job.lanes[ slot ] = { laneBegin, job.trace->Now(), CJobSystem::GetThreadIndex(), laneTilesCount };
     }
+#endif
+
+#if defined( RASTERIZER_ENABLE_STATS )
+    std::lock_guard<std::mutex> lock( job.statsMutex );
+    job.stats.pixelsTested += threadStats.pixelsTested;
+    job.stats.pixelsDepthPassed += threadStats.pixelsDepthPassed;
+    job.stats.pixelsAlphaKilled += threadStats.pixelsAlphaKilled;
+    job.stats.pixelsWritten += threadStats.pixelsWritten;
+#endif
 }
 
-inline static void ReadTriangleIndices( const uint8_t* indices, uint32_t location, uint32_t stride, uint32_t* i0, uint32_t* i1, uint32_t* i2 )
+// Computes the inclusive range of the tiles overlapped by the bounding box of a triangle
+static inline void GetTriangleTileRange( const uint8_t* triangle, const SViewport& viewport, uint32_t* tileMinX, uint32_t* tileMaxX, uint32_t* tileMinY, uint32_t* tileMaxY )
 {
-    indices += location * stride;
-    const uint8_t* indexPtr0 = indices;
-    const uint8_t* indexPtr1 = indices + stride;
-    const uint8_t* indexPtr2 = indices + stride + stride;
-    if ( s_IndexType == EIndexType::e16bit )
-    {
-        *i0 = *( (uint16_t*)indexPtr0 );
-        *i1 = *( (uint16_t*)indexPtr1 );
-        *i2 = *( (uint16_t*)indexPtr2 );
-    }
-    else
-    {
-        *i0 = *( (uint32_t*)indexPtr0 );
-        *i1 = *( (uint32_t*)indexPtr1 );
-        *i2 = *( (uint32_t*)indexPtr2 );
-    }
+    const STriangleBaseAttributes* base = (const STriangleBaseAttributes*)triangle;
+    *tileMinX = uint32_t( base->minX - (int32_t)viewport.m_Left ) / s_TileSize;
+    *tileMaxX = uint32_t( base->maxX - (int32_t)viewport.m_Left ) / s_TileSize;
+    *tileMinY = uint32_t( base->minY - (int32_t)viewport.m_Top ) / s_TileSize;
+    *tileMaxY = uint32_t( base->maxY - (int32_t)viewport.m_Top ) / s_TileSize;
 }
 
-inline static void WriteTriangleIndices( uint8_t* indices, uint32_t location, uint32_t stride, uint32_t i0, uint32_t i1, uint32_t i2 )
+static CJobSystem s_JobSystem;
+
+static const uint32_t s_VertexJobBytes = 128 * 1024; // Vertex transform and perspective division jobs touch about this much memory, to stay in L2
+static const uint32_t s_SetupJobTrianglesCount = 256; // Triangle setup is split in jobs of this many triangles
+
+// Linear allocator for the intermediate buffers of the draws. Chunks are kept across frames, when a frame
+// overflows into more than one chunk they are coalesced into a single chunk sized to the high-water mark on reset
+class CFrameArena
 {
-    indices += location * stride;
-    uint8_t* indexPtr0 = indices;
-    uint8_t* indexPtr1 = indices + stride;
-    uint8_t* indexPtr2 = indices + stride + stride;
-    if ( s_IndexType == EIndexType::e16bit )
+public:
+    struct SMarker
     {
-        *( (uint16_t*)indexPtr0 ) = (uint16_t)( i0 );
-        *( (uint16_t*)indexPtr1 ) = (uint16_t)( i1 );
-        *( (uint16_t*)indexPtr2 ) = (uint16_t)( i2 );
-    }
-    else
+        uint32_t chunkIndex;
+        size_t offset;
+        size_t usage;
+    };
+
+    ~CFrameArena()
     {
-        *( (uint32_t*)indexPtr0 ) = i0;
-        *( (uint32_t*)indexPtr1 ) = i1;
-        *( (uint32_t*)indexPtr2 ) = i2;
+        FreeChunks();
     }
-}
 
-// Cull triangle who has any vertices passing by the near clip
-static void CullTriangles( const uint8_t* inZ, const uint8_t* inIndices, uint8_t* outIndices, uint32_t inStride, uint32_t inIndexStride,
-    uint32_t outIndexStride, uint32_t trianglesCount, uint32_t& resultTriangleCount )
-{
-    resultTriangleCount = 0;
-    for ( uint32_t i = 0; i < trianglesCount; ++i )
+    void* Allocate( size_t size )
     {
-        uint32_t i0, i1, i2;
-        if ( inIndices != nullptr )
-        {
-            ReadTriangleIndices( inIndices, i * 3, inIndexStride, &i0, &i1, &i2 );
-        }
-        else
+        size = MathHelper::DivideAndRoundUp( size, s_Alignment ) * s_Alignment;
+
+        // Move on to the next chunk when the current one can't fit, the tail is wasted until the chunks are coalesced
+        while ( m_ChunkIndex < m_Chunks.size() && m_Offset + size > m_Chunks[ m_ChunkIndex ].size )
         {
-            i0 = i * 3;
-            i1 = i * 3 + 1;
-            i2 = i * 3 + 2;
+            ++m_ChunkIndex;
+            m_Offset = 0;
         }
 
-        const uint32_t offset0 = i0 * inStride, offset1 = i1 * inStride, offset2 = i2 * inStride;
-        // Read z as int, only the sign bit matters
-        const int32_t z0 = *(int32_t*)( inZ + offset0 );
-        const int32_t z1 = *(int32_t*)( inZ + offset1 );
-        const int32_t z2 = *(int32_t*)( inZ + offset2 );
-        const bool isCulled = ( z0 | z1 | z2 ) < 0;
-        if ( !isCulled )
+        if ( m_ChunkIndex == m_Chunks.size() )
         {
-            WriteTriangleIndices( outIndices, resultTriangleCount * 3, outIndexStride, i0, i1, i2 );
-            ++resultTriangleCount;
+            // Grow geometrically so a single frame doesn't trigger many allocations
+            const size_t chunkSize = std::max( { size, m_Capacity, s_MinChunkSize } );
+            m_Chunks.push_back( { (uint8_t*)malloc( chunkSize ), chunkSize } );
+            m_Capacity += chunkSize;
         }
-    }
-}
 
-template <bool UseTexture, bool UseVertexColor, bool UseNormal, bool UseViewPos>
-static void PerspectiveDivision( const uint8_t* inTex, const uint8_t* inColor,
-    SAttributeStreamPtrs streamPtrs,
-    uint32_t stride, uint32_t texStride, uint32_t colorStride,
-    uint32_t count )
-{
-    constexpr bool NeedRcpw = UseTexture || UseVertexColor || UseNormal;
+        uint8_t* allocation = m_Chunks[ m_ChunkIndex ].bits + m_Offset;
+        m_Offset += size;
+        m_Usage += size;
+        m_PeakUsage = std::max( m_PeakUsage, m_Usage );
+        return allocation;
+    }
 
-    assert( count % SIMD_WIDTH == 0 );
+    // Grows the latest allocation, it stays in place when the current chunk has room otherwise the content is moved to a new allocation
+    void* Grow( void* allocation, size_t size, size_t newSize )
+    {
+        size = MathHelper::DivideAndRoundUp( size, s_Alignment ) * s_Alignment;
+        newSize = MathHelper::DivideAndRoundUp( newSize, s_Alignment ) * s_Alignment;
+        assert( m_ChunkIndex < m_Chunks.size() && m_Chunks[ m_ChunkIndex ].bits + m_Offset - size == allocation );
 
-    const float halfRasterizerWidth = s_Viewport.m_Width * s_SubpixelStep * 0.5f;
-    const float halfRasterizerHeight = s_Viewport.m_Height * s_SubpixelStep * 0.5f;
-    const int32_t halfPixelOffset = s_SubpixelStep / 2;
-    const int32_t offsetX = s_RasterCoordStartX - halfPixelOffset;
-    const int32_t offsetY = s_RasterCoordStartY - halfPixelOffset;
+        if ( m_Offset - size + newSize <= m_Chunks[ m_ChunkIndex ].size )
+        {
+            m_Offset += newSize - size;
+            m_Usage += newSize - size;
+            m_PeakUsage = std::max( m_PeakUsage, m_Usage );
+            return allocation;
+        }
 
-    __m128 vHalfRasterizerWidth = _mm_set1_ps( halfRasterizerWidth );
-    __m128 vHalfRasterizerHeight = _mm_set1_ps( halfRasterizerHeight );
-    __m128i vOffsetX = _mm_set1_epi32( offsetX );
-    __m128i vOffsetY = _mm_set1_epi32( offsetY );
+        void* newAllocation = Allocate( newSize );
+        memcpy( newAllocation, allocation, size );
+        return newAllocation;
+    }
 
-    uint32_t batchCount = count / SIMD_WIDTH;
-    for ( uint32_t i = 0; i < batchCount; ++i )
+    SMarker GetMarker() const
     {
-        __m128 x = GatherFloat4( streamPtrs.pos, stride );
-        __m128 y = GatherFloat4( sizeof( float ) + streamPtrs.pos, stride );
-        __m128 z = GatherFloat4( streamPtrs.z, stride );
-        __m128 w = GatherFloat4( streamPtrs.w, stride );
-        __m128 one = _mm_set1_ps( 1.f );
-        __m128 half = _mm_set1_ps( .5f );
-        __m128 rcpw = _mm_div_ps( one, w );
+        return { m_ChunkIndex, m_Offset, m_Usage };
+    }
 
-        x = _mm_fmadd_ps( x, rcpw, one ); // x = x / w - (-1)
-        x = _mm_fmadd_ps( x, vHalfRasterizerWidth, half ); // Add 0.5 for rounding
-        __m128i xi = _mm_cvttps_epi32( _mm_floor_ps( x ) );
-        xi = _mm_add_epi32( xi, vOffsetX );
+    // Frees every allocation made after the marker
+    void Rewind( const SMarker& marker )
+    {
+        m_ChunkIndex = marker.chunkIndex;
+        m_Offset = marker.offset;
+        m_Usage = marker.usage;
+    }
 
-        y = _mm_fmadd_ps( y, rcpw, one ); // y = y / w - (-1)
-        y = _mm_fmadd_ps( y, vHalfRasterizerHeight, half ); // Add 0.5 for rounding
-        __m128i yi = _mm_cvttps_epi32( _mm_floor_ps( y ) );
-        yi = _mm_add_epi32( yi, vOffsetY );
+    void Reset()
+    {
+        if ( m_Chunks.size() > 1 )
+        {
+            const size_t peakUsage = m_PeakUsage;
+            FreeChunks();
+            Reserve( peakUsage );
+        }
+        Rewind( { 0, 0, 0 } );
+    }
 
-        z = _mm_mul_ps( z, rcpw );
+    // Makes sure the first chunk can hold the given size, existing allocations are discarded if it has to grow
+    void Reserve( size_t size )
+    {
+        if ( !m_Chunks.empty() && m_Chunks[ 0 ].size >= size )
+        {
+            return;
+        }
 
-        ScatterInt4( xi, streamPtrs.pos, stride );
-        ScatterInt4( yi, sizeof( int32_t ) + streamPtrs.pos, stride );
-        ScatterFloat4( z, streamPtrs.z, stride );
+        FreeChunks();
+        m_Chunks.push_back( { (uint8_t*)malloc( size ), size } );
+        m_Capacity = size;
+        Rewind( { 0, 0, 0 } );
+    }
 
-        if ( NeedRcpw )
-        { 
-            ScatterFloat4( rcpw, streamPtrs.rcpw, stride );
-        }
+    size_t GetPeakUsage() const
+    {
+        return m_PeakUsage;
+    }
 
-        streamPtrs.pos += SIMD_WIDTH * stride;
-        streamPtrs.z += SIMD_WIDTH * stride;
-        streamPtrs.w += SIMD_WIDTH * stride;
+private:
+    struct SChunk
+    {
+        uint8_t* bits;
+        size_t size;
+    };
 
-        if ( UseTexture )
-        {
-            __m128 texU = GatherFloat4( inTex, texStride );
-            __m128 texV = GatherFloat4( sizeof( float ) + inTex, texStride );
-            texU = _mm_mul_ps( texU, rcpw );
-            texV = _mm_mul_ps( texV, rcpw );
-            ScatterFloat4( texU, streamPtrs.texcoord, stride );
-            ScatterFloat4( texV, sizeof( float ) + streamPtrs.texcoord, stride );
-            inTex += SIMD_WIDTH * texStride;
-            streamPtrs.texcoord += SIMD_WIDTH * stride;
-        }
-        
-        if ( UseVertexColor )
-        {
-            __m128 colorR = GatherFloat4( inColor, colorStride );
-            __m128 colorG = GatherFloat4( sizeof( float ) + inColor, colorStride );
-            __m128 colorB = GatherFloat4( sizeof( float ) * 2 + inColor, colorStride );
-            colorR = _mm_mul_ps( colorR, rcpw );
-            colorG = _mm_mul_ps( colorG, rcpw );
-            colorB = _mm_mul_ps( colorB, rcpw );
-            ScatterFloat4( colorR, streamPtrs.color, stride );
-            ScatterFloat4( colorG, sizeof( float ) + streamPtrs.color, stride );
-            ScatterFloat4( colorB, sizeof( float ) * 2 + streamPtrs.color, stride );
-            inColor += SIMD_WIDTH * colorStride;
-            streamPtrs.color += SIMD_WIDTH * stride;
-        }
-        
-        if ( UseNormal )
-        {
-            __m128 normalX = GatherFloat4( streamPtrs.normal, stride );
-            __m128 normalY = GatherFloat4( sizeof( float ) + streamPtrs.normal, stride );
-            __m128 normalZ = GatherFloat4( sizeof( float ) * 2 + streamPtrs.normal, stride );
-            normalX = _mm_mul_ps( normalX, rcpw );
-            normalY = _mm_mul_ps( normalY, rcpw );
-            normalZ = _mm_mul_ps( normalZ, rcpw );
-            ScatterFloat4( normalX, streamPtrs.normal, stride );
-            ScatterFloat4( normalY, sizeof( float ) + streamPtrs.normal, stride );
-            ScatterFloat4( normalZ, sizeof( float ) * 2 + streamPtrs.normal, stride );
-            streamPtrs.normal += SIMD_WIDTH * stride;
-        }
-        
-        if ( UseViewPos )
+    void FreeChunks()
+    {
+        for ( SChunk& chunk : m_Chunks )
         {
-            __m128 viewPosX = GatherFloat4( streamPtrs.viewPos, stride );
-            __m128 viewPosY = GatherFloat4( sizeof( float ) + streamPtrs.viewPos, stride );
-            __m128 viewPosZ = GatherFloat4( sizeof( float ) * 2 + streamPtrs.viewPos, stride );
-            viewPosX = _mm_mul_ps( viewPosX, rcpw );
-            viewPosY = _mm_mul_ps( viewPosY, rcpw );
-            viewPosZ = _mm_mul_ps( viewPosZ, rcpw );
-            ScatterFloat4( viewPosX, streamPtrs.viewPos, stride );
-            ScatterFloat4( viewPosY, sizeof( float ) + streamPtrs.viewPos, stride );
-            ScatterFloat4( viewPosZ, sizeof( float ) * 2 + streamPtrs.viewPos, stride );
-            streamPtrs.viewPos += SIMD_WIDTH * stride;
+            free( chunk.bits );
         }
+        m_Chunks.clear();
+        m_Capacity = 0;
     }
-}
 
-struct SVertex
-{
-    explicit SVertex( const uint8_t* data )
-    {
-        x = ( (int32_t*)data )[ 0 ];
-        y = ( (int32_t*)data )[ 1 ];
-    }
+    static const size_t s_Alignment = 16; // Same as malloc so the kernels keep their SSE alignment
+    static const size_t s_MinChunkSize = 1024 * 1024;
 
-    int32_t x, y;
+    std::vector<SChunk> m_Chunks;
+    size_t m_Capacity = 0;
+    uint32_t m_ChunkIndex = 0;
+    size_t m_Offset = 0;
+    size_t m_Usage = 0;
+    size_t m_PeakUsage = 0;
 };
 
-static inline bool IsTopLeftEdge( const SVertex& v0, const SVertex& v1 )
+// Everything a context owns, the kernel tables are shared by all contexts
+struct Rasterizer::SContextState
 {
-    bool isTop = v0.y == v1.y && v0.x > v1.x;
-    bool isLeft = v0.y > v1.y;
-    return isLeft || isTop;
-}
+    SPipelineState pipelineState = {};
+    SRenderState renderState = CreateDefaultRenderState();
+    SMatrix projectionMatrix =
+        {
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f,
+            0.f, 0.f, 0.f, 1.f,
+        };
+
+    SHiZBuffer hiZBuffer = {};
+    std::vector<float> hiZStorage;
+    bool isHiZValid = false; // Only true between clearing the depth target through ClearDepthTarget and any unsupported change
+
+    SStream streamSourcePos = {};
+    SStream streamSourceTex = {};
+    SStream streamSourceColor = {};
+    SStream streamSourceNormal = {};
+    SStream streamSourceIndex = {};
+
+    CFrameArena frameArena;
+    SFrameStats frameStats = {};
+#if defined( RASTERIZER_ENABLE_TRACE )
+    CFrameTrace frameTrace;
+#endif
+};
 
-static inline float BarycentricInterplation( float attr0, float attr1, float attr2, float w0, float w1, float w2 )
+// Picks the widest instruction set supported by the host
+static EInstructionSet DetectInstructionSet()
 {
-    return attr0 * w0 + ( attr1 * w1 + ( attr2 * w2 ) );
+    if ( IsInstructionSetSupported( EInstructionSet::eAVX512 ) )
+    {
+        return EInstructionSet::eAVX512;
+    }
+    if ( IsInstructionSetSupported( EInstructionSet::eAVX2 ) )
+    {
+        return EInstructionSet::eAVX2;
+    }
+    return EInstructionSet::eSSE41;
 }
 
-template <bool UseTexcoord, bool UseColor, bool UseNormal, bool UseViewPos>
-static void SetupTriangles( const STriangleSetupInput& input,
-    const uint8_t* indices, uint32_t indexStride,
-    STriangleSetupOutput output,
-    uint32_t inputStride, uint32_t outputStride, uint32_t trianglesCount )
+void Rasterizer::Initialize( const SJobSystemDesc& desc )
 {
-    constexpr bool UseRcpw = UseTexcoord || UseColor || UseNormal || UseViewPos;
-
-    int32_t cullSign = s_CullMode == ECullMode::eCullCW ? 0 : 0x80000000;
-
-    for ( uint32_t i = 0; i < trianglesCount; ++i )
-    {
-        uint32_t i0, i1, i2;
-        ReadTriangleIndices( indices, i * 3, indexStride, &i0, &i1, &i2 );
-
-        const uint32_t offset0 = i0 * inputStride, offset1 = i1 * inputStride, offset2 = i2 * inputStride;
-        const SVertex v0( input.pos + offset0 ), v1( input.pos + offset1 ), v2( input.pos + offset2 );
+    // The threads calling the draws run jobs as well
+    const uint32_t hardwareThreadsCount = std::thread::hardware_concurrency();
+    const uint32_t workersCount = desc.m_WorkersCount != UINT32_MAX ? desc.m_WorkersCount : hardwareThreadsCount > 1 ? hardwareThreadsCount - 1 : 0;
+    s_JobSystem.Start( workersCount, desc.m_WorkerCpuIndices );
 
-        STriangleBaseAttributes* baseAttrs = (STriangleBaseAttributes*)output.base;
-
-        int32_t a01 = v0.y - v1.y, b01 = v1.x - v0.x, c01 = v0.x * v1.y - v0.y * v1.x;
-        // Compute the signed area of the triangle for barycentric coordinates normalization
-        const int32_t doubleSignedArea = a01 * v2.x + b01 * v2.y + c01; // Plug v2 into the edge function of edge01
-        const int32_t faceSign = doubleSignedArea & 0x80000000;
-        baseAttrs->faceSign = faceSign >> 24; // 32bit to 8bit
-        cullSign = s_CullMode == ECullMode::eNone ? faceSign : cullSign; // If cull mode is none, each triangle overrides the cull sign with its facing.
-        // Early out if the triangle facing is different than the cull facing
-        if ( ( cullSign ^ doubleSignedArea ) >= 0 )
-        {
-            const float rcpDoubleSignedArea = 1.0f / doubleSignedArea;
-
-            int32_t a12 = v1.y - v2.y, b12 = v2.x - v1.x, c12 = v1.x * v2.y - v1.y * v2.x;
-            int32_t a20 = v2.y - v0.y, b20 = v0.x - v2.x, c20 = v2.x * v0.y - v2.y * v0.x;
-
-            // Calculate bounding box of the triangle and crop with the viewport
-            int32_t minX = std::max( s_RasterCoordStartX, std::min( v0.x, std::min( v1.x, v2.x ) ) );
-            int32_t minY = std::max( s_RasterCoordStartY, std::min( v0.y, std::min( v1.y, v2.y ) ) );
-            int32_t maxX = std::min( s_RasterCoordEndX, std::max( v0.x, std::max( v1.x, v2.x ) ) );
-            int32_t maxY = std::min( s_RasterCoordEndY, std::max( v0.y, std::max( v1.y, v2.y ) ) );
-            // Round up the minimum of the bounding box to the nearest pixel center
-            minX = MathHelper::DivideAndRoundUp( minX - s_RasterCoordStartX, s_SubpixelStep ) * s_SubpixelStep + s_RasterCoordStartX;
-            minY = MathHelper::DivideAndRoundUp( minY - s_RasterCoordStartY, s_SubpixelStep ) * s_SubpixelStep + s_RasterCoordStartY;
-            // Compute the image coordinate where the minimum of the bounding box is
-            const int32_t imgMinX = s_Viewport.m_Left + ( minX - s_RasterCoordStartX ) / s_SubpixelStep;
-            int32_t imgY = s_Viewport.m_Top + s_Viewport.m_Height - ( minY - s_RasterCoordStartY ) / s_SubpixelStep - 1; // Image axis y is flipped
-
-            int32_t w0_row = a12 * minX + b12 * minY + c12;
-            int32_t w1_row = a20 * minX + b20 * minY + c20;
-            int32_t w2_row = a01 * minX + b01 * minY + c01;
-
-            // Pre-multiply the edge function increments by sub-pixel steps
-            a01 *= s_SubpixelStep; b01 *= s_SubpixelStep;
-            a12 *= s_SubpixelStep; b12 *= s_SubpixelStep;
-            a20 *= s_SubpixelStep; b20 *= s_SubpixelStep;
-
-            // Barycentric coordinates at minimum of the bounding box
-            float bw0_row = w0_row * rcpDoubleSignedArea;
-            float bw1_row = w1_row * rcpDoubleSignedArea;
-            float bw2_row = w2_row * rcpDoubleSignedArea;
-            // Horizontal barycentric coordinates increment 
-            float ba01 = a01 * rcpDoubleSignedArea;
-            float ba12 = a12 * rcpDoubleSignedArea;
-            float ba20 = a20 * rcpDoubleSignedArea;
-            // Vertical barycentric coordinates increment
-            float bb01 = b01 * rcpDoubleSignedArea;
-            float bb12 = b12 * rcpDoubleSignedArea;
-            float bb20 = b20 * rcpDoubleSignedArea;
-
-            // Apply top left rule
-            // The following bias computing are facing agnostic, because if the triangle is CW
-            // 1) The IsTopLeftEdge test gives opposite result (IsBottomRightEdge) and...
-            // 2) top left edge bias should be -1, which yields positive (inside) when XOR'ed with the negative face sign and...
-            // 3) non-top left edge bias should be 0, which yields negative (outside) when XOR'ed with the negative face sign
-            // which is the same as if the triangle is CCW
-            const int32_t topLeftBias0 = IsTopLeftEdge( v1, v2 ) ? 0 : -1;
-            const int32_t topLeftBias1 = IsTopLeftEdge( v2, v0 ) ? 0 : -1;
-            const int32_t topLeftBias2 = IsTopLeftEdge( v0, v1 ) ? 0 : -1;
-            w0_row += topLeftBias0;
-            w1_row += topLeftBias1;
-            w2_row += topLeftBias2;
-
-            // Write all base attributes
-            baseAttrs->minX = minX; baseAttrs->maxX = maxX;
-            baseAttrs->minY = minY; baseAttrs->maxY = maxY;
-            baseAttrs->imgMinX = imgMinX; baseAttrs->imgY = imgY;
-            baseAttrs->w0_row = w0_row; baseAttrs->w1_row = w1_row; baseAttrs->w2_row = w2_row;
-            baseAttrs->a01 = a01; baseAttrs->a12 = a12; baseAttrs->a20 = a20;
-            baseAttrs->b01 = b01; baseAttrs->b12 = b12; baseAttrs->b20 = b20;
-
-#define SETUP_ATTRIBUTE( name, offset, condition ) \
-            if ( condition ) \
-            { \
-                STriangleAttribute* dstAttr = (STriangleAttribute*)output.##name; \
-                dstAttr += offset; \
-                float attr0 = *( (float*)( input.##name + offset0 ) + offset ); \
-                float attr1 = *( (float*)( input.##name + offset1 ) + offset ); \
-                float attr2 = *( (float*)( input.##name + offset2 ) + offset ); \
-                dstAttr->row = BarycentricInterplation( attr0, attr1, attr2, bw0_row, bw1_row, bw2_row ); \
-                dstAttr->a = BarycentricInterplation( attr0, attr1, attr2, ba12, ba20, ba01 ); \
-                dstAttr->b = BarycentricInterplation( attr0, attr1, attr2, bb12, bb20, bb01 ); \
-            }
+    assert( IsInstructionSetSupported( EInstructionSet::eSSE41 ) ); // The minimum requirement
+    SetInstructionSet( DetectInstructionSet() );
+}
 
-            SETUP_ATTRIBUTE( z, 0, true )
-    
-            SETUP_ATTRIBUTE( rcpw, 0, UseRcpw )
+bool Rasterizer::IsInstructionSetSupported( EInstructionSet instructionSet )
+{
+    int cpuInfo[ 4 ];
+    Platform::Cpuid( cpuInfo, 0 );
+    const int maxLeaf = cpuInfo[ 0 ];
 
-            SETUP_ATTRIBUTE( texcoord, 0, UseTexcoord )
-            SETUP_ATTRIBUTE( texcoord, 1, UseTexcoord )
+    Platform::Cpuid( cpuInfo, 1 );
+    const bool hasSSE41 = ( cpuInfo[ 2 ] & ( 1 << 19 ) ) != 0;
+    if ( instructionSet == EInstructionSet::eSSE41 )
+    {
+        return hasSSE41;
+    }
 
-            SETUP_ATTRIBUTE( color, 0, UseColor )
-            SETUP_ATTRIBUTE( color, 1, UseColor )
-            SETUP_ATTRIBUTE( color, 2, UseColor )
+    const bool hasFMA = ( cpuInfo[ 2 ] & ( 1 << 12 ) ) != 0;
+    const bool hasOSXSAVE = ( cpuInfo[ 2 ] & ( 1 << 27 ) ) != 0;
+    const bool hasAVX = ( cpuInfo[ 2 ] & ( 1 << 28 ) ) != 0;
+    if ( !hasSSE41 || !hasFMA || !hasOSXSAVE || !hasAVX || maxLeaf < 7 )
+    {
+        return false;
+    }
 
-            SETUP_ATTRIBUTE( normal, 0, UseNormal )
-            SETUP_ATTRIBUTE( normal, 1, UseNormal )
-            SETUP_ATTRIBUTE( normal, 2, UseNormal )
+    // The OS has to preserve the YMM registers, and the opmask and ZMM registers for AVX-512
+    const uint64_t xcr0 = Platform::Xgetbv( 0 );
+    Platform::Cpuid( cpuInfo, 7, 0 );
+    const bool hasAVX2 = ( cpuInfo[ 1 ] & ( 1 << 5 ) ) != 0 && ( xcr0 & 0x6 ) == 0x6;
+    if ( instructionSet == EInstructionSet::eAVX2 )
+    {
+        return hasAVX2;
+    }
 
-            SETUP_ATTRIBUTE( viewPos, 0, UseViewPos )
-            SETUP_ATTRIBUTE( viewPos, 1, UseViewPos )
-            SETUP_ATTRIBUTE( viewPos, 2, UseViewPos )
+    // The AVX-512 kernels are allowed to use the F, CD, BW, DQ and VL subsets
+    const uint32_t avx512Bits = ( 1u << 16 ) | ( 1u << 17 ) | ( 1u << 28 ) | ( 1u << 30 ) | ( 1u << 31 );
+    return instructionSet == EInstructionSet::eAVX512 && hasAVX2 && ( (uint32_t)cpuInfo[ 1 ] & avx512Bits ) == avx512Bits && ( xcr0 & 0xE6 ) == 0xE6;
+}
 
-#undef SETUP_ATTRIBUTE
-        }
+bool Rasterizer::SetInstructionSet( EInstructionSet instructionSet )
+{
+    if ( !IsInstructionSetSupported( instructionSet ) )
+    {
+        return false;
+    }
 
-        output.base += outputStride;
-        output.z += outputStride;
-        if ( UseRcpw ) output.rcpw += outputStride;
-        if ( UseTexcoord ) output.texcoord += outputStride;
-        if ( UseColor ) output.color += outputStride;
-        if ( UseNormal ) output.normal += outputStride;
-        if ( UseViewPos ) output.viewPos += outputStride;
+    switch ( instructionSet )
+    {
+    case EInstructionSet::eSSE41:
+        RasterizationKernels_SSE41::FillFunctionTables( s_VertexTransformFunctionTable, s_PerspectiveDivisionFunctionTable, s_TriangleSetupFunctionTable, s_RasterizingFunctionTable,
+            &s_ResolveTileFunction );
+        break;
+    case EInstructionSet::eAVX2:
+        RasterizationKernels_AVX2::FillFunctionTables( s_VertexTransformFunctionTable, s_PerspectiveDivisionFunctionTable, s_TriangleSetupFunctionTable, s_RasterizingFunctionTable,
+            &s_ResolveTileFunction );
+        break;
+    case EInstructionSet::eAVX512:
+        RasterizationKernels_AVX512::FillFunctionTables( s_VertexTransformFunctionTable, s_PerspectiveDivisionFunctionTable, s_TriangleSetupFunctionTable, s_RasterizingFunctionTable,
+            &s_ResolveTileFunction );
+        break;
+    default:
+        return false;
     }
+    s_InstructionSet = instructionSet;
+    return true;
 }
 
-template <bool UseTexture, bool UseVertexColor, ELightingModel LightingModel, ELightType LightType, bool EnableAlphaTest, bool EnableAlphaBlend>
-static void RasterizeTriangles( STriangleSetupOutput input, uint32_t inputStride, uint32_t trianglesCount )
+EInstructionSet Rasterizer::GetInstructionSet()
 {
-    constexpr bool NeedLighting = LightingModel != ELightingModel::eUnlit;
-    constexpr bool NeedViewPos = NeedLighting && ( LightingModel == ELightingModel::eBlinnPhong || LightType == ELightType::ePoint );
-    constexpr bool NeedRcpw = UseTexture || UseVertexColor || NeedLighting;
-
-    int32_t cullSign = s_CullMode == ECullMode::eCullCW ? 0 : 0x80000000;
+    return s_InstructionSet;
+}
 
-    for ( uint32_t i = 0; i < trianglesCount; ++i )
+SImage Rasterizer::ResolveImage( const SImage& image, uint8_t* bits )
+{
+    assert( image.m_Layout == ETextureLayout::eTiled );
+    const uint32_t tilesCountX = MathHelper::DivideAndRoundUp( image.m_Width, (uint32_t)s_TileSize );
+    const uint32_t tilesCountY = MathHelper::DivideAndRoundUp( image.m_Height, (uint32_t)s_TileSize );
+    const ResolveTileFunctionPtr resolveTileFunction = s_ResolveTileFunction;
+    s_JobSystem.ParallelFor( tilesCountY, 1, [ & ]( uint32_t tileYBegin, uint32_t tileYEnd )
     {
-        STriangleBaseAttributes* base = (STriangleBaseAttributes*)input.base;
-
-        // Fetch all base attributes
-        const int32_t minX = base->minX, maxX = base->maxX, minY = base->minY, maxY = base->maxY;
-        int32_t imgMinX = base->imgMinX, imgY = base->imgY;
-        int32_t w0_row = base->w0_row, w1_row = base->w1_row, w2_row = base->w2_row;
-        const int32_t a01 = base->a01, a12 = base->a12, a20 = base->a20;
-        const int32_t b01 = base->b01, b12 = base->b12, b20 = base->b20;
-
-        const int32_t faceSign = base->faceSign << 24; // 8bit to 32bit
-        cullSign = s_CullMode == ECullMode::eNone ? faceSign : cullSign; // If cull mode is none, each triangle overrides the cull sign with its facing.
-        // Early out if the triangle facing is different than the cull facing
-        if ( ( faceSign ^ cullSign ) < 0 )
-        {
-            goto NextTriangle;
-        }
-
-#define FETCH_ATTRIBUTE( dstName, srcName, offset, condition ) \
-        float dstName##_row, dstName##_a, dstName##_b; \
-        if ( condition ) \
-        { \
-            STriangleAttribute* attr = (STriangleAttribute*)input.##srcName; \
-            attr += offset; \
-            dstName##_row = attr->row; \
-            dstName##_a = attr->a; \
-            dstName##_b = attr->b; \
-        }
-
-        FETCH_ATTRIBUTE( z, z, 0, true )
-    
-        FETCH_ATTRIBUTE( rcpw, rcpw, 0, NeedRcpw )
-
-        FETCH_ATTRIBUTE( texU_w, texcoord, 0, UseTexture )
-        FETCH_ATTRIBUTE( texV_w, texcoord, 1, UseTexture )
-
-        FETCH_ATTRIBUTE( colorR_w, color, 0, UseVertexColor )
-        FETCH_ATTRIBUTE( colorG_w, color, 1, UseVertexColor )
-        FETCH_ATTRIBUTE( colorB_w, color, 2, UseVertexColor )
-
-        FETCH_ATTRIBUTE( normalX_w, normal, 0, NeedLighting )
-        FETCH_ATTRIBUTE( normalY_w, normal, 1, NeedLighting )
-        FETCH_ATTRIBUTE( normalZ_w, normal, 2, NeedLighting )
-
-        FETCH_ATTRIBUTE( viewPosX_w, viewPos, 0, NeedViewPos )
-        FETCH_ATTRIBUTE( viewPosY_w, viewPos, 1, NeedViewPos )
-        FETCH_ATTRIBUTE( viewPosZ_w, viewPos, 2, NeedViewPos )
-
-#undef FETCH_ATTRIBUTE
-
-        int32_t pX, pY;
-        for ( pY = minY; pY <= maxY; pY += s_SubpixelStep, imgY -= 1 )
+        for ( uint32_t tileY = tileYBegin; tileY < tileYEnd; ++tileY )
         {
-            int32_t w0 = w0_row;
-            int32_t w1 = w1_row;
-            int32_t w2 = w2_row;
-
-            int32_t imgX = imgMinX;
-
-#define ROW_INIT_ATTRIBUTE( name, condition ) \
-            float name; \
-            if ( condition ) \
-            { \
-                name = name##_row; \
-            }
-
-            ROW_INIT_ATTRIBUTE( z, true )
-        
-            ROW_INIT_ATTRIBUTE( rcpw, NeedRcpw )
-
-            ROW_INIT_ATTRIBUTE( texU_w, UseTexture )
-            ROW_INIT_ATTRIBUTE( texV_w, UseTexture )
-
-            ROW_INIT_ATTRIBUTE( colorR_w, UseVertexColor )
-            ROW_INIT_ATTRIBUTE( colorG_w, UseVertexColor )
-            ROW_INIT_ATTRIBUTE( colorB_w, UseVertexColor )
-
-            ROW_INIT_ATTRIBUTE( normalX_w, NeedLighting )
-            ROW_INIT_ATTRIBUTE( normalY_w, NeedLighting )
-            ROW_INIT_ATTRIBUTE( normalZ_w, NeedLighting )
-
-            ROW_INIT_ATTRIBUTE( viewPosX_w, NeedViewPos )
-            ROW_INIT_ATTRIBUTE( viewPosY_w, NeedViewPos )
-            ROW_INIT_ATTRIBUTE( viewPosZ_w, NeedViewPos )
-
-#undef ROW_INIT_ATTRIBUTE
-
-            for ( pX = minX; pX <= maxX; pX += s_SubpixelStep, imgX += 1 )
+            const uint32_t minY = tileY * s_TileSize;
+            const uint32_t height = std::min( image.m_Height - minY, (uint32_t)s_TileSize );
+            for ( uint32_t tileX = 0; tileX < tilesCountX; ++tileX )
             {
-                if ( ( ( faceSign ^ w0 ) | ( faceSign ^ w1 ) | ( faceSign ^ w2 ) ) >= 0 ) // "Inside" fragments yields positive
-                {
-                    float* dstDepth = (float*)s_DepthTarget.m_Bits + imgY * s_DepthTarget.m_Width + imgX;
-                    if ( z < *dstDepth )
-                    {
-                        if ( !EnableAlphaTest && s_EnableDepthWrite )
-                        {
-                            *dstDepth = z;
-                        }
-
-                        float w = 0.f;
-                        if ( NeedRcpw )
-                        {
-                            w = 1.0f / rcpw;
-                        }
-                    
-                        float r = 1.f, g = 1.f, b = 1.f, a = 1.f;
-                        if ( UseTexture )
-                        { 
-                            float texU = texU_w * w;
-                            float texV = texV_w * w;
-                            SampleTexture_PointClamp( s_Texture, texU, texV, &r, &g, &b, &a );
-                        }
-
-                        if ( UseVertexColor )
-                        {
-                            float vertexColorR = colorR_w * w;
-                            float vertexColorG = colorG_w * w;
-                            float vertexColorB = colorB_w * w;
-                            r *= vertexColorR;
-                            g *= vertexColorG;
-                            b *= vertexColorB;
-                        }
-
-                        r *= s_Material.m_Diffuse.m_X;
-                        g *= s_Material.m_Diffuse.m_Y;
-                        b *= s_Material.m_Diffuse.m_Z;
-                        a *= s_Material.m_Diffuse.m_W;
-
-                        if ( EnableAlphaTest )
-                        { 
-                            const uint8_t a8 = uint8_t( a * 255.f + 0.5f );
-                            if ( a8 < s_AlphaRef )
-                            {
-                                goto NextFragment;
-                            }
-
-                            if ( s_EnableDepthWrite )
-                            { 
-                                *dstDepth = z;
-                            }
-                        }
-
-                        if ( NeedLighting )
-                        {
-                            float normalX = normalX_w * w;
-                            float normalY = normalY_w * w;
-                            float normalZ = normalZ_w * w;
-                            // Re-normalize the normal
-                            float length = normalX * normalX + normalY * normalY + normalZ * normalZ;
-                            float rcpDenorm = 1.0f / sqrtf( length );
-                            normalX *= rcpDenorm;
-                            normalY *= rcpDenorm;
-                            normalZ *= rcpDenorm;
-
-                            float viewPosX, viewPosY, viewPosZ;
-                            if ( NeedViewPos )
-                            { 
-                                viewPosX = viewPosX_w * w;
-                                viewPosY = viewPosY_w * w;
-                                viewPosZ = viewPosZ_w * w;
-                            }
-
-                            float lightVecX, lightVecY, lightVecZ, lightDistanceSqr;
-                            if ( LightType == ELightType::eDirectional )
-                            {
-                                lightVecX = s_Light.m_Position.m_X;
-                                lightVecY = s_Light.m_Position.m_Y;
-                                lightVecZ = s_Light.m_Position.m_Z;
-                            }
-                            else if ( LightType == ELightType::ePoint )
-                            {
-                                lightVecX = s_Light.m_Position.m_X - viewPosX;
-                                lightVecY = s_Light.m_Position.m_Y - viewPosY;
-                                lightVecZ = s_Light.m_Position.m_Z - viewPosZ;
-                                lightDistanceSqr = lightVecX * lightVecX + lightVecY * lightVecY + lightVecZ * lightVecZ;
-                                // Normalize the light vector
-                                rcpDenorm = 1.f / sqrtf( lightDistanceSqr );
-                                lightVecX *= rcpDenorm;
-                                lightVecY *= rcpDenorm;
-                                lightVecZ *= rcpDenorm;
-                            }
-
-                            float NdotL = normalX * lightVecX + normalY * lightVecY + normalZ * lightVecZ;
-                            NdotL = std::max( 0.f, NdotL );
-
-                            const float lambertR = r * s_Light.m_Diffuse.m_X * NdotL;
-                            const float lambertG = g * s_Light.m_Diffuse.m_Y * NdotL;
-                            const float lambertB = b * s_Light.m_Diffuse.m_Z * NdotL;
-
-                            float specularR = 0.f, specularG = 0.f, specularB = 0.f;
-                            if ( LightingModel == ELightingModel::eBlinnPhong )
-                            { 
-                                float viewVecX = -viewPosX;
-                                float viewVecY = -viewPosY;
-                                float viewVecZ = -viewPosZ;
-                                // Re-normalize the view vector
-                                length = viewVecX * viewVecX + viewVecY * viewVecY + viewVecZ * viewVecZ;
-                                rcpDenorm = 1.0f / sqrtf( length );
-                                viewVecX *= rcpDenorm;
-                                viewVecY *= rcpDenorm;
-                                viewVecZ *= rcpDenorm;
-
-                                float halfVecX = lightVecX + viewVecX;
-                                float halfVecY = lightVecY + viewVecY;
-                                float halfVecZ = lightVecZ + viewVecZ;
-                                // Re-normalize the half vector
-                                length = halfVecX * halfVecX + halfVecY * halfVecY + halfVecZ * halfVecZ;
-                                rcpDenorm = 1.0f / sqrtf( length );
-                                halfVecX *= rcpDenorm;
-                                halfVecY *= rcpDenorm;
-                                halfVecZ *= rcpDenorm;
-
-                                float NdotH = normalX * halfVecX + normalY * halfVecY + normalZ * halfVecZ;
-                                NdotH = std::max( 0.f, NdotH );
-
-                                const float blinnPhong = NdotL > 0.f ? std::powf( NdotH, s_Material.m_Power ) : 0.f;
-                                specularR = s_Material.m_Specular.m_X * s_Light.m_Specular.m_X * blinnPhong;
-                                specularG = s_Material.m_Specular.m_Y * s_Light.m_Specular.m_Y * blinnPhong;
-                                specularB = s_Material.m_Specular.m_Z * s_Light.m_Specular.m_Z * blinnPhong;
-                            }
-
-                            r = lambertR + specularR;
-                            g = lambertG + specularG;
-                            b = lambertB + specularB;
-                        
-                            if ( LightType == ELightType::ePoint )
-                            {
-                                const float rcpDistanceSqr = 1.f / lightDistanceSqr;
-                                r *= rcpDistanceSqr;
-                                g *= rcpDistanceSqr;
-                                b *= rcpDistanceSqr;
-                            }
-
-                            r += s_Light.m_Ambient.m_X;
-                            g += s_Light.m_Ambient.m_Y;
-                            b += s_Light.m_Ambient.m_Z;
-                        }
-
-                        uint32_t* pixelPtr = (uint32_t*)s_RenderTarget.m_Bits + imgY * s_RenderTarget.m_Width + imgX;
-
-                        if ( EnableAlphaBlend )
-                        {
-                            float dstR, dstG, dstB, dstA;
-                            R8G8B8A8Unorm_To_Float( *pixelPtr, &dstR, &dstG, &dstB, &dstA );
-
-                            r = ( r - dstR ) * a + dstR;
-                            g = ( g - dstG ) * a + dstG;
-                            b = ( b - dstB ) * a + dstB;
-                        }
-
-                        r = std::fmin( r, 1.f );
-                        g = std::fmin( g, 1.f );
-                        b = std::fmin( b, 1.f );
-
-                        uint8_t r8 = uint8_t( r * 255.f + 0.5f );
-                        uint8_t g8 = uint8_t( g * 255.f + 0.5f );
-                        uint8_t b8 = uint8_t( b * 255.f + 0.5f );
-                        *pixelPtr = 0xFF000000 | r8 << 16 | g8 << 8 | b8;
-                    }
-                }
-
-NextFragment:
-                w0 += a12;
-                w1 += a20;
-                w2 += a01;
-
-#define ROW_INC_ATTRIBUTE( name, condition ) \
-                if ( condition ) \
-                { \
-                    name += name##_a; \
-                }
-
-                ROW_INC_ATTRIBUTE( z, true )
-
-                ROW_INC_ATTRIBUTE( rcpw, NeedRcpw )
-
-                ROW_INC_ATTRIBUTE( texU_w, UseTexture )
-                ROW_INC_ATTRIBUTE( texV_w, UseTexture )
-
-                ROW_INC_ATTRIBUTE( colorR_w, UseVertexColor )
-                ROW_INC_ATTRIBUTE( colorG_w, UseVertexColor )
-                ROW_INC_ATTRIBUTE( colorB_w, UseVertexColor )
-
-                ROW_INC_ATTRIBUTE( normalX_w, NeedLighting )
-                ROW_INC_ATTRIBUTE( normalY_w, NeedLighting )
-                ROW_INC_ATTRIBUTE( normalZ_w, NeedLighting )
-
-                ROW_INC_ATTRIBUTE( viewPosX_w, NeedViewPos )
-                ROW_INC_ATTRIBUTE( viewPosY_w, NeedViewPos )
-                ROW_INC_ATTRIBUTE( viewPosZ_w, NeedViewPos )
-
-#undef ROW_INC_ATTRIBUTE
-            }
-
-            w0_row += b12;
-            w1_row += b20;
-            w2_row += b01;
-
-#define VERTICAL_INC_ATTRIBUTE( name, condition ) \
-            if ( condition ) \
-            { \
-                name##_row += name##_b; \
+                const uint32_t minX = tileX * s_TileSize;
+                const uint32_t width = std::min( image.m_Width - minX, (uint32_t)s_TileSize );
+                const uint32_t* tile = (const uint32_t*)image.m_Bits + ( tileY * tilesCountX + tileX ) * s_TileSize * s_TileSize;
+                resolveTileFunction( tile, (uint32_t*)bits + minY * image.m_Width + minX, image.m_Width, width, height );
             }
-
-            VERTICAL_INC_ATTRIBUTE( z, true )
-
-            VERTICAL_INC_ATTRIBUTE( rcpw, NeedRcpw )
-
-            VERTICAL_INC_ATTRIBUTE( texU_w, UseTexture )
-            VERTICAL_INC_ATTRIBUTE( texV_w, UseTexture )
-
-            VERTICAL_INC_ATTRIBUTE( colorR_w, UseVertexColor )
-            VERTICAL_INC_ATTRIBUTE( colorG_w, UseVertexColor )
-            VERTICAL_INC_ATTRIBUTE( colorB_w, UseVertexColor )
-
-            VERTICAL_INC_ATTRIBUTE( normalX_w, NeedLighting )
-            VERTICAL_INC_ATTRIBUTE( normalY_w, NeedLighting )
-            VERTICAL_INC_ATTRIBUTE( normalZ_w, NeedLighting )
-
-            VERTICAL_INC_ATTRIBUTE( viewPosX_w, NeedViewPos )
-            VERTICAL_INC_ATTRIBUTE( viewPosY_w, NeedViewPos )
-            VERTICAL_INC_ATTRIBUTE( viewPosZ_w, NeedViewPos )
-
-#undef VERTICAL_INC_ATTRIBUTE
         }
+    } );
 
-NextTriangle:
-        input.base += inputStride;
-        input.z += inputStride;
-        if ( NeedRcpw ) input.rcpw += inputStride;
-        if ( UseTexture ) input.texcoord += inputStride;
-        if ( UseVertexColor ) input.color += inputStride;
-        if ( NeedLighting ) input.normal += inputStride;
-        if ( NeedViewPos ) input.viewPos += inputStride;
-    }
+    SImage linearImage = image;
+    linearImage.m_Bits = bits;
+    linearImage.m_Layout = ETextureLayout::eLinear;
+    return linearImage;
 }
 
-
-static uint32_t MakeFunctionIndex_VertexTransform( bool useNormal, bool useViewPos )
+CContext::CContext()
+    : m_State( new SContextState() )
 {
-    useViewPos = useNormal ? useViewPos : false;
-    const uint32_t index = ( useNormal ? 0x1 : 0 ) | ( useViewPos ? 0x2 : 0 );
-    assert( index < VERTEX_TRANSFORM_FUNCTION_TABLE_SIZE );
-    return index;
 }
 
-static uint32_t MakeFunctionIndex_VertexTransform( const SPipelineState& state )
+CContext::~CContext()
 {
-    return MakeFunctionIndex_VertexTransform( state.m_LightingModel != ELightingModel::eUnlit, state.m_LightingModel == ELightingModel::eBlinnPhong || state.m_LightType == ELightType::ePoint );
+    delete m_State;
 }
 
-static uint32_t MakeFunctionIndex_PerspectiveDivision( bool useTexture, bool useColor, bool useNormal, bool useViewPos )
+void CContext::SetPositionStream( const SStream& stream )
 {
-    useViewPos = useNormal ? useViewPos : false;
-    const uint32_t index = ( useTexture ? 0x1 : 0 ) | ( useColor ? 0x2 : 0 ) | ( useNormal ? 0x4 : 0 ) | ( useViewPos ? 0x8 : 0 );
-    assert( index < PERSPECTIVE_DIVISION_FUNCTION_TABLE_SIZE );
-    return index;
+    m_State->streamSourcePos = stream;
 }
 
-static uint32_t MakeFunctionIndex_PerspectiveDivision( const SPipelineState& state )
+void CContext::SetNormalStream( const SStream& stream )
 {
-    return MakeFunctionIndex_PerspectiveDivision( state.m_UseTexture, state.m_UseVertexColor, state.m_LightingModel != ELightingModel::eUnlit,
-        state.m_LightingModel == ELightingModel::eBlinnPhong || state.m_LightType == ELightType::ePoint );
+    m_State->streamSourceNormal = stream;
 }
 
-static uint32_t MakeFunctionIndex_TriangleSetup( bool useTexture, bool useColor, bool useNormal, bool useViewPos )
+void CContext::SetTexcoordStream( const SStream& stream )
 {
-    useViewPos = useNormal ? useViewPos : false;
-    const uint32_t index = ( useTexture ? 0x1 : 0 ) | ( useColor ? 0x2 : 0 ) | ( useNormal ? 0x4 : 0 ) | ( useViewPos ? 0x8 : 0 );
-    assert( index < TRIANGLE_SETUP_FUNCTION_TABLE_SIZE );
-    return index;
+    m_State->streamSourceTex = stream;
 }
 
-static uint32_t MakeFunctionIndex_TriangleSetup( const SPipelineState& state )
+void CContext::SetColorStream( const SStream& stream )
 {
-    return MakeFunctionIndex_TriangleSetup( state.m_UseTexture, state.m_UseVertexColor, state.m_LightingModel != ELightingModel::eUnlit,
-        state.m_LightingModel == ELightingModel::eBlinnPhong || state.m_LightType == ELightType::ePoint );
+    m_State->streamSourceColor = stream;
 }
 
-static uint32_t MakeFunctionIndex_RasterizeTriangles( bool useTexture, bool useColor, ELightingModel lightingModel, ELightType lightType, bool enableAlphaTest, bool enableAlphaBlend )
+void CContext::SetIndexStream( const SStream& indices )
 {
-    lightType = lightingModel != ELightingModel::eUnlit ? lightType : ELightType::eDirectional;
-    const uint32_t index = ( useTexture ? 0x1 : 0 ) | ( useColor ? 0x2 : 0 ) | ( (uint32_t)lightingModel << 2 ) | ( (uint32_t)lightType << 4 ) | ( enableAlphaTest ? 0x20 : 0 ) | ( enableAlphaBlend ? 0x40 : 0 );
-    assert( index < RASTERIZING_FUNCTION_TABLE_SIZE );
-    return index;
+    m_State->streamSourceIndex = indices;
 }
 
-static uint32_t MakeFunctionIndex_RasterizeTriangles( const SPipelineState& state )
+void CContext::SetWorldViewTransform( const SMatrix& matrix )
 {
-    return MakeFunctionIndex_RasterizeTriangles( state.m_UseTexture, state.m_UseVertexColor, state.m_LightingModel, state.m_LightType, state.m_EnableAlphaTest, state.m_EnableAlphaBlend );
+    m_State->renderState.worldViewMatrix = matrix;
+    UpdateNormalMatrix( m_State->renderState );
+    UpdateWorldViewProjectionMatrix( m_State->renderState, m_State->projectionMatrix );
 }
 
-void Rasterizer::Initialize()
+void CContext::SetProjectionTransform( const SMatrix& matrix )
 {
-#define SET_VERTEX_TRANSFORM_FUNCTION_TABLE( useNormal, useViewPos ) \
-    s_VertexTransformFunctionTable[ MakeFunctionIndex_VertexTransform( useNormal, useViewPos ) ] = TransformVertices<useNormal, useViewPos>;
-
-    SET_VERTEX_TRANSFORM_FUNCTION_TABLE( false, false )
-    SET_VERTEX_TRANSFORM_FUNCTION_TABLE( true, false )
-    SET_VERTEX_TRANSFORM_FUNCTION_TABLE( true, true )
-#undef SET_VERTEX_TRANSFORM_FUNCTION_TABLE
-
-#define SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( useTexture, useColor, useNormal, useViewPos ) \
-    s_PerspectiveDivisionFunctionTable[ MakeFunctionIndex_PerspectiveDivision( useTexture, useColor, useNormal, useViewPos ) ] = PerspectiveDivision<useTexture, useColor, useNormal, useViewPos>;
-
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, false, false, false )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, false, true, false )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, false, true, true )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, true, false, false )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, true, true, false )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, true, true, true )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, false, false, false )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, false, true, false )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, false, true, true )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, true, false, false )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, true, true, false )
-    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, true, true, true )
-#undef SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE
-
-#define SET_TRIANGLE_SETUP_FUNCTION_TABLE( useTexture, useColor, useNormal, useViewPos ) \
-    s_TriangleSetupFunctionTable[ MakeFunctionIndex_TriangleSetup( useTexture, useColor, useNormal, useViewPos ) ] = SetupTriangles<useTexture, useColor, useNormal, useViewPos>;
-
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, false, false, false )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, false, true, false )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, false, true, true )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, true, false, false )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, true, true, false )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, true, true, true )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, false, false, false )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, false, true, false )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, false, true, true )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, true, false, false )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, true, true, false )
-    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, true, true, true )
-#undef SET_TRIANGLE_SETUP_FUNCTION_TABLE
-
-#define SET_RASTERIZING_FUNCTION_TABLE( useTexture, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend ) \
-    s_RasterizingFunctionTable[ MakeFunctionIndex_RasterizeTriangles( useTexture, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend ) ] = RasterizeTriangles<useTexture, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend>;
-    
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eUnlit, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::ePoint, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::ePoint, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eUnlit, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::ePoint, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::ePoint, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eUnlit, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eLambert, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eLambert, ELightType::ePoint, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eBlinnPhong, ELightType::ePoint, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eUnlit, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eLambert, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eLambert, ELightType::ePoint, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eBlinnPhong, ELightType::ePoint, false, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eUnlit, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::ePoint, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::ePoint, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eUnlit, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::ePoint, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::ePoint, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eUnlit, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eLambert, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eLambert, ELightType::ePoint, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eBlinnPhong, ELightType::ePoint, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eUnlit, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eLambert, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eLambert, ELightType::ePoint, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eBlinnPhong, ELightType::ePoint, true, false );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eUnlit, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::ePoint, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::ePoint, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eUnlit, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::ePoint, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::ePoint, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eUnlit, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eLambert, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eLambert, ELightType::ePoint, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eBlinnPhong, ELightType::ePoint, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eUnlit, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eLambert, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eLambert, ELightType::ePoint, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eBlinnPhong, ELightType::ePoint, false, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eUnlit, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::ePoint, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::ePoint, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eUnlit, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::ePoint, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::ePoint, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eUnlit, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eLambert, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eLambert, ELightType::ePoint, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, false, ELightingModel::eBlinnPhong, ELightType::ePoint, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eUnlit, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eLambert, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eLambert, ELightType::ePoint, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, true );
-    SET_RASTERIZING_FUNCTION_TABLE( true, true, ELightingModel::eBlinnPhong, ELightType::ePoint, true, true );
-
-#undef SET_RASTERIZING_FUNCTION_TABLE
+    m_State->projectionMatrix = matrix;
+    UpdateWorldViewProjectionMatrix( m_State->renderState, m_State->projectionMatrix );
 }
 
-void Rasterizer::SetPositionStream( const SStream& stream )
+void CContext::SetViewport( const SViewport& viewport )
 {
-    s_StreamSourcePos = stream;
-}
+    SRenderState& renderState = m_State->renderState;
+    renderState.viewport = viewport;
+    // Center the viewport at the rasterizer coordinate origin
+    renderState.rasterCoordStartX = -int32_t( viewport.m_Width * s_SubpixelStep / 2 );
+    renderState.rasterCoordStartY = -int32_t( viewport.m_Height * s_SubpixelStep / 2 );
+    renderState.rasterCoordEndX = renderState.rasterCoordStartX + renderState.viewport.m_Width * s_SubpixelStep - 1;
+    renderState.rasterCoordEndY = renderState.rasterCoordStartY + renderState.viewport.m_Height * s_SubpixelStep - 1;
 
-void Rasterizer::SetNormalStream( const SStream& stream )
-{
-    s_StreamSourceNormal = stream;
+    // The tiles of the viewport have to be aligned to the Hi-Z tiles to keep it up to date
+    if ( viewport.m_Left % s_TileSize != 0 || viewport.m_Top % s_TileSize != 0 )
+    {
+        m_State->isHiZValid = false;
+    }
 }
 
-void Rasterizer::SetTexcoordStream( const SStream& stream )
+void CContext::SetRenderTarget( const SImage& image )
 {
-    s_StreamSourceTex = stream;
+    m_State->renderState.renderTarget = image;
 }
 
-void Rasterizer::SetColorStream( const SStream& stream )
+void CContext::SetDepthTarget( const SImage& image )
 {
-    s_StreamSourceColor = stream;
+    m_State->renderState.depthTarget = image;
+
+    // The content of the new depth target is unknown until it is cleared
+    const uint32_t blocksCountX = MathHelper::DivideAndRoundUp( image.m_Width, (uint32_t)s_HiZBlockSize );
+    const uint32_t blocksCountY = MathHelper::DivideAndRoundUp( image.m_Height, (uint32_t)s_HiZBlockSize );
+    const uint32_t tilesCountX = MathHelper::DivideAndRoundUp( image.m_Width, (uint32_t)s_TileSize );
+    const uint32_t tilesCountY = MathHelper::DivideAndRoundUp( image.m_Height, (uint32_t)s_TileSize );
+    const uint32_t blocksCount = blocksCountX * blocksCountY;
+    const uint32_t tilesCount = tilesCountX * tilesCountY;
+    SHiZBuffer& hiZBuffer = m_State->hiZBuffer;
+    m_State->hiZStorage.resize( ( blocksCount + tilesCount ) * 2 );
+    hiZBuffer.blockMinZ = m_State->hiZStorage.data();
+    hiZBuffer.blockMaxZ = hiZBuffer.blockMinZ + blocksCount;
+    hiZBuffer.tileMinZ = hiZBuffer.blockMaxZ + blocksCount;
+    hiZBuffer.tileMaxZ = hiZBuffer.tileMinZ + tilesCount;
+    hiZBuffer.blocksCountX = blocksCountX;
+    hiZBuffer.tilesCountX = tilesCountX;
+    m_State->isHiZValid = false;
 }
 
-void Rasterizer::SetIndexStream( const SStream& indices )
+void CContext::ClearDepthTarget( float depth )
 {
-    s_StreamSourceIndex = indices;
+    const SImage& image = m_State->renderState.depthTarget;
+    std::fill( (float*)image.m_Bits, (float*)image.m_Bits + GetImageByteSize( image.m_Width, image.m_Height, 1, image.m_Layout ) / 4, depth );
+    std::fill( m_State->hiZStorage.begin(), m_State->hiZStorage.end(), depth );
+    m_State->isHiZValid = m_State->renderState.viewport.m_Left % s_TileSize == 0 && m_State->renderState.viewport.m_Top % s_TileSize == 0;
 }
 
-void Rasterizer::SetWorldViewTransform( const SMatrix& matrix )
+void CContext::SetMaterialDiffuse( SVector4 color )
 {
-    s_WorldViewMatrix = matrix;
-    UpdateNormalMatrix();
-    UpdateWorldViewProjectionMatrix();
+    m_State->renderState.material.m_Diffuse = color;
 }
 
-void Rasterizer::SetProjectionTransform( const SMatrix& matrix )
+void CContext::SetMaterial( const SMaterial& material )
 {
-    s_ProjectionMatrix = matrix;
-    UpdateWorldViewProjectionMatrix();
+    m_State->renderState.material = material;
 }
 
-void Rasterizer::SetViewport( const SViewport& viewport )
+void CContext::SetLight( const SLight& light )
 {
-    s_Viewport = viewport;
-    // Center the viewport at the rasterizer coordinate origin
-    s_RasterCoordStartX = -int32_t( viewport.m_Width * s_SubpixelStep / 2 );
-    s_RasterCoordStartY = -int32_t( viewport.m_Height * s_SubpixelStep / 2 );
-    s_RasterCoordEndX = s_RasterCoordStartX + s_Viewport.m_Width * s_SubpixelStep - 1;
-    s_RasterCoordEndY = s_RasterCoordStartY + s_Viewport.m_Height * s_SubpixelStep - 1;
+    m_State->renderState.light = light;
 }
 
-void Rasterizer::SetRenderTarget( const SImage& image )
+void CContext::SetTexture( const SImage& image )
 {
-    s_RenderTarget = image;
-}
-
-void Rasterizer::SetDepthTarget( const SImage& image )
-{
-    s_DepthTarget = image;
-}
-
-void Rasterizer::SetMaterialDiffuse( SVector4 color )
-{
-    s_Material.m_Diffuse = color;
-}
-
-void Rasterizer::SetMaterial( const SMaterial& material )
-{
-    s_Material = material;
+    assert( image.m_Layout != ETextureLayout::eTiled );
+    SRenderState& renderState = m_State->renderState;
+    renderState.texture = image;
+
+    STextureMipLevels& mipLevels = renderState.textureMipLevels;
+    mipLevels.count = std::min( std::max( image.m_MipLevelsCount, 1u ), s_MaxMipLevelsCount );
+    int32_t offset = 0;
+    for ( uint32_t level = 0; level < mipLevels.count; ++level )
+    {
+        const int32_t width = int32_t( std::max( image.m_Width >> level, 1u ) );
+        const int32_t height = int32_t( std::max( image.m_Height >> level, 1u ) );
+        mipLevels.widths[ level ] = width;
+        mipLevels.heights[ level ] = height;
+        mipLevels.offsets[ level ] = offset;
+        if ( IsBlockCompressed( image.m_Format ) )
+        {
+            mipLevels.pitches[ level ] = ( width + 3 ) / 4;
+            offset += mipLevels.pitches[ level ] * ( ( height + 3 ) / 4 );
+        }
+        else if ( image.m_Layout == ETextureLayout::eSwizzled )
+        {
+            mipLevels.pitches[ level ] = ( ( width + 3 ) / 4 ) * 16;
+            offset += mipLevels.pitches[ level ] * ( ( height + 3 ) / 4 );
+        }
+        else
+        {
+            mipLevels.pitches[ level ] = width;
+            offset += width * height;
+        }
+    }
 }
 
-void Rasterizer::SetLight( const SLight& light )
+void CContext::SetAlphaRef( uint8_t value )
 {
-    s_Light = light;
+    m_State->renderState.alphaRef = value;
 }
 
-void Rasterizer::SetTexture( const SImage& image )
+void CContext::SetEnableDepthWrite( bool enable )
 {
-    s_Texture = image;
+    m_State->renderState.enableDepthWrite = enable;
 }
 
-void Rasterizer::SetAlphaRef( uint8_t value )
+void CContext::SetCullMode( ECullMode mode )
 {
-    s_AlphaRef = value;
+    m_State->renderState.cullMode = mode;
 }
 
-void Rasterizer::SetEnableDepthWrite( bool enable )
+void CContext::SetIndexType( EIndexType type )
 {
-    s_EnableDepthWrite = enable;
+    m_State->renderState.indexType = type;
 }
 
-void Rasterizer::SetCullMode( ECullMode mode )
+void CContext::SetPipelineState( const SPipelineState& state )
 {
-    s_CullMode = mode;
-}
-
-void Rasterizer::SetIndexType( EIndexType type )
-{
-    s_IndexType = type;
-}
-
-void Rasterizer::SetPipelineState( const SPipelineState& state )
-{
-    s_PipelineState = state;
-    s_VertexTransformFunction = s_VertexTransformFunctionTable[ MakeFunctionIndex_VertexTransform( state ) ];
-    s_PerspectiveDivisionFunction = s_PerspectiveDivisionFunctionTable[ MakeFunctionIndex_PerspectiveDivision( state ) ];
-    s_TriangleSetupFunction = s_TriangleSetupFunctionTable[ MakeFunctionIndex_TriangleSetup( state ) ];
-    s_RasterizingFunction = s_RasterizingFunctionTable[ MakeFunctionIndex_RasterizeTriangles( state ) ];
+    m_State->pipelineState = state;
 }
 
 struct SAttributesLayout
@@ -1424,71 +838,1146 @@ SAttributeStreamPtrs GetAttributeStreamPointers( uint8_t* stream, const SAttribu
     return ptrs;
 }
 
-static void InternalDraw( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount, bool useIndex )
+// The intermediate vertices are stored as structure of arrays, every float of the layout is an array of verticesCapacity floats.
+// The pointers are to the arrays of the first component of each attribute, starting at firstVertex
+static SAttributeStreamPtrs GetVertexStreamPointers( uint8_t* vertices, const SAttributesLayout& layout, uint32_t verticesCapacity, uint32_t firstVertex )
 {
-    const uint32_t verticesCount = s_StreamSourcePos.m_Size / s_StreamSourcePos.m_Stride; // It is caller's responsibility to make sure other streams contains same numbers of vertices
-    const uint32_t roundedUpVerticesCount = MathHelper::DivideAndRoundUp( verticesCount, (uint32_t)SIMD_WIDTH ) * SIMD_WIDTH;
+    return GetAttributeStreamPointers( vertices + sizeof( float ) * firstVertex, { layout.size, layout.zOffset * verticesCapacity, layout.rcpwOffset * verticesCapacity,
+        layout.texcoordOffset * verticesCapacity, layout.colorOffset * verticesCapacity, layout.normalOffset * verticesCapacity, layout.viewPosOffset * verticesCapacity } );
+}
 
-    // Allocate intermediate vertices buffer
-    const SAttributesLayout vertexLayout = ComputeAttributesLayout( s_PipelineState, sizeof( float ) * 2, true, 1 ); // Keeping w to store the z from vertex transform
-    uint8_t* vertices = (uint8_t*)malloc( vertexLayout.size * roundedUpVerticesCount );
-    SAttributeStreamPtrs vertexStreamPtrs = GetAttributeStreamPointers( vertices, vertexLayout );
-    
-    // Vertex transform
+// Clip planes of the outcodes, only the near plane is always clipped against. The guard band planes are clipped against only when
+// the integer rasterizer coordinates of a vertex would overflow, triangles crossing the viewport edges are left to the rasterizer
+static const uint32_t s_ClipPlaneNear = 0;
+static const uint32_t s_ClipPlaneGuardBandLeft = 1;
+static const uint32_t s_ClipPlaneGuardBandRight = 2;
+static const uint32_t s_ClipPlaneGuardBandBottom = 3;
+static const uint32_t s_ClipPlaneGuardBandTop = 4;
+static const uint32_t s_ClipPlanesCount = 5;
+static const uint32_t s_MaxClippedVerticesCount = 3 + s_ClipPlanesCount; // Each plane adds one vertex to a convex polygon at most
+static const uint16_t s_ClipPlanesMask = ( 1 << s_ClipPlanesCount ) - 1;
+
+// Frustum planes of the outcodes, they only reject the triangles entirely outside
+static const uint16_t s_OutcodeLeft = 1 << ( s_ClipPlanesCount + 0 );
+static const uint16_t s_OutcodeRight = 1 << ( s_ClipPlanesCount + 1 );
+static const uint16_t s_OutcodeBottom = 1 << ( s_ClipPlanesCount + 2 );
+static const uint16_t s_OutcodeTop = 1 << ( s_ClipPlanesCount + 3 );
+static const uint16_t s_OutcodeFar = 1 << ( s_ClipPlanesCount + 4 );
+
+// Clip space position and the attributes before perspective division
+struct SClipVertex
+{
+    float pos[ 4 ];
+    float texcoord[ 2 ];
+    float color[ 3 ];
+    float normal[ 3 ];
+    float viewPos[ 3 ];
+};
+
+// The vertices emitted by clipping are appended to the transformed vertices, they keep texcoord and color in place until the perspective division.
+// The vertices are stored as structure of arrays, see GetVertexStreamPointers
+struct SClipContext
+{
+    uint8_t* vertices;
+    SAttributesLayout layout;
+    uint32_t firstClipVertex;
+    uint32_t verticesCount;
+    uint32_t verticesCapacity;
+    const uint8_t* inTexcoord;
+    const uint8_t* inColor;
+    const uint32_t* inVertexIndices; // See SDrawInput
+    uint32_t texcoordStride;
+    uint32_t colorStride;
+    float guardBandX; // Guard band limits of x/w and y/w
+    float guardBandY;
+    float halfRasterizerWidth; // Half viewport size in sub-pixels
+    float halfRasterizerHeight;
+    SFrameStats* stats;
+};
+
+static inline float* GetClipVertexComponent( const SClipContext& context, uint32_t offset, uint32_t index )
+{
+    return (float*)context.vertices + ( offset / sizeof( float ) ) * context.verticesCapacity + index;
+}
+
+static inline void LoadClipPosition( const SClipContext& context, uint32_t index, float* pos )
+{
+    pos[ 0 ] = *GetClipVertexComponent( context, 0, index );
+    pos[ 1 ] = *GetClipVertexComponent( context, sizeof( float ), index );
+    pos[ 2 ] = *GetClipVertexComponent( context, context.layout.zOffset, index );
+    pos[ 3 ] = *GetClipVertexComponent( context, context.layout.rcpwOffset, index ); // Keeps w until the perspective division
+}
+
+static inline float GetClipDistance( const SClipContext& context, const float* pos, uint32_t plane )
+{
+    switch ( plane )
+    {
+    case s_ClipPlaneNear:
+        return pos[ 2 ];
+    case s_ClipPlaneGuardBandLeft:
+        return context.guardBandX * pos[ 3 ] + pos[ 0 ];
+    case s_ClipPlaneGuardBandRight:
+        return context.guardBandX * pos[ 3 ] - pos[ 0 ];
+    case s_ClipPlaneGuardBandBottom:
+        return context.guardBandY * pos[ 3 ] + pos[ 1 ];
+    default:
+        return context.guardBandY * pos[ 3 ] - pos[ 1 ];
+    }
+}
+
+static inline void LoadClipComponents( const SClipContext& context, uint32_t offset, uint32_t index, float* values, uint32_t count )
+{
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+        values[ i ] = *GetClipVertexComponent( context, offset + sizeof( float ) * i, index );
+    }
+}
+
+static inline void StoreClipComponents( const SClipContext& context, uint32_t offset, uint32_t index, const float* values, uint32_t count )
+{
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+        *GetClipVertexComponent( context, offset + sizeof( float ) * i, index ) = values[ i ];
+    }
+}
+
+static void LoadClipVertex( const SClipContext& context, uint32_t index, SClipVertex* vertex )
+{
+    const bool isInput = index < context.firstClipVertex;
+    const uint32_t inIndex = isInput && context.inVertexIndices != nullptr ? context.inVertexIndices[ index ] : index;
+    LoadClipPosition( context, index, vertex->pos );
+    if ( context.layout.colorOffset > context.layout.texcoordOffset )
+    {
+        if ( isInput )
+        {
+            memcpy( vertex->texcoord, context.inTexcoord + size_t( inIndex ) * context.texcoordStride, sizeof( vertex->texcoord ) );
+        }
+        else
+        {
+            LoadClipComponents( context, context.layout.texcoordOffset, index, vertex->texcoord, 2 );
+        }
+    }
+    if ( context.layout.normalOffset > context.layout.colorOffset )
+    {
+        if ( isInput )
+        {
+            memcpy( vertex->color, context.inColor + size_t( inIndex ) * context.colorStride, sizeof( vertex->color ) );
+        }
+        else
+        {
+            LoadClipComponents( context, context.layout.colorOffset, index, vertex->color, 3 );
+        }
+    }
+    if ( context.layout.viewPosOffset > context.layout.normalOffset )
+    {
+        LoadClipComponents( context, context.layout.normalOffset, index, vertex->normal, 3 );
+    }
+    if ( context.layout.size > context.layout.viewPosOffset )
+    {
+        LoadClipComponents( context, context.layout.viewPosOffset, index, vertex->viewPos, 3 );
+    }
+}
+
+static void StoreClipVertex( const SClipContext& context, uint32_t index, const SClipVertex& vertex )
+{
+    *GetClipVertexComponent( context, 0, index ) = vertex.pos[ 0 ];
+    *GetClipVertexComponent( context, sizeof( float ), index ) = vertex.pos[ 1 ];
+    *GetClipVertexComponent( context, context.layout.zOffset, index ) = vertex.pos[ 2 ];
+    *GetClipVertexComponent( context, context.layout.rcpwOffset, index ) = vertex.pos[ 3 ];
+    if ( context.layout.colorOffset > context.layout.texcoordOffset )
+    {
+        StoreClipComponents( context, context.layout.texcoordOffset, index, vertex.texcoord, 2 );
+    }
+    if ( context.layout.normalOffset > context.layout.colorOffset )
+    {
+        StoreClipComponents( context, context.layout.colorOffset, index, vertex.color, 3 );
+    }
+    if ( context.layout.viewPosOffset > context.layout.normalOffset )
+    {
+        StoreClipComponents( context, context.layout.normalOffset, index, vertex.normal, 3 );
+    }
+    if ( context.layout.size > context.layout.viewPosOffset )
+    {
+        StoreClipComponents( context, context.layout.viewPosOffset, index, vertex.viewPos, 3 );
+    }
+}
+
+static inline __m128i __vectorcall OutcodeBit( __m128 distance, uint16_t bit )
+{
+    return _mm_and_si128( _mm_castps_si128( _mm_cmplt_ps( distance, _mm_setzero_ps() ) ), _mm_set1_epi32( bit ) );
+}
+
+// Computes the outcodes of 4 vertices at a time, the count must be a multiple of VERTEX_BATCH_SIZE
+static void ComputeOutcodes( const SClipContext& context, uint16_t* outcodes, uint32_t verticesCount )
+{
+    assert( verticesCount % VERTEX_BATCH_SIZE == 0 );
+
+    const __m128 guardBandX = _mm_set1_ps( context.guardBandX );
+    const __m128 guardBandY = _mm_set1_ps( context.guardBandY );
+    const float* inX = GetClipVertexComponent( context, 0, 0 );
+    const float* inY = GetClipVertexComponent( context, sizeof( float ), 0 );
+    const float* inZ = GetClipVertexComponent( context, context.layout.zOffset, 0 );
+    const float* inW = GetClipVertexComponent( context, context.layout.rcpwOffset, 0 );
+    for ( uint32_t i = 0; i < verticesCount; i += VERTEX_BATCH_SIZE )
+    {
+        const __m128 x = _mm_load_ps( inX + i );
+        const __m128 y = _mm_load_ps( inY + i );
+        const __m128 z = _mm_load_ps( inZ + i );
+        const __m128 w = _mm_load_ps( inW + i );
+        const __m128 guardBandW = _mm_mul_ps( guardBandX, w );
+        const __m128 guardBandH = _mm_mul_ps( guardBandY, w );
+
+        __m128i outcode = OutcodeBit( z, 1 << s_ClipPlaneNear );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_add_ps( guardBandW, x ), 1 << s_ClipPlaneGuardBandLeft ) );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_sub_ps( guardBandW, x ), 1 << s_ClipPlaneGuardBandRight ) );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_add_ps( guardBandH, y ), 1 << s_ClipPlaneGuardBandBottom ) );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_sub_ps( guardBandH, y ), 1 << s_ClipPlaneGuardBandTop ) );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_add_ps( w, x ), s_OutcodeLeft ) );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_sub_ps( w, x ), s_OutcodeRight ) );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_add_ps( w, y ), s_OutcodeBottom ) );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_sub_ps( w, y ), s_OutcodeTop ) );
+        outcode = _mm_or_si128( outcode, OutcodeBit( _mm_sub_ps( w, z ), s_OutcodeFar ) );
+        _mm_storel_epi64( (__m128i*)( outcodes + i ), _mm_packus_epi32( outcode, outcode ) );
+    }
+}
+
+// Tests the facing with the determinant of the clip space x, y and w divided by the w, the same as the area computed by the triangle setup.
+// Only the triangles whose facing can't be flipped by snapping the vertices to the sub-pixel grid are rejected
+static inline bool IsBackFacingInClipSpace( const SClipContext& context, ECullMode cullMode, uint32_t i0, uint32_t i1, uint32_t i2 )
+{
+    float p0[ 4 ], p1[ 4 ], p2[ 4 ];
+    LoadClipPosition( context, i0, p0 );
+    LoadClipPosition( context, i1, p1 );
+    LoadClipPosition( context, i2, p2 );
+    if ( p0[ 3 ] <= 0.f || p1[ 3 ] <= 0.f || p2[ 3 ] <= 0.f )
+    {
+        return false;
+    }
+
+    // Positions in sub-pixels
+    const float x0 = p0[ 0 ] / p0[ 3 ] * context.halfRasterizerWidth, y0 = p0[ 1 ] / p0[ 3 ] * context.halfRasterizerHeight;
+    const float x1 = p1[ 0 ] / p1[ 3 ] * context.halfRasterizerWidth, y1 = p1[ 1 ] / p1[ 3 ] * context.halfRasterizerHeight;
+    const float x2 = p2[ 0 ] / p2[ 3 ] * context.halfRasterizerWidth, y2 = p2[ 1 ] / p2[ 3 ] * context.halfRasterizerHeight;
+    const float doubleSignedArea = ( x1 - x0 ) * ( y2 - y0 ) - ( x2 - x0 ) * ( y1 - y0 );
+
+    // Moving every vertex by up to one sub-pixel changes the area by the edge lengths at most, plus the second order terms
+    const float snapError = fabsf( x1 - x0 ) + fabsf( y1 - y0 ) + fabsf( x2 - x1 ) + fabsf( y2 - y1 ) + fabsf( x0 - x2 ) + fabsf( y0 - y2 ) + 8.f;
+    return cullMode == ECullMode::eCullCW ? doubleSignedArea < -snapError : doubleSignedArea > snapError;
+}
+
+static const uint32_t s_VertexCacheSize = 256; // Entries of the post-transform cache of the sparse indexed draws, must be a power of 2
+static const uint32_t s_VertexCacheBatchTrianglesCount = 16; // Triangles looked up before their missed vertices are transformed, the widest SIMD width
+static const uint32_t s_VertexCacheJobTrianglesCount = 1024; // Triangles of a vertex cache job, every job starts with an empty cache
+
+// Vertex streams and indices consumed by a draw, the vertex streams point to the first vertex transformed
+struct SDrawInput
+{
+    const uint8_t* pos;
+    const uint8_t* normal;
+    const uint8_t* texcoord;
+    const uint8_t* color;
+    uint32_t posStride;
+    uint32_t normalStride;
+    uint32_t texcoordStride;
+    uint32_t colorStride;
+    const uint8_t* indices; // Null for non-indexed draws
+    uint32_t indexStride;
+    EIndexType indexType;
+    uint32_t minVertexIndex; // Subtracted from the indices
+    uint32_t verticesCount;
+    uint32_t trianglesCount;
+    const uint32_t* vertexIndices; // Input vertex of every vertex from the start of the streams, null when they follow each other
+};
+
+static inline void GetTriangleIndices( const SDrawInput& input, uint32_t triangle, uint32_t* i0, uint32_t* i1, uint32_t* i2 )
+{
+    if ( input.indices != nullptr )
+    {
+        ReadTriangleIndices( input.indices, triangle * 3, input.indexStride, input.indexType, i0, i1, i2 );
+        *i0 -= input.minVertexIndex;
+        *i1 -= input.minVertexIndex;
+        *i2 -= input.minVertexIndex;
+    }
+    else
     {
-        const uint8_t* inPos = s_StreamSourcePos.m_Data + s_StreamSourcePos.m_Offset + s_StreamSourcePos.m_Stride * baseVertexLocation;
-        const uint8_t* inNormal = s_StreamSourceNormal.m_Data + s_StreamSourceNormal.m_Offset + s_StreamSourceNormal.m_Stride * baseVertexLocation;
-        s_VertexTransformFunction( inPos, inNormal, vertexStreamPtrs.pos, vertexStreamPtrs.normal, vertexStreamPtrs.viewPos, 
-            s_StreamSourcePos.m_Stride, s_StreamSourceNormal.m_Stride, vertexLayout.size, roundedUpVerticesCount );
+        *i0 = triangle * 3;
+        *i1 = triangle * 3 + 1;
+        *i2 = triangle * 3 + 2;
     }
+}
+
+// Computes the upper bounds of the triangles and the new vertices after clipping
+static void CountClippingOutput( const SDrawInput& input, const uint16_t* outcodes, uint32_t* maxTrianglesCount, uint32_t* maxClipVerticesCount )
+{
+    *maxTrianglesCount = 0;
+    *maxClipVerticesCount = 0;
+    for ( uint32_t i = 0; i < input.trianglesCount; ++i )
+    {
+        uint32_t i0, i1, i2;
+        GetTriangleIndices( input, i, &i0, &i1, &i2 );
+        const uint16_t outcode0 = outcodes[ i0 ], outcode1 = outcodes[ i1 ], outcode2 = outcodes[ i2 ];
+        if ( ( outcode0 & outcode1 & outcode2 ) != 0 )
+        {
+            continue;
+        }
 
-    const uint8_t* sourceIndices = useIndex ? s_StreamSourceIndex.m_Data + s_StreamSourceIndex.m_Offset + s_StreamSourceIndex.m_Stride * baseIndexLocation : nullptr;
-    const uint32_t indexStride = s_IndexType == EIndexType::e16bit ? 2 : 4;
-    uint8_t* indices = (uint8_t*)malloc( indexStride * trianglesCount * 3 );
+        // Every plane crossed adds one triangle and two new vertices at most
+        uint32_t planesCount = 0;
+        for ( uint32_t clipMask = ( outcode0 | outcode1 | outcode2 ) & s_ClipPlanesMask; clipMask != 0; clipMask &= clipMask - 1 )
+        {
+            ++planesCount;
+        }
+        *maxTrianglesCount += 1 + planesCount;
+        *maxClipVerticesCount += 2 * planesCount;
+    }
+}
 
-    // Triangle cull
+// Sutherland-Hodgman clipping of a convex polygon, returns the vertices count of the clipped polygon
+static uint32_t ClipPolygon( SClipContext& context, uint32_t clipMask, uint32_t* polygon, uint32_t verticesCount )
+{
+    uint32_t buffer[ s_MaxClippedVerticesCount ];
+    uint32_t* input = polygon;
+    uint32_t* output = buffer;
+    for ( uint32_t plane = 0; plane < s_ClipPlanesCount && verticesCount > 0; ++plane )
     {
-        uint32_t newTrianglesCount = 0;
-        CullTriangles( vertexStreamPtrs.z, sourceIndices, indices, vertexLayout.size, s_StreamSourceIndex.m_Stride, indexStride, trianglesCount, newTrianglesCount );
-        trianglesCount = newTrianglesCount;
+        if ( ( clipMask & ( 1 << plane ) ) == 0 )
+        {
+            continue;
+        }
+
+        uint32_t outputCount = 0;
+        float pos[ 4 ];
+        LoadClipPosition( context, input[ verticesCount - 1 ], pos );
+        float prevDistance = GetClipDistance( context, pos, plane );
+        for ( uint32_t i = 0; i < verticesCount; ++i )
+        {
+            const uint32_t prevIndex = input[ i == 0 ? verticesCount - 1 : i - 1 ];
+            const uint32_t index = input[ i ];
+            LoadClipPosition( context, index, pos );
+            const float distance = GetClipDistance( context, pos, plane );
+            if ( ( prevDistance >= 0.f ) != ( distance >= 0.f ) )
+            {
+                // Always interpolate from the inside vertex, so the triangles sharing the edge get the same new vertex
+                const bool isPrevInside = prevDistance >= 0.f;
+                const float t = isPrevInside ? prevDistance / ( prevDistance - distance ) : distance / ( distance - prevDistance );
+                SClipVertex inside = {}, outside = {};
+                LoadClipVertex( context, isPrevInside ? prevIndex : index, &inside );
+                LoadClipVertex( context, isPrevInside ? index : prevIndex, &outside );
+                float* insideBits = (float*)&inside;
+                const float* outsideBits = (const float*)&outside;
+                for ( uint32_t j = 0; j < sizeof( SClipVertex ) / sizeof( float ); ++j )
+                {
+                    insideBits[ j ] += ( outsideBits[ j ] - insideBits[ j ] ) * t;
+                }
+
+                assert( context.verticesCount < context.verticesCapacity );
+                StoreClipVertex( context, context.verticesCount, inside );
+                output[ outputCount++ ] = context.verticesCount++;
+            }
+            if ( distance >= 0.f )
+            {
+                output[ outputCount++ ] = index;
+            }
+            prevDistance = distance;
+        }
+
+        std::swap( input, output );
+        verticesCount = outputCount;
     }
 
-    // Perspective division
+    if ( input != polygon )
     {
-        const uint8_t* inTexcoordStream = s_StreamSourceTex.m_Data + s_StreamSourceTex.m_Offset + s_StreamSourceTex.m_Stride * baseVertexLocation;
-        const uint8_t* inColorStream = s_StreamSourceColor.m_Data + s_StreamSourceColor.m_Offset + s_StreamSourceColor.m_Stride * baseVertexLocation;
-        s_PerspectiveDivisionFunction( inTexcoordStream, inColorStream, vertexStreamPtrs, vertexLayout.size,
-            s_StreamSourceTex.m_Stride, s_StreamSourceColor.m_Stride, roundedUpVerticesCount );
+        memcpy( polygon, input, sizeof( uint32_t ) * verticesCount );
     }
+    return verticesCount;
+}
+
+// Rejects the triangles outside any frustum plane or back facing, and clips the ones crossing the clip planes. The result triangles keep the input order,
+// the SIMD batches of the input vertices referenced by them are flagged in referencedBatches
+static uint32_t ClipTriangles( SClipContext& context, ECullMode cullMode, const SDrawInput& input, const uint16_t* outcodes,
+    uint32_t* outIndices, uint8_t* referencedBatches )
+{
+    uint32_t outputTrianglesCount = 0;
+    for ( uint32_t i = 0; i < input.trianglesCount; ++i )
+    {
+        uint32_t polygon[ s_MaxClippedVerticesCount ];
+        GetTriangleIndices( input, i, &polygon[ 0 ], &polygon[ 1 ], &polygon[ 2 ] );
+        const uint16_t outcode0 = outcodes[ polygon[ 0 ] ], outcode1 = outcodes[ polygon[ 1 ] ], outcode2 = outcodes[ polygon[ 2 ] ];
+        if ( ( outcode0 & outcode1 & outcode2 ) != 0 )
+        {
+            RASTERIZER_STATS( ++context.stats->m_TrianglesFrustumCulled; )
+            continue;
+        }
+
+        uint32_t verticesCount = 3;
+        const uint32_t clipMask = ( outcode0 | outcode1 | outcode2 ) & s_ClipPlanesMask;
+        if ( clipMask != 0 )
+        {
+            verticesCount = ClipPolygon( context, clipMask, polygon, verticesCount );
+            RASTERIZER_STATS( ++context.stats->m_TrianglesClipped; )
+        }
+        else if ( cullMode != ECullMode::eNone && IsBackFacingInClipSpace( context, cullMode, polygon[ 0 ], polygon[ 1 ], polygon[ 2 ] ) )
+        {
+            RASTERIZER_STATS( ++context.stats->m_TrianglesBackFaceCulled; )
+            continue;
+        }
+
+        for ( uint32_t j = 0; j < verticesCount; ++j )
+        {
+            if ( polygon[ j ] < context.firstClipVertex )
+            {
+                referencedBatches[ polygon[ j ] / VERTEX_BATCH_SIZE ] = 1;
+            }
+        }
+
+        // Triangulate the polygon as a fan, which keeps the winding
+        for ( uint32_t j = 2; j < verticesCount; ++j )
+        {
+            uint32_t* indices = outIndices + outputTrianglesCount * 3;
+            indices[ 0 ] = polygon[ 0 ];
+            indices[ 1 ] = polygon[ j - 1 ];
+            indices[ 2 ] = polygon[ j ];
+            ++outputTrianglesCount;
+        }
+    }
+    return outputTrianglesCount;
+}
+
+// Intermediate vertices of a draw in the frame arena, with the outcodes and the flags of the SIMD batches referenced by the triangles
+struct STransformedVertices
+{
+    SAttributesLayout layout;
+    uint8_t* vertices;
+    uint16_t* outcodes;
+    uint8_t* referencedBatches;
+    uint32_t capacity; // Vertices count rounded up to the SIMD batches
+};
+
+// The outcodes and the batch flags are allocated ahead, so the vertices buffer is the latest allocation and can grow in place for the vertices emitted by clipping
+static STransformedVertices AllocateTransformedVertices( SContextState& context, uint32_t verticesCount )
+{
+    STransformedVertices transformed;
+    transformed.capacity = MathHelper::DivideAndRoundUp( verticesCount, (uint32_t)VERTEX_BATCH_SIZE ) * VERTEX_BATCH_SIZE;
+    const uint32_t batchesCount = transformed.capacity / VERTEX_BATCH_SIZE;
+    transformed.outcodes = (uint16_t*)context.frameArena.Allocate( sizeof( uint16_t ) * transformed.capacity );
+    transformed.referencedBatches = (uint8_t*)context.frameArena.Allocate( batchesCount );
+    memset( transformed.referencedBatches, 0, batchesCount );
+    transformed.layout = ComputeAttributesLayout( context.pipelineState, sizeof( float ) * 2, true, 1 ); // Keeping w to store the z from vertex transform
+    transformed.vertices = (uint8_t*)context.frameArena.Allocate( transformed.layout.size * transformed.capacity );
+    return transformed;
+}
+
+// The vertex jobs are sized by the bytes read and written per batch
+static uint32_t GetVertexJobBatchesCount( const SDrawInput& input, const SAttributesLayout& vertexLayout )
+{
+    const uint32_t vertexJobBatchBytes = ( vertexLayout.size + input.posStride + input.normalStride + input.texcoordStride + input.colorStride ) * VERTEX_BATCH_SIZE;
+    return std::max( 1u, s_VertexJobBytes / vertexJobBatchBytes );
+}
+
+// Clips, sets up, bins and rasterizes the triangles of the transformed vertices, the indices of the input refer to the transformed vertices
+static void DrawTransformedVertices( SContextState& context, const SDrawInput& input, const STransformedVertices& transformed )
+{
+    const uint32_t roundedUpVerticesCount = transformed.capacity;
+
+    // The kernels are looked up on every draw so they follow SetInstructionSet
+    const SPipelineState& pipelineState = context.pipelineState;
+    const PerspectiveDivisionFunctionPtr perspectiveDivisionFunction = s_PerspectiveDivisionFunctionTable[ MakeFunctionIndex_PerspectiveDivision( pipelineState ) ];
+    const TriangleSetupFunctionPtr triangleSetupFunction = s_TriangleSetupFunctionTable[ MakeFunctionIndex_TriangleSetup( pipelineState ) ];
+    const RasterizingFunctionPtr rasterizingFunction = s_RasterizingFunctionTable[ MakeFunctionIndex_RasterizeTriangles( pipelineState ) ];
+
+    context.renderState.hiZ = context.isHiZValid ? &context.hiZBuffer : nullptr;
+
+    RASTERIZER_STATS(
+        CStageTimer stageTimer;
+        ++context.frameStats.m_DrawsCount;
+        context.frameStats.m_TrianglesSubmitted += input.trianglesCount; )
+    RASTERIZER_TRACE( CTraceTimer traceTimer( context.frameTrace ); )
+
+    const uint32_t batchesCount = roundedUpVerticesCount / VERTEX_BATCH_SIZE;
+    const SAttributesLayout vertexLayout = transformed.layout;
+    uint8_t* vertices = transformed.vertices;
+    uint16_t* outcodes = transformed.outcodes;
+    uint8_t* referencedBatches = transformed.referencedBatches;
+    const uint32_t vertexJobBatchesCount = GetVertexJobBatchesCount( input, vertexLayout );
+
+    // Triangle clipping
+    SClipContext clipContext;
+    clipContext.vertices = vertices;
+    clipContext.layout = vertexLayout;
+    clipContext.firstClipVertex = roundedUpVerticesCount; // Keeps the new vertices aligned to the SIMD batches
+    clipContext.verticesCount = roundedUpVerticesCount;
+    clipContext.verticesCapacity = roundedUpVerticesCount;
+    clipContext.inTexcoord = input.texcoord;
+    clipContext.inColor = input.color;
+    clipContext.inVertexIndices = input.vertexIndices;
+    clipContext.texcoordStride = input.texcoordStride;
+    clipContext.colorStride = input.colorStride;
+    clipContext.halfRasterizerWidth = context.renderState.viewport.m_Width * s_SubpixelStep * 0.5f;
+    clipContext.halfRasterizerHeight = context.renderState.viewport.m_Height * s_SubpixelStep * 0.5f;
+    // Viewports larger than the guard band get clipped at the viewport edges
+    clipContext.guardBandX = std::max( 1.f, s_GuardBandSize / clipContext.halfRasterizerWidth );
+    clipContext.guardBandY = std::max( 1.f, s_GuardBandSize / clipContext.halfRasterizerHeight );
+    clipContext.stats = &context.frameStats;
+    ComputeOutcodes( clipContext, outcodes, roundedUpVerticesCount );
+
+    uint32_t maxTrianglesCount, maxClipVerticesCount;
+    CountClippingOutput( input, outcodes, &maxTrianglesCount, &maxClipVerticesCount );
+    if ( maxClipVerticesCount > 0 )
+    {
+        const uint32_t roundedUpClipVerticesCount = MathHelper::DivideAndRoundUp( maxClipVerticesCount, (uint32_t)VERTEX_BATCH_SIZE ) * VERTEX_BATCH_SIZE;
+        clipContext.verticesCapacity += roundedUpClipVerticesCount;
+        vertices = (uint8_t*)context.frameArena.Grow( vertices, vertexLayout.size * roundedUpVerticesCount, vertexLayout.size * clipContext.verticesCapacity );
+        // Spread the component arrays to the new capacity, from the last one so none is overwritten before it moves
+        for ( uint32_t component = vertexLayout.size / sizeof( float ) - 1; component > 0; --component )
+        {
+            memmove( vertices + sizeof( float ) * clipContext.verticesCapacity * component, vertices + sizeof( float ) * roundedUpVerticesCount * component, sizeof( float ) * roundedUpVerticesCount );
+        }
+        clipContext.vertices = vertices;
+    }
+
+    // The result indices are always 32bit since the new vertices may not fit in 16bit
+    uint32_t* indices = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * maxTrianglesCount * 3 );
+    uint32_t trianglesCount = ClipTriangles( clipContext, context.renderState.cullMode, input, outcodes, indices, referencedBatches );
+    RASTERIZER_STATS( stageTimer.Lap( &context.frameStats.m_ClippingTime ); )
+    RASTERIZER_TRACE( traceTimer.Lap( "Clipping", "triangles", trianglesCount ); )
+
+    // Perspective division, only the runs of batches referenced by the surviving triangles. The batches of the new vertices follow the
+    // batches of the input vertices, so both are split in jobs together
+    const uint32_t clipBatchesCount = MathHelper::DivideAndRoundUp( clipContext.verticesCount - clipContext.firstClipVertex, (uint32_t)VERTEX_BATCH_SIZE );
+    const uint32_t vertexPitch = sizeof( float ) * clipContext.verticesCapacity; // Bytes between the component arrays
+    s_JobSystem.ParallelFor( batchesCount + clipBatchesCount, vertexJobBatchesCount, [ & ]( uint32_t batchBegin, uint32_t batchEnd )
+    {
+        const uint32_t inputBatchEnd = std::min( batchEnd, batchesCount );
+        for ( uint32_t batch = batchBegin; batch < inputBatchEnd; )
+        {
+            if ( referencedBatches[ batch ] == 0 )
+            {
+                ++batch;
+                continue;
+            }
+
+            uint32_t runEnd = batch + 1;
+            while ( runEnd < inputBatchEnd && referencedBatches[ runEnd ] != 0 )
+            {
+                ++runEnd;
+            }
+
+            // The input vertices are read through their indices, from the start of the streams, when they don't follow each other
+            const uint32_t firstVertex = batch * VERTEX_BATCH_SIZE;
+            const SAttributeStreamPtrs batchStreamPtrs = GetVertexStreamPointers( vertices, vertexLayout, clipContext.verticesCapacity, firstVertex );
+            const bool isIndexed = input.vertexIndices != nullptr;
+            perspectiveDivisionFunction( context.renderState, input.texcoord + ( isIndexed ? 0 : input.texcoordStride * firstVertex ), input.color + ( isIndexed ? 0 : input.colorStride * firstVertex ),
+                isIndexed ? input.vertexIndices + firstVertex : nullptr, batchStreamPtrs, vertexPitch, input.texcoordStride, input.colorStride, sizeof( float ), ( runEnd - batch ) * VERTEX_BATCH_SIZE );
+            batch = runEnd;
+        }
+
+        // The new vertices read texcoord and color from themselves
+        const uint32_t clipBatchBegin = std::max( batchBegin, batchesCount );
+        if ( batchEnd > clipBatchBegin )
+        {
+            const uint32_t firstVertex = clipBatchBegin * VERTEX_BATCH_SIZE;
+            const SAttributeStreamPtrs clipVertexStreamPtrs = GetVertexStreamPointers( vertices, vertexLayout, clipContext.verticesCapacity, firstVertex );
+            perspectiveDivisionFunction( context.renderState, clipVertexStreamPtrs.texcoord, clipVertexStreamPtrs.color, nullptr, clipVertexStreamPtrs, vertexPitch,
+                sizeof( float ), sizeof( float ), vertexPitch, ( batchEnd - clipBatchBegin ) * VERTEX_BATCH_SIZE );
+        }
+    } );
+    RASTERIZER_STATS( stageTimer.Lap( &context.frameStats.m_PerspectiveDivisionTime ); )
+    RASTERIZER_TRACE( traceTimer.Lap( "Perspective division", "clip vertices", clipContext.verticesCount - clipContext.firstClipVertex ); )
 
     // Allocate intermediate triangle buffer
     // Every triangle attribute needs 3 float: row start, row increment and vertical increment
-    const SAttributesLayout triangleLayout = ComputeAttributesLayout( s_PipelineState, sizeof( STriangleBaseAttributes ), false, 3 ); 
-    uint8_t* triangles = (uint8_t*)malloc( triangleLayout.size * trianglesCount );
+    const SAttributesLayout triangleLayout = ComputeAttributesLayout( pipelineState, sizeof( STriangleBaseAttributes ), false, 3 ); 
+    uint8_t* triangles = (uint8_t*)context.frameArena.Allocate( triangleLayout.size * trianglesCount );
     SAttributeStreamPtrs triangleStreamPtrs = GetAttributeStreamPointers( triangles, triangleLayout );
+    const SAttributeStreamPtrs vertexStreamPtrs = GetVertexStreamPointers( vertices, vertexLayout, clipContext.verticesCapacity, 0 );
 
-    // Triangle setup
+    // Triangle setup, every job writes the triangles passing the culling at the start of its own range then the ranges are packed in order
     {
-        s_TriangleSetupFunction( vertexStreamPtrs, indices, indexStride, triangleStreamPtrs, vertexLayout.size, triangleLayout.size, trianglesCount );
+        RASTERIZER_STATS( const uint32_t clippedTrianglesCount = trianglesCount; )
+        const uint32_t setupJobsCount = MathHelper::DivideAndRoundUp( trianglesCount, s_SetupJobTrianglesCount );
+        uint32_t* setupJobsOutputCount = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * setupJobsCount );
+        s_JobSystem.ParallelFor( setupJobsCount, 1, [ & ]( uint32_t jobBegin, uint32_t jobEnd )
+        {
+            for ( uint32_t i = jobBegin; i < jobEnd; ++i )
+            {
+                const uint32_t firstTriangle = i * s_SetupJobTrianglesCount;
+                const uint32_t jobTrianglesCount = std::min( s_SetupJobTrianglesCount, trianglesCount - firstTriangle );
+                const SAttributeStreamPtrs jobTriangleStreamPtrs = GetAttributeStreamPointers( triangles + triangleLayout.size * firstTriangle, triangleLayout );
+                setupJobsOutputCount[ i ] = triangleSetupFunction( context.renderState, vertexStreamPtrs, indices + firstTriangle * 3, jobTriangleStreamPtrs,
+                    vertexPitch, triangleLayout.size, jobTrianglesCount );
+            }
+        } );
+
+        uint32_t setupTrianglesCount = setupJobsCount > 0 ? setupJobsOutputCount[ 0 ] : 0;
+        for ( uint32_t i = 1; i < setupJobsCount; ++i )
+        {
+            memmove( triangles + triangleLayout.size * setupTrianglesCount, triangles + triangleLayout.size * i * s_SetupJobTrianglesCount, triangleLayout.size * setupJobsOutputCount[ i ] );
+            setupTrianglesCount += setupJobsOutputCount[ i ];
+        }
+        trianglesCount = setupTrianglesCount;
+        RASTERIZER_STATS(
+            context.frameStats.m_TrianglesSetupCulled += clippedTrianglesCount - trianglesCount;
+            context.frameStats.m_TrianglesRasterized += trianglesCount; )
     }
+    RASTERIZER_STATS( stageTimer.Lap( &context.frameStats.m_TriangleSetupTime ); )
+    RASTERIZER_TRACE( traceTimer.Lap( "Triangle setup", "triangles", trianglesCount ); )
+
+    // Bin triangles into screen tiles, which are the tiles of the tiled targets
+    assert( ( context.renderState.renderTarget.m_Layout != ETextureLayout::eTiled && context.renderState.depthTarget.m_Layout != ETextureLayout::eTiled )
+        || ( context.renderState.viewport.m_Left % s_TileSize == 0 && context.renderState.viewport.m_Top % s_TileSize == 0 ) );
+    const uint32_t tilesCountX = MathHelper::DivideAndRoundUp( context.renderState.viewport.m_Width, (uint32_t)s_TileSize );
+    const uint32_t tilesCountY = MathHelper::DivideAndRoundUp( context.renderState.viewport.m_Height, (uint32_t)s_TileSize );
+    const uint32_t tilesCount = tilesCountX * tilesCountY;
+    uint32_t* binOffsets = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * ( tilesCount + 1 ) );
+    uint32_t* activeTiles = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * tilesCount );
+    uint32_t* binnedTriangles = nullptr;
+    uint32_t activeTilesCount = 0;
+    {
+        // Count the triangles overlapping each tile
+        memset( binOffsets, 0, sizeof( uint32_t ) * ( tilesCount + 1 ) );
+        for ( uint32_t i = 0; i < trianglesCount; ++i )
+        {
+            uint32_t tileMinX, tileMaxX, tileMinY, tileMaxY;
+            GetTriangleTileRange( triangleStreamPtrs.base + i * triangleLayout.size, context.renderState.viewport, &tileMinX, &tileMaxX, &tileMinY, &tileMaxY );
+            for ( uint32_t tileY = tileMinY; tileY <= tileMaxY; ++tileY )
+            {
+                for ( uint32_t tileX = tileMinX; tileX <= tileMaxX; ++tileX )
+                {
+                    ++binOffsets[ tileY * tilesCountX + tileX + 1 ];
+                }
+            }
+        }
 
-    free( indices );
-    free( vertices );
+        // Prefix sum the counts into offsets
+        for ( uint32_t i = 0; i < tilesCount; ++i )
+        {
+            if ( binOffsets[ i + 1 ] != 0 )
+            {
+                activeTiles[ activeTilesCount++ ] = i;
+            }
+            binOffsets[ i + 1 ] += binOffsets[ i ];
+        }
+
+        // Fill the bins in submission order, the cursors start at the offsets of each tile
+        binnedTriangles = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * std::max( binOffsets[ tilesCount ], 1u ) );
+        uint32_t* binCursors = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * tilesCount );
+        memcpy( binCursors, binOffsets, sizeof( uint32_t ) * tilesCount );
+        for ( uint32_t i = 0; i < trianglesCount; ++i )
+        {
+            uint32_t tileMinX, tileMaxX, tileMinY, tileMaxY;
+            GetTriangleTileRange( triangleStreamPtrs.base + i * triangleLayout.size, context.renderState.viewport, &tileMinX, &tileMaxX, &tileMinY, &tileMaxY );
+            for ( uint32_t tileY = tileMinY; tileY <= tileMaxY; ++tileY )
+            {
+                for ( uint32_t tileX = tileMinX; tileX <= tileMaxX; ++tileX )
+                {
+                    binnedTriangles[ binCursors[ tileY * tilesCountX + tileX ]++ ] = i;
+                }
+            }
+        }
+    }
 
-    // Rasterize triangles
+    RASTERIZER_STATS( stageTimer.Lap( &context.frameStats.m_BinningTime ); )
+    RASTERIZER_TRACE( traceTimer.Lap( "Binning", "tiles", activeTilesCount ); )
+
+    // Rasterize tiles in parallel, with one slot per thread at most
     {
-        s_RasterizingFunction( triangleStreamPtrs, triangleLayout.size, trianglesCount );
+        const uint32_t slotsCount = std::min( activeTilesCount, s_JobSystem.GetThreadsCount() );
+        SRasterJob job;
+        job.function = rasterizingFunction;
+        job.state = &context.renderState;
+        job.triangles = triangleStreamPtrs;
+        job.trianglesStride = triangleLayout.size;
+        job.binnedTriangles = binnedTriangles;
+        job.binOffsets = binOffsets;
+        job.activeTiles = activeTiles;
+        job.activeTilesCount = activeTilesCount;
+        job.tilesCountX = tilesCountX;
+        job.nextTile.store( 0, std::memory_order_relaxed );
+        RASTERIZER_STATS( job.stats = {}; )
+#if defined( RASTERIZER_ENABLE_TRACE )
+        job.trace = &context.frameTrace;
+        job.lanes = nullptr;
+        if ( context.frameTrace.IsRecording() )
+        {
+            job.lanes = (SRasterLane*)context.frameArena.Allocate( sizeof( SRasterLane ) * slotsCount );
+            memset( job.lanes, 0, sizeof( SRasterLane ) * slotsCount );
+        }
+#endif
+        s_JobSystem.ParallelFor( slotsCount, 1, [ &job ]( uint32_t slotBegin, uint32_t slotEnd )
+        {
+            for ( uint32_t slot = slotBegin; slot < slotEnd; ++slot )
+            {
+                ExecuteRasterJob( job, slot );
+            }
+        } );
+
+#if defined( RASTERIZER_ENABLE_TRACE )
+        // The slots which got no tile are left out
+        for ( uint32_t i = 0; job.lanes && i < slotsCount; ++i )
+        {
+            const SRasterLane& lane = job.lanes[ i ];
+            if ( lane.tilesCount > 0 )
+            {
+                CFrameTrace::SEvent event = { "Rasterize tiles", lane.begin, lane.end, lane.threadIndex, { "tiles", nullptr }, { lane.tilesCount, 0 } };
+                context.frameTrace.AddEvent( event );
+            }
+        }
+        traceTimer.Lap( "Rasterization", "tiles", activeTilesCount );
+#endif
+
+        RASTERIZER_STATS(
+            context.frameStats.m_PixelsTested += job.stats.pixelsTested;
+            context.frameStats.m_PixelsDepthPassed += job.stats.pixelsDepthPassed;
+            context.frameStats.m_PixelsAlphaKilled += job.stats.pixelsAlphaKilled;
+            context.frameStats.m_PixelsWritten += job.stats.pixelsWritten;
+            stageTimer.Lap( &context.frameStats.m_RasterizationTime ); )
     }
+}
+
+static void InternalDraw( SContextState& context, const SDrawInput& input )
+{
+    const VertexTransformFunctionPtr vertexTransformFunction = s_VertexTransformFunctionTable[ MakeFunctionIndex_VertexTransform( context.pipelineState ) ];
 
-    free( triangles );
+    RASTERIZER_STATS(
+        CStageTimer stageTimer;
+        context.frameStats.m_VerticesTransformed += input.verticesCount; )
+    RASTERIZER_TRACE( CTraceTimer traceTimer( context.frameTrace ); )
+
+    // All the intermediate buffers live in the frame arena, they are released at once when the draw is done
+    const CFrameArena::SMarker frameArenaMarker = context.frameArena.GetMarker();
+    const STransformedVertices transformed = AllocateTransformedVertices( context, input.verticesCount );
+
+    // Vertex transform, split in runs of SIMD batches
+    s_JobSystem.ParallelFor( transformed.capacity / VERTEX_BATCH_SIZE, GetVertexJobBatchesCount( input, transformed.layout ), [ & ]( uint32_t batchBegin, uint32_t batchEnd )
+    {
+        const uint32_t firstVertex = batchBegin * VERTEX_BATCH_SIZE;
+        const SAttributeStreamPtrs batchStreamPtrs = GetVertexStreamPointers( transformed.vertices, transformed.layout, transformed.capacity, firstVertex );
+        vertexTransformFunction( context.renderState, input.pos + input.posStride * firstVertex, input.normal + input.normalStride * firstVertex, nullptr,
+            batchStreamPtrs.pos, batchStreamPtrs.normal, batchStreamPtrs.viewPos,
+            input.posStride, input.normalStride, sizeof( float ) * transformed.capacity, ( batchEnd - batchBegin ) * VERTEX_BATCH_SIZE );
+    } );
+    RASTERIZER_STATS( stageTimer.Lap( &context.frameStats.m_VertexTransformTime ); )
+    RASTERIZER_TRACE( traceTimer.Lap( "Vertex transform", "vertices", input.verticesCount ); )
+
+    DrawTransformedVertices( context, input, transformed );
+
+    context.frameArena.Rewind( frameArenaMarker );
+}
+
+void CContext::BeginFrame()
+{
+    m_State->frameArena.Reset();
+    m_State->frameStats = {};
+    RASTERIZER_TRACE( m_State->frameTrace.BeginFrame(); )
+}
+
+const SFrameStats& CContext::GetFrameStats()
+{
+    return m_State->frameStats;
+}
+
+bool CContext::StartFrameTrace( const char* filenamePrefix )
+{
+#if defined( RASTERIZER_ENABLE_TRACE )
+    m_State->frameTrace.Start( filenamePrefix );
+    return true;
+#else
+    (void)filenamePrefix;
+    return false;
+#endif
+}
+
+void CContext::StopFrameTrace()
+{
+    RASTERIZER_TRACE( m_State->frameTrace.Stop(); )
+}
+
+size_t CContext::GetFrameMemoryPeakUsage()
+{
+    return m_State->frameArena.GetPeakUsage();
+}
+
+void CContext::ReserveFrameMemory( size_t size )
+{
+    m_State->frameArena.Reserve( size );
+}
+
+// Finds the range of the vertices referenced by the indices
+static void ComputeIndexRange( const uint8_t* indices, uint32_t indexStride, EIndexType indexType, uint32_t indicesCount, uint32_t* minIndex, uint32_t* maxIndex )
+{
+    uint32_t minValue = UINT32_MAX, maxValue = 0;
+    if ( indexType == EIndexType::e16bit )
+    {
+        for ( uint32_t i = 0; i < indicesCount; ++i )
+        {
+            const uint32_t index = *(const uint16_t*)( indices + i * indexStride );
+            minValue = std::min( minValue, index );
+            maxValue = std::max( maxValue, index );
+        }
+    }
+    else
+    {
+        for ( uint32_t i = 0; i < indicesCount; ++i )
+        {
+            const uint32_t index = *(const uint32_t*)( indices + i * indexStride );
+            minValue = std::min( minValue, index );
+            maxValue = std::max( maxValue, index );
+        }
+    }
+    *minIndex = minValue;
+    *maxIndex = maxValue;
+}
+
+// Fills the draw input from the bound streams
+static SDrawInput MakeDrawInput( const SContextState& context, uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount, uint32_t minVertexIndex, uint32_t verticesCount, bool useIndex )
+{
+    const uint32_t firstVertex = baseVertexLocation + minVertexIndex;
+    SDrawInput input;
+    input.pos = context.streamSourcePos.m_Data + context.streamSourcePos.m_Offset + context.streamSourcePos.m_Stride * firstVertex;
+    input.normal = context.streamSourceNormal.m_Data + context.streamSourceNormal.m_Offset + context.streamSourceNormal.m_Stride * firstVertex;
+    input.texcoord = context.streamSourceTex.m_Data + context.streamSourceTex.m_Offset + context.streamSourceTex.m_Stride * firstVertex;
+    input.color = context.streamSourceColor.m_Data + context.streamSourceColor.m_Offset + context.streamSourceColor.m_Stride * firstVertex;
+    input.posStride = context.streamSourcePos.m_Stride;
+    input.normalStride = context.streamSourceNormal.m_Stride;
+    input.texcoordStride = context.streamSourceTex.m_Stride;
+    input.colorStride = context.streamSourceColor.m_Stride;
+    input.indices = useIndex ? context.streamSourceIndex.m_Data + context.streamSourceIndex.m_Offset + context.streamSourceIndex.m_Stride * baseIndexLocation : nullptr;
+    input.indexStride = context.streamSourceIndex.m_Stride;
+    input.indexType = context.renderState.indexType;
+    input.minVertexIndex = minVertexIndex;
+    input.verticesCount = verticesCount;
+    input.trianglesCount = trianglesCount;
+    input.vertexIndices = nullptr;
+    return input;
+}
+
+// Transforms only the vertices referenced by the indices, deduplicated by a direct mapped cache keyed by the index. The triangles are looked up
+// one SIMD batch at a time and the vertices they missed are transformed before the next batch, so a vertex is only transformed again when it was
+// evicted from the cache. The triangles are then drawn with their indices remapped to the transformed vertices. The triangles are split in jobs
+// with their own cache, the misses of every job are counted ahead so the jobs write their vertices in submission order
+static void InternalDrawThroughVertexCache( SContextState& context, const SDrawInput& input )
+{
+    const VertexTransformFunctionPtr vertexTransformFunction = s_VertexTransformFunctionTable[ MakeFunctionIndex_VertexTransform( context.pipelineState ) ];
+
+    RASTERIZER_STATS( CStageTimer stageTimer; )
+    RASTERIZER_TRACE( CTraceTimer traceTimer( context.frameTrace ); )
+
+    const CFrameArena::SMarker frameArenaMarker = context.frameArena.GetMarker();
+
+    // Count the vertices missed by every job, rounded up to the SIMD batches, then prefix sum them into the first vertex of every job
+    const uint32_t jobsCount = MathHelper::DivideAndRoundUp( input.trianglesCount, s_VertexCacheJobTrianglesCount );
+    uint32_t* jobFirstVertex = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * ( jobsCount + 1 ) );
+    s_JobSystem.ParallelFor( jobsCount, 1, [ & ]( uint32_t jobBegin, uint32_t jobEnd )
+    {
+        for ( uint32_t job = jobBegin; job < jobEnd; ++job )
+        {
+            uint32_t cacheTags[ s_VertexCacheSize ];
+            std::fill( cacheTags, cacheTags + s_VertexCacheSize, UINT32_MAX );
+            uint32_t missesCount = 0;
+            const uint32_t lastTriangle = std::min( ( job + 1 ) * s_VertexCacheJobTrianglesCount, input.trianglesCount );
+            for ( uint32_t i = job * s_VertexCacheJobTrianglesCount; i < lastTriangle; ++i )
+            {
+                uint32_t triangleIndices[ 3 ];
+                GetTriangleIndices( input, i, &triangleIndices[ 0 ], &triangleIndices[ 1 ], &triangleIndices[ 2 ] );
+                for ( uint32_t j = 0; j < 3; ++j )
+                {
+                    const uint32_t slot = triangleIndices[ j ] & ( s_VertexCacheSize - 1 );
+                    if ( cacheTags[ slot ] != triangleIndices[ j ] )
+                    {
+                        cacheTags[ slot ] = triangleIndices[ j ];
+                        ++missesCount;
+                    }
+                }
+            }
+            jobFirstVertex[ job + 1 ] = MathHelper::DivideAndRoundUp( missesCount, (uint32_t)VERTEX_BATCH_SIZE ) * VERTEX_BATCH_SIZE;
+        }
+    } );
+    jobFirstVertex[ 0 ] = 0;
+    for ( uint32_t i = 0; i < jobsCount; ++i )
+    {
+        jobFirstVertex[ i + 1 ] += jobFirstVertex[ i ];
+    }
+    const uint32_t verticesCount = jobFirstVertex[ jobsCount ];
+
+    uint32_t* remappedIndices = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * input.trianglesCount * 3 );
+    uint32_t* vertexIndices = (uint32_t*)context.frameArena.Allocate( sizeof( uint32_t ) * verticesCount );
+    const STransformedVertices transformed = AllocateTransformedVertices( context, verticesCount );
+
+    // Look up the triangles again, transforming the missed vertices after every SIMD batch of triangles
+    s_JobSystem.ParallelFor( jobsCount, 1, [ & ]( uint32_t jobBegin, uint32_t jobEnd )
+    {
+        for ( uint32_t job = jobBegin; job < jobEnd; ++job )
+        {
+            uint32_t cacheTags[ s_VertexCacheSize ];
+            uint32_t cacheEntries[ s_VertexCacheSize ];
+            std::fill( cacheTags, cacheTags + s_VertexCacheSize, UINT32_MAX );
+            uint32_t missesEnd = jobFirstVertex[ job ];
+            uint32_t transformedEnd = jobFirstVertex[ job ];
+            const uint32_t lastTriangle = std::min( ( job + 1 ) * s_VertexCacheJobTrianglesCount, input.trianglesCount );
+            for ( uint32_t batch = job * s_VertexCacheJobTrianglesCount; batch < lastTriangle; batch += s_VertexCacheBatchTrianglesCount )
+            {
+                const uint32_t batchEnd = std::min( batch + s_VertexCacheBatchTrianglesCount, lastTriangle );
+                for ( uint32_t i = batch; i < batchEnd; ++i )
+                {
+                    uint32_t triangleIndices[ 3 ];
+                    GetTriangleIndices( input, i, &triangleIndices[ 0 ], &triangleIndices[ 1 ], &triangleIndices[ 2 ] );
+                    for ( uint32_t j = 0; j < 3; ++j )
+                    {
+                        const uint32_t index = triangleIndices[ j ];
+                        const uint32_t slot = index & ( s_VertexCacheSize - 1 );
+                        if ( cacheTags[ slot ] != index )
+                        {
+                            vertexIndices[ missesEnd ] = index;
+                            cacheTags[ slot ] = index;
+                            cacheEntries[ slot ] = missesEnd++;
+                        }
+                        remappedIndices[ i * 3 + j ] = cacheEntries[ slot ];
+                    }
+                }
+
+                // The last batch is padded with its last vertex up to the SIMD batches
+                if ( batchEnd == lastTriangle )
+                {
+                    for ( ; missesEnd < jobFirstVertex[ job + 1 ]; ++missesEnd )
+                    {
+                        vertexIndices[ missesEnd ] = vertexIndices[ missesEnd - 1 ];
+                    }
+                }
+
+                const uint32_t transformCount = ( missesEnd - transformedEnd ) / VERTEX_BATCH_SIZE * VERTEX_BATCH_SIZE;
+                if ( transformCount > 0 )
+                {
+                    const SAttributeStreamPtrs batchStreamPtrs = GetVertexStreamPointers( transformed.vertices, transformed.layout, transformed.capacity, transformedEnd );
+                    vertexTransformFunction( context.renderState, input.pos, input.normal, vertexIndices + transformedEnd,
+                        batchStreamPtrs.pos, batchStreamPtrs.normal, batchStreamPtrs.viewPos,
+                        input.posStride, input.normalStride, sizeof( float ) * transformed.capacity, transformCount );
+                    transformedEnd += transformCount;
+                }
+            }
+        }
+    } );
+    RASTERIZER_STATS(
+        context.frameStats.m_VerticesTransformed += verticesCount;
+        stageTimer.Lap( &context.frameStats.m_VertexTransformTime ); )
+    RASTERIZER_TRACE( traceTimer.Lap( "Vertex cache", "vertices", verticesCount ); )
+
+    SDrawInput cachedInput = input;
+    cachedInput.indices = (const uint8_t*)remappedIndices;
+    cachedInput.indexStride = sizeof( uint32_t );
+    cachedInput.indexType = EIndexType::e32bit;
+    cachedInput.minVertexIndex = 0;
+    cachedInput.verticesCount = verticesCount;
+    cachedInput.vertexIndices = vertexIndices;
+    DrawTransformedVertices( context, cachedInput, transformed );
+
+    context.frameArena.Rewind( frameArenaMarker );
+}
+
+// Sparse index ranges go through the vertex cache, the others transform the whole range. Both paths split their transforms between the threads,
+// so the crossover measured on one thread holds: triangle soups, which miss the cache on every index, break even between 1 and 2 vertices
+// per index with the bench kernels, meshes sharing their vertices already at about 1. The range has to be larger than 1.5 times the indices.
+// The cache reads the vertices through 32bit offsets, so it is only used when they all fit
+static void InternalDrawIndexed( SContextState& context, const SDrawInput& input )
+{
+    const uint64_t indicesCount = uint64_t( input.trianglesCount ) * 3;
+    const uint64_t maxStride = std::max( std::max( input.posStride, input.normalStride ), std::max( input.texcoordStride, input.colorStride ) );
+    if ( uint64_t( input.verticesCount ) * maxStride <= INT32_MAX && uint64_t( input.verticesCount ) * 2 > indicesCount * 3 )
+    {
+        InternalDrawThroughVertexCache( context, input );
+    }
+    else
+    {
+        InternalDraw( context, input );
+    }
+}
+
+void CContext::Draw( uint32_t baseVertexIndex, uint32_t trianglesCount )
+{
+    if ( trianglesCount == 0 )
+    {
+        return;
+    }
+    RASTERIZER_TRACE( CTraceScope traceScope( m_State->frameTrace, "Draw", "pipeline", MakeFunctionIndex_RasterizeTriangles( m_State->pipelineState ), "triangles", trianglesCount ); )
+    InternalDraw( *m_State, MakeDrawInput( *m_State, baseVertexIndex, 0, trianglesCount, 0, trianglesCount * 3, false ) );
+}
+
+void CContext::DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount )
+{
+    if ( trianglesCount == 0 )
+    {
+        return;
+    }
+    RASTERIZER_TRACE( CTraceScope traceScope( m_State->frameTrace, "DrawIndexed", "pipeline", MakeFunctionIndex_RasterizeTriangles( m_State->pipelineState ), "triangles", trianglesCount ); )
+    const SStream& indexStream = m_State->streamSourceIndex;
+    const uint8_t* indices = indexStream.m_Data + indexStream.m_Offset + indexStream.m_Stride * baseIndexLocation;
+    uint32_t minVertexIndex, maxVertexIndex;
+    ComputeIndexRange( indices, indexStream.m_Stride, m_State->renderState.indexType, trianglesCount * 3, &minVertexIndex, &maxVertexIndex );
+    InternalDrawIndexed( *m_State, MakeDrawInput( *m_State, baseVertexLocation, baseIndexLocation, trianglesCount, minVertexIndex, maxVertexIndex - minVertexIndex + 1, true ) );
+}
+
+void CContext::DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount, uint32_t minVertexIndex, uint32_t verticesCount )
+{
+    if ( trianglesCount == 0 )
+    {
+        return;
+    }
+    RASTERIZER_TRACE( CTraceScope traceScope( m_State->frameTrace, "DrawIndexed", "pipeline", MakeFunctionIndex_RasterizeTriangles( m_State->pipelineState ), "triangles", trianglesCount ); )
+    InternalDrawIndexed( *m_State, MakeDrawInput( *m_State, baseVertexLocation, baseIndexLocation, trianglesCount, minVertexIndex, verticesCount, true ) );
+}
+
+static CContext s_DefaultContext;
+
+CContext& Rasterizer::GetDefaultContext()
+{
+    return s_DefaultContext;
+}
+
+void Rasterizer::SetPositionStream( const SStream& stream )
+{
+    s_DefaultContext.SetPositionStream( stream );
+}
+
+void Rasterizer::SetNormalStream( const SStream& stream )
+{
+    s_DefaultContext.SetNormalStream( stream );
+}
+
+void Rasterizer::SetTexcoordStream( const SStream& stream )
+{
+    s_DefaultContext.SetTexcoordStream( stream );
+}
+
+void Rasterizer::SetColorStream( const SStream& stream )
+{
+    s_DefaultContext.SetColorStream( stream );
+}
+
+void Rasterizer::SetIndexStream( const SStream& stream )
+{
+    s_DefaultContext.SetIndexStream( stream );
+}
+
+void Rasterizer::SetWorldViewTransform( const SMatrix& matrix )
+{
+    s_DefaultContext.SetWorldViewTransform( matrix );
+}
+
+void Rasterizer::SetProjectionTransform( const SMatrix& matrix )
+{
+    s_DefaultContext.SetProjectionTransform( matrix );
+}
+
+void Rasterizer::SetViewport( const SViewport& viewport )
+{
+    s_DefaultContext.SetViewport( viewport );
+}
+
+void Rasterizer::SetRenderTarget( const SImage& image )
+{
+    s_DefaultContext.SetRenderTarget( image );
+}
+
+void Rasterizer::SetDepthTarget( const SImage& image )
+{
+    s_DefaultContext.SetDepthTarget( image );
+}
+
+void Rasterizer::ClearDepthTarget( float depth )
+{
+    s_DefaultContext.ClearDepthTarget( depth );
+}
+
+void Rasterizer::SetMaterialDiffuse( SVector4 color )
+{
+    s_DefaultContext.SetMaterialDiffuse( color );
+}
+
+void Rasterizer::SetMaterial( const SMaterial& material )
+{
+    s_DefaultContext.SetMaterial( material );
+}
+
+void Rasterizer::SetLight( const SLight& light )
+{
+    s_DefaultContext.SetLight( light );
+}
+
+void Rasterizer::SetTexture( const SImage& image )
+{
+    s_DefaultContext.SetTexture( image );
+}
+
+void Rasterizer::SetAlphaRef( uint8_t value )
+{
+    s_DefaultContext.SetAlphaRef( value );
+}
+
+void Rasterizer::SetEnableDepthWrite( bool enable )
+{
+    s_DefaultContext.SetEnableDepthWrite( enable );
+}
+
+void Rasterizer::SetCullMode( ECullMode mode )
+{
+    s_DefaultContext.SetCullMode( mode );
+}
+
+void Rasterizer::SetIndexType( EIndexType type )
+{
+    s_DefaultContext.SetIndexType( type );
+}
+
+void Rasterizer::SetPipelineState( const SPipelineState& state )
+{
+    s_DefaultContext.SetPipelineState( state );
+}
+
+void Rasterizer::BeginFrame()
+{
+    s_DefaultContext.BeginFrame();
+}
+
+size_t Rasterizer::GetFrameMemoryPeakUsage()
+{
+    return s_DefaultContext.GetFrameMemoryPeakUsage();
+}
+
+const SFrameStats& Rasterizer::GetFrameStats()
+{
+    return s_DefaultContext.GetFrameStats();
+}
+
+bool Rasterizer::StartFrameTrace( const char* filenamePrefix )
+{
+    return s_DefaultContext.StartFrameTrace( filenamePrefix );
+}
+
+void Rasterizer::StopFrameTrace()
+{
+    s_DefaultContext.StopFrameTrace();
+}
+
+void Rasterizer::ReserveFrameMemory( size_t size )
+{
+    s_DefaultContext.ReserveFrameMemory( size );
 }
 
 void Rasterizer::Draw( uint32_t baseVertexIndex, uint32_t trianglesCount )
 {
-    InternalDraw( baseVertexIndex, 0, trianglesCount, false );
+    s_DefaultContext.Draw( baseVertexIndex, trianglesCount );
 }
 
 void Rasterizer::DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount )
 {
-    InternalDraw( baseVertexLocation, baseIndexLocation, trianglesCount, true );
+    s_DefaultContext.DrawIndexed( baseVertexLocation, baseIndexLocation, trianglesCount );
+}
+
+void Rasterizer::DrawIndexed( uint32_t baseVertexLocation, uint32_t baseIndexLocation, uint32_t trianglesCount, uint32_t minVertexIndex, uint32_t verticesCount )
+{
+    s_DefaultContext.DrawIndexed( baseVertexLocation, baseIndexLocation, trianglesCount, minVertexIndex, verticesCount );
+}
+
+void Rasterizer::ExecuteCommandBuffer( const CCommandBuffer& commandBuffer )
+{
+    s_DefaultContext.ExecuteCommandBuffer( commandBuffer );
 }
@@ -0,0 +1,274 @@
+#pragma once
+
+#include "Rasterizer.h"
+
+// The vertex counts and first vertices passed to the vertex kernels are multiples of it and the vertex buffers are padded to it.
+// The kernels run SIMD_PIXEL_WIDTH vertices per vector, so the last vector of a run may be partially filled
+#define VERTEX_BATCH_SIZE 4
+
+#define VERTEX_TRANSFORM_FUNCTION_TABLE_SIZE 4
+#define PERSPECTIVE_DIVISION_FUNCTION_TABLE_SIZE 16
+#define TRIANGLE_SETUP_FUNCTION_TABLE_SIZE 16
+#define RASTERIZING_FUNCTION_TABLE_SIZE 384
+
+static const int32_t s_SubpixelStep = 16; // 4 bits sub-pixel precision
+static const int32_t s_GuardBandSize = 16384; // Max distance of the rasterizer coordinates from the viewport center, keeps the edge functions in triangle setup within 32bit
+static const int32_t s_TileSize = 64; // Size of the screen tiles in pixels, each tile is rasterized by one thread at a time
+static const int32_t s_HiZBlockSize = 8; // Size of the pixel blocks of the finer Hi-Z level
+static const int32_t s_HiZBlocksPerTile = s_TileSize / s_HiZBlockSize;
+
+static const uint32_t s_MaxMipLevelsCount = 16; // Enough for textures up to 32768x32768, the smaller levels of larger ones are ignored
+static const uint32_t s_TextureBlockCacheSize = 64; // Decoded blocks of the block compressed textures kept by the rasterizing kernels
+
+static_assert( s_TileSize % s_HiZBlockSize == 0 && s_HiZBlocksPerTile * s_HiZBlocksPerTile <= 64, "The Hi-Z blocks of a tile must fit in a 64bit mask" );
+
+// Statements only compiled in when the library is built with RASTERIZER_ENABLE_STATS
+#if defined( RASTERIZER_ENABLE_STATS )
+#define RASTERIZER_STATS( statement ) statement
+#else
+#define RASTERIZER_STATS( statement )
+#endif
+
+// Pixel counters of the rasterizing kernels, see Rasterizer::SFrameStats
+struct SRasterStats
+{
+    uint64_t pixelsTested;
+    uint64_t pixelsDepthPassed;
+    uint64_t pixelsAlphaKilled;
+    uint64_t pixelsWritten;
+};
+
+struct alignas( 16 ) SFloat4A
+{
+    float m_Data[ 4 ];
+};
+
+struct STriangleAttribute
+{
+    float row, a, b;
+};
+
+struct STriangleBaseAttributes
+{
+    int32_t minX, maxX, minY, maxY; // Inclusive bounding box in image coordinates
+    int32_t w0_row, w1_row, w2_row; // Edge functions at the pixel center of ( minX, minY )
+    int32_t a01, a12, a20; // Edge function increments along image axis x
+    int32_t b01, b12, b20; // Edge function increments along image axis y
+    float minZ, maxZ; // Depth range of the vertices
+    uint8_t faceSign;
+};
+
+struct SRasterTile
+{
+    int32_t minX, maxX, minY, maxY; // Inclusive bounds in image coordinates
+};
+
+struct SAttributeStreamPtrs
+{
+    union
+    {
+        uint8_t* pos;
+        uint8_t* base;
+    };
+    uint8_t* z;
+    union
+    {
+        uint8_t* w;
+        uint8_t* rcpw;
+    };
+    uint8_t* texcoord;
+    uint8_t* color;
+    uint8_t* normal;
+    uint8_t* viewPos;
+};
+
+using STriangleSetupInput = SAttributeStreamPtrs;
+using STriangleSetupOutput = SAttributeStreamPtrs;
+
+// Depth range of the depth target in 2 levels, the blocks of 8x8 pixels and the tiles. Both levels are aligned to the image origin,
+// so the Hi-Z is only maintained while the viewport origin is aligned to the tile size and no 2 threads share a block
+struct SHiZBuffer
+{
+    float* blockMinZ;
+    float* blockMaxZ;
+    float* tileMinZ;
+    float* tileMaxZ;
+    uint32_t blocksCountX;
+    uint32_t tilesCountX;
+};
+
+// Size of each mip level of the texture and where it starts in its texels, as int32 to be gathered by the samplers.
+// The pitch is the number of texels from a row to the next one, from a row of 4x4 blocks to the next one for the swizzled layout.
+// The offsets and pitches of the block compressed formats count blocks instead of texels
+struct STextureMipLevels
+{
+    uint32_t count;
+    int32_t widths[ s_MaxMipLevelsCount ];
+    int32_t heights[ s_MaxMipLevelsCount ];
+    int32_t pitches[ s_MaxMipLevelsCount ];
+    int32_t offsets[ s_MaxMipLevelsCount ];
+};
+
+// Blocks of a block compressed texture decoded to B8G8R8A8 texels in rows. Every rasterizing call decodes in its own cache on the stack of its
+// thread, a block is kept in the slot of its position modulo 8x8 blocks until another block of that slot is read. The blocks are tagged
+// with their address, so a cache must be cleared before reading another texture
+struct STextureBlockCache
+{
+    const uint8_t* blocks[ s_TextureBlockCacheSize ];
+    uint32_t texels[ s_TextureBlockCacheSize ][ 16 ];
+};
+
+static inline bool IsBlockCompressed( Rasterizer::ETextureFormat format )
+{
+    return format != Rasterizer::ETextureFormat::eB8G8R8A8;
+}
+
+static inline uint32_t GetBlockByteSize( Rasterizer::ETextureFormat format )
+{
+    return format == Rasterizer::ETextureFormat::eBC1 ? 8 : 16;
+}
+
+// Decodes a 4x4 block of a block compressed format to B8G8R8A8 texels in rows, implemented in TextureCompression.cpp
+void DecodeTextureBlock( Rasterizer::ETextureFormat format, const uint8_t* block, uint32_t* texels );
+
+// Address of the pixel of a render or depth target and the number of pixels between its rows. The pixels of the tiled targets
+// are addressed inside of their tile, which holds whole pixel blocks and Hi-Z blocks as the tiles of the viewport are aligned to it
+static inline uint32_t* GetTargetPixel( const Rasterizer::SImage& image, uint32_t x, uint32_t y, uint32_t* pitch )
+{
+    uint32_t* bits = (uint32_t*)image.m_Bits;
+    if ( image.m_Layout == Rasterizer::ETextureLayout::eTiled )
+    {
+        const uint32_t tilesCountX = ( image.m_Width + s_TileSize - 1 ) / s_TileSize;
+        const uint32_t tileIndex = ( y / s_TileSize ) * tilesCountX + x / s_TileSize;
+        *pitch = s_TileSize;
+        return bits + tileIndex * s_TileSize * s_TileSize + ( y % s_TileSize ) * s_TileSize + x % s_TileSize;
+    }
+    *pitch = image.m_Width;
+    return bits + y * image.m_Width + x;
+}
+
+// Render states read by the kernels
+struct SRenderState
+{
+    Rasterizer::SMatrix worldViewMatrix;
+    Rasterizer::SMatrix normalMatrix;
+    Rasterizer::SMatrix worldViewProjectionMatrix;
+    Rasterizer::SViewport viewport;
+    int32_t rasterCoordStartX, rasterCoordStartY;
+    int32_t rasterCoordEndX, rasterCoordEndY;
+    Rasterizer::ECullMode cullMode;
+    Rasterizer::EIndexType indexType;
+    bool enableDepthWrite;
+    uint8_t alphaRef;
+    Rasterizer::SMaterial material;
+    Rasterizer::SLight light;
+    Rasterizer::SImage renderTarget;
+    Rasterizer::SImage depthTarget;
+    Rasterizer::SImage texture;
+    STextureMipLevels textureMipLevels;
+    SHiZBuffer* hiZ; // Null if the Hi-Z doesn't match the content of the depth target
+};
+
+typedef void (*VertexTransformFunctionPtr)( const SRenderState&, const uint8_t*, const uint8_t*, const uint32_t*, uint8_t*, uint8_t*, uint8_t*, uint32_t, uint32_t, uint32_t, uint32_t );
+typedef void (*PerspectiveDivisionFunctionPtr)( const SRenderState&, const uint8_t*, const uint8_t*, const uint32_t*, SAttributeStreamPtrs, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t );
+typedef uint32_t (*TriangleSetupFunctionPtr)( const SRenderState&, const STriangleSetupInput&, const uint32_t*, STriangleSetupOutput, uint32_t, uint32_t, uint32_t );
+typedef void (*RasterizingFunctionPtr)( const SRenderState&, const STriangleSetupOutput&, uint32_t, const uint32_t*, uint32_t, const SRasterTile&, SRasterStats* );
+typedef void (*ResolveTileFunctionPtr)( const uint32_t*, uint32_t*, uint32_t, uint32_t, uint32_t );
+
+static inline uint32_t CountBits( uint32_t mask )
+{
+    mask = mask - ( ( mask >> 1 ) & 0x55555555 );
+    mask = ( mask & 0x33333333 ) + ( ( mask >> 2 ) & 0x33333333 );
+    return ( ( ( mask + ( mask >> 4 ) ) & 0x0F0F0F0F ) * 0x01010101 ) >> 24;
+}
+
+static inline void ReadTriangleIndices( const uint8_t* indices, uint32_t location, uint32_t stride, Rasterizer::EIndexType indexType, uint32_t* i0, uint32_t* i1, uint32_t* i2 )
+{
+    indices += location * stride;
+    const uint8_t* indexPtr0 = indices;
+    const uint8_t* indexPtr1 = indices + stride;
+    const uint8_t* indexPtr2 = indices + stride + stride;
+    if ( indexType == Rasterizer::EIndexType::e16bit )
+    {
+        *i0 = *( (uint16_t*)indexPtr0 );
+        *i1 = *( (uint16_t*)indexPtr1 );
+        *i2 = *( (uint16_t*)indexPtr2 );
+    }
+    else
+    {
+        *i0 = *( (uint32_t*)indexPtr0 );
+        *i1 = *( (uint32_t*)indexPtr1 );
+        *i2 = *( (uint32_t*)indexPtr2 );
+    }
+}
+
+static inline uint32_t MakeFunctionIndex_VertexTransform( bool useNormal, bool useViewPos )
+{
+    useViewPos = useNormal ? useViewPos : false;
+    const uint32_t index = ( useNormal ? 0x1 : 0 ) | ( useViewPos ? 0x2 : 0 );
+    assert( index < VERTEX_TRANSFORM_FUNCTION_TABLE_SIZE );
+    return index;
+}
+
+static inline uint32_t MakeFunctionIndex_VertexTransform( const Rasterizer::SPipelineState& state )
+{
+    return MakeFunctionIndex_VertexTransform( state.m_LightingModel != Rasterizer::ELightingModel::eUnlit, state.m_LightingModel == Rasterizer::ELightingModel::eBlinnPhong || state.m_LightType == Rasterizer::ELightType::ePoint );
+}
+
+static inline uint32_t MakeFunctionIndex_PerspectiveDivision( bool useTexture, bool useColor, bool useNormal, bool useViewPos )
+{
+    useViewPos = useNormal ? useViewPos : false;
+    const uint32_t index = ( useTexture ? 0x1 : 0 ) | ( useColor ? 0x2 : 0 ) | ( useNormal ? 0x4 : 0 ) | ( useViewPos ? 0x8 : 0 );
+    assert( index < PERSPECTIVE_DIVISION_FUNCTION_TABLE_SIZE );
+    return index;
+}
+
+static inline uint32_t MakeFunctionIndex_PerspectiveDivision( const Rasterizer::SPipelineState& state )
+{
+    return MakeFunctionIndex_PerspectiveDivision( state.m_UseTexture, state.m_UseVertexColor, state.m_LightingModel != Rasterizer::ELightingModel::eUnlit,
+        state.m_LightingModel == Rasterizer::ELightingModel::eBlinnPhong || state.m_LightType == Rasterizer::ELightType::ePoint );
+}
+
+static inline uint32_t MakeFunctionIndex_TriangleSetup( bool useTexture, bool useColor, bool useNormal, bool useViewPos )
+{
+    useViewPos = useNormal ? useViewPos : false;
+    const uint32_t index = ( useTexture ? 0x1 : 0 ) | ( useColor ? 0x2 : 0 ) | ( useNormal ? 0x4 : 0 ) | ( useViewPos ? 0x8 : 0 );
+    assert( index < TRIANGLE_SETUP_FUNCTION_TABLE_SIZE );
+    return index;
+}
+
+static inline uint32_t MakeFunctionIndex_TriangleSetup( const Rasterizer::SPipelineState& state )
+{
+    return MakeFunctionIndex_TriangleSetup( state.m_UseTexture, state.m_UseVertexColor, state.m_LightingModel != Rasterizer::ELightingModel::eUnlit,
+        state.m_LightingModel == Rasterizer::ELightingModel::eBlinnPhong || state.m_LightType == Rasterizer::ELightType::ePoint );
+}
+
+static inline uint32_t MakeFunctionIndex_RasterizeTriangles( bool useTexture, bool useColor, Rasterizer::ELightingModel lightingModel, Rasterizer::ELightType lightType, bool enableAlphaTest, bool enableAlphaBlend,
+    Rasterizer::ETextureFilter textureFilter )
+{
+    lightType = lightingModel != Rasterizer::ELightingModel::eUnlit ? lightType : Rasterizer::ELightType::eDirectional;
+    textureFilter = useTexture ? textureFilter : Rasterizer::ETextureFilter::ePoint;
+    const uint32_t index = ( useTexture ? 0x1 : 0 ) | ( useColor ? 0x2 : 0 ) | ( (uint32_t)lightingModel << 2 ) | ( (uint32_t)lightType << 4 ) | ( enableAlphaTest ? 0x20 : 0 ) | ( enableAlphaBlend ? 0x40 : 0 )
+        | ( (uint32_t)textureFilter << 7 );
+    assert( index < RASTERIZING_FUNCTION_TABLE_SIZE );
+    return index;
+}
+
+static inline uint32_t MakeFunctionIndex_RasterizeTriangles( const Rasterizer::SPipelineState& state )
+{
+    return MakeFunctionIndex_RasterizeTriangles( state.m_UseTexture, state.m_UseVertexColor, state.m_LightingModel, state.m_LightType, state.m_EnableAlphaTest, state.m_EnableAlphaBlend, state.m_TextureFilter );
+}
+
+// Every kernels translation unit is compiled for one instruction set and fills the function tables with its own kernels
+#define DECLARE_FILL_FUNCTION_TABLES( instructionSet ) \
+    namespace RasterizationKernels_##instructionSet \
+    { \
+        void FillFunctionTables( VertexTransformFunctionPtr* vertexTransformTable, PerspectiveDivisionFunctionPtr* perspectiveDivisionTable, \
+            TriangleSetupFunctionPtr* triangleSetupTable, RasterizingFunctionPtr* rasterizingTable, ResolveTileFunctionPtr* resolveTileFunction ); \
+    }
+
+DECLARE_FILL_FUNCTION_TABLES( SSE41 )
+DECLARE_FILL_FUNCTION_TABLES( AVX2 )
+DECLARE_FILL_FUNCTION_TABLES( AVX512 )
+
+#undef DECLARE_FILL_FUNCTION_TABLES
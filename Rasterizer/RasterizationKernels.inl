@@ -0,0 +1,1710 @@
+// Kernels of the pipeline stages, the file is included once per instruction set by RasterizationKernels_*.cpp
+// which compile it with the matching compiler options. RASTERIZATION_KERNELS_INSTRUCTION_SET names the instruction set.
+// Everything here has internal linkage, so the kernels compiled for different instruction sets are never mixed up by the linker.
+
+#include "SIMDMath.inl"
+#include "ImageOps.inl"
+#include "MathHelper.h"
+
+using namespace Rasterizer;
+
+// The vertex kernels run SIMD_PIXEL_WIDTH vertices per vector over runs of VERTEX_BATCH_SIZE vertices, lanesCount is the number of vertices
+// left in the run. The lanes past the run are zero and are never stored, the arrays of the vertices are only padded to VERTEX_BATCH_SIZE
+static inline SIMDMath::VFloat __vectorcall GatherFloats( const uint8_t* stream, uint32_t stride, uint32_t lanesCount )
+{
+    if ( lanesCount == SIMD_PIXEL_WIDTH )
+    {
+        return SIMDMath::GatherStrided( stream, stride );
+    }
+    alignas( SIMD_PIXEL_WIDTH * 4 ) float lanes[ SIMD_PIXEL_WIDTH ];
+    for ( uint32_t lane = 0; lane < SIMD_PIXEL_WIDTH; ++lane )
+    {
+        lanes[ lane ] = lane < lanesCount ? *(const float*)( stream + stride * lane ) : 0.f;
+    }
+    return SIMDMath::Load( lanes );
+}
+
+// Reads a float of the vertices first to first + lanesCount of a run. When inIndices is set they are the input vertices inIndices[ first ] on
+// and stream points to the input vertex 0, otherwise they follow each other in the stream
+static inline SIMDMath::VFloat __vectorcall GatherVertexFloats( const uint8_t* stream, uint32_t stride, const uint32_t* inIndices, uint32_t first, uint32_t lanesCount )
+{
+    if ( inIndices == nullptr )
+    {
+        return GatherFloats( stream + first * stride, stride, lanesCount );
+    }
+    if ( lanesCount == SIMD_PIXEL_WIDTH )
+    {
+        return SIMDMath::GatherIndexed( stream, inIndices + first, stride );
+    }
+    alignas( SIMD_PIXEL_WIDTH * 4 ) float lanes[ SIMD_PIXEL_WIDTH ];
+    for ( uint32_t lane = 0; lane < SIMD_PIXEL_WIDTH; ++lane )
+    {
+        lanes[ lane ] = lane < lanesCount ? *(const float*)( stream + size_t( inIndices[ first + lane ] ) * stride ) : 0.f;
+    }
+    return SIMDMath::Load( lanes );
+}
+
+// Loads/stores the lanes of a component array of the vertices, which is only aligned to VERTEX_BATCH_SIZE vertices
+static inline SIMDMath::VFloat __vectorcall LoadLanes( const float* component, uint32_t lanesCount )
+{
+    if ( lanesCount == SIMD_PIXEL_WIDTH )
+    {
+        return SIMDMath::LoadUnaligned( component );
+    }
+    alignas( SIMD_PIXEL_WIDTH * 4 ) float lanes[ SIMD_PIXEL_WIDTH ] = {};
+    memcpy( lanes, component, sizeof( float ) * lanesCount );
+    return SIMDMath::Load( lanes );
+}
+
+static inline void __vectorcall StoreLanes( float* component, SIMDMath::VFloat value, uint32_t lanesCount )
+{
+    if ( lanesCount == SIMD_PIXEL_WIDTH )
+    {
+        SIMDMath::StoreUnaligned( component, value );
+        return;
+    }
+    alignas( SIMD_PIXEL_WIDTH * 4 ) float lanes[ SIMD_PIXEL_WIDTH ];
+    SIMDMath::Store( lanes, value );
+    memcpy( component, lanes, sizeof( float ) * lanesCount );
+}
+
+// The output is structure of arrays, outPitch is the bytes between the arrays of the components of an attribute. The input vertices are
+// the ones of inIndices when it is set, see GatherVertexFloats
+template <bool UseNormal, bool UseViewPos>
+static void TransformVertices( 
+    const SRenderState& state,
+    const uint8_t* inPos,
+    const uint8_t* inNormal,
+    const uint32_t* inIndices,
+    uint8_t* outPos,
+    uint8_t* outNormal,
+    uint8_t* outViewPos,
+    uint32_t posStride,
+    uint32_t normalStride,
+    uint32_t outPitch,
+    uint32_t count
+    )
+{
+    using namespace SIMDMath;
+
+    assert( count % VERTEX_BATCH_SIZE == 0 );
+
+    VFloat m00 = Set1( state.worldViewProjectionMatrix.m_Data[ 0 ] );
+    VFloat m01 = Set1( state.worldViewProjectionMatrix.m_Data[ 1 ] );
+    VFloat m02 = Set1( state.worldViewProjectionMatrix.m_Data[ 2 ] );
+    VFloat m03 = Set1( state.worldViewProjectionMatrix.m_Data[ 3 ] );
+    VFloat m10 = Set1( state.worldViewProjectionMatrix.m_Data[ 4 ] );
+    VFloat m11 = Set1( state.worldViewProjectionMatrix.m_Data[ 5 ] );
+    VFloat m12 = Set1( state.worldViewProjectionMatrix.m_Data[ 6 ] );
+    VFloat m13 = Set1( state.worldViewProjectionMatrix.m_Data[ 7 ] );
+    VFloat m20 = Set1( state.worldViewProjectionMatrix.m_Data[ 8 ] );
+    VFloat m21 = Set1( state.worldViewProjectionMatrix.m_Data[ 9 ] );
+    VFloat m22 = Set1( state.worldViewProjectionMatrix.m_Data[ 10 ] );
+    VFloat m23 = Set1( state.worldViewProjectionMatrix.m_Data[ 11 ] );
+    VFloat m30 = Set1( state.worldViewProjectionMatrix.m_Data[ 12 ] );
+    VFloat m31 = Set1( state.worldViewProjectionMatrix.m_Data[ 13 ] );
+    VFloat m32 = Set1( state.worldViewProjectionMatrix.m_Data[ 14 ] );
+    VFloat m33 = Set1( state.worldViewProjectionMatrix.m_Data[ 15 ] );
+
+    VFloat n00, n01, n02, n10, n11, n12, n20, n21, n22, n30, n31, n32;
+    if ( UseViewPos )
+    {
+        n00 = Set1( state.worldViewMatrix.m_Data[ 0 ] );
+        n01 = Set1( state.worldViewMatrix.m_Data[ 1 ] );
+        n02 = Set1( state.worldViewMatrix.m_Data[ 2 ] );
+        n10 = Set1( state.worldViewMatrix.m_Data[ 4 ] );
+        n11 = Set1( state.worldViewMatrix.m_Data[ 5 ] );
+        n12 = Set1( state.worldViewMatrix.m_Data[ 6 ] );
+        n20 = Set1( state.worldViewMatrix.m_Data[ 8 ] );
+        n21 = Set1( state.worldViewMatrix.m_Data[ 9 ] );
+        n22 = Set1( state.worldViewMatrix.m_Data[ 10 ] );
+        n30 = Set1( state.worldViewMatrix.m_Data[ 12 ] );
+        n31 = Set1( state.worldViewMatrix.m_Data[ 13 ] );
+        n32 = Set1( state.worldViewMatrix.m_Data[ 14 ] );
+    }
+
+    for ( uint32_t first = 0; first < count; first += SIMD_PIXEL_WIDTH )
+    {
+        const uint32_t lanesCount = std::min( (uint32_t)SIMD_PIXEL_WIDTH, count - first );
+        VFloat x = GatherVertexFloats( inPos, posStride, inIndices, first, lanesCount );
+        VFloat y = GatherVertexFloats( sizeof( float ) + inPos, posStride, inIndices, first, lanesCount );
+        VFloat z = GatherVertexFloats( sizeof( float ) * 2 + inPos, posStride, inIndices, first, lanesCount );
+
+        // Clip space position
+        uint8_t* clipPos = outPos + first * sizeof( float );
+        StoreLanes( (float*)clipPos, Vec3DotVec4( x, y, z, m00, m10, m20, m30 ), lanesCount );
+        StoreLanes( (float*)( clipPos + outPitch ), Vec3DotVec4( x, y, z, m01, m11, m21, m31 ), lanesCount );
+        StoreLanes( (float*)( clipPos + outPitch * 2 ), Vec3DotVec4( x, y, z, m02, m12, m22, m32 ), lanesCount );
+        StoreLanes( (float*)( clipPos + outPitch * 3 ), Vec3DotVec4( x, y, z, m03, m13, m23, m33 ), lanesCount );
+
+        if ( UseViewPos )
+        { 
+            // Get view space position
+            uint8_t* viewPos = outViewPos + first * sizeof( float );
+            StoreLanes( (float*)viewPos, Vec3DotVec4( x, y, z, n00, n10, n20, n30 ), lanesCount );
+            StoreLanes( (float*)( viewPos + outPitch ), Vec3DotVec4( x, y, z, n01, n11, n21, n31 ), lanesCount );
+            StoreLanes( (float*)( viewPos + outPitch * 2 ), Vec3DotVec4( x, y, z, n02, n12, n22, n32 ), lanesCount );
+        }
+    }
+
+    if ( UseNormal )
+    { 
+        m00 = Set1( state.normalMatrix.m_Data[ 0 ] );
+        m01 = Set1( state.normalMatrix.m_Data[ 1 ] );
+        m02 = Set1( state.normalMatrix.m_Data[ 2 ] );
+        m10 = Set1( state.normalMatrix.m_Data[ 4 ] );
+        m11 = Set1( state.normalMatrix.m_Data[ 5 ] );
+        m12 = Set1( state.normalMatrix.m_Data[ 6 ] );
+        m20 = Set1( state.normalMatrix.m_Data[ 8 ] );
+        m21 = Set1( state.normalMatrix.m_Data[ 9 ] );
+        m22 = Set1( state.normalMatrix.m_Data[ 10 ] );
+
+        for ( uint32_t first = 0; first < count; first += SIMD_PIXEL_WIDTH )
+        {
+            const uint32_t lanesCount = std::min( (uint32_t)SIMD_PIXEL_WIDTH, count - first );
+            VFloat x = GatherVertexFloats( inNormal, normalStride, inIndices, first, lanesCount );
+            VFloat y = GatherVertexFloats( sizeof( float ) + inNormal, normalStride, inIndices, first, lanesCount );
+            VFloat z = GatherVertexFloats( sizeof( float ) * 2 + inNormal, normalStride, inIndices, first, lanesCount );
+            uint8_t* outComponents = outNormal + first * sizeof( float );
+            StoreLanes( (float*)outComponents, Vec3DotVec3( x, y, z, m00, m10, m20 ), lanesCount );
+            StoreLanes( (float*)( outComponents + outPitch ), Vec3DotVec3( x, y, z, m01, m11, m21 ), lanesCount );
+            StoreLanes( (float*)( outComponents + outPitch * 2 ), Vec3DotVec3( x, y, z, m02, m12, m22 ), lanesCount );
+        }
+    }
+}
+
+// Multiplies the 3 component arrays of an attribute by a factor, for the lanes of a vector of vertices
+static inline void __vectorcall MultiplyComponents3( uint8_t* stream, uint32_t pitch, SIMDMath::VFloat factor, uint32_t lanesCount )
+{
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        float* component = (float*)( stream + pitch * i );
+        StoreLanes( component, SIMDMath::Mul( LoadLanes( component, lanesCount ), factor ), lanesCount );
+    }
+}
+
+// The vertices are structure of arrays, pitch is the bytes between the arrays of the components of an attribute. The texcoord and color inputs
+// are read with their strides between the vertices and inComponentPitch between the components, from the input vertices of inIndices when it is set
+template <bool UseTexture, bool UseVertexColor, bool UseNormal, bool UseViewPos>
+static void PerspectiveDivision( const SRenderState& state, const uint8_t* inTex, const uint8_t* inColor, const uint32_t* inIndices,
+    SAttributeStreamPtrs streamPtrs,
+    uint32_t pitch, uint32_t texStride, uint32_t colorStride, uint32_t inComponentPitch,
+    uint32_t count )
+{
+    using namespace SIMDMath;
+
+    constexpr bool NeedRcpw = UseTexture || UseVertexColor || UseNormal;
+
+    assert( count % VERTEX_BATCH_SIZE == 0 );
+
+    const float halfRasterizerWidth = state.viewport.m_Width * s_SubpixelStep * 0.5f;
+    const float halfRasterizerHeight = state.viewport.m_Height * s_SubpixelStep * 0.5f;
+    const int32_t halfPixelOffset = s_SubpixelStep / 2;
+    const int32_t offsetX = state.rasterCoordStartX - halfPixelOffset;
+    const int32_t offsetY = state.rasterCoordStartY - halfPixelOffset;
+
+    const VFloat vHalfRasterizerWidth = Set1( halfRasterizerWidth );
+    const VFloat vHalfRasterizerHeight = Set1( halfRasterizerHeight );
+    const VInt vOffsetX = Set1( offsetX );
+    const VInt vOffsetY = Set1( offsetY );
+    const VFloat one = Set1( 1.f );
+    const VFloat half = Set1( .5f );
+
+    for ( uint32_t first = 0; first < count; first += SIMD_PIXEL_WIDTH )
+    {
+        const uint32_t lanesCount = std::min( (uint32_t)SIMD_PIXEL_WIDTH, count - first );
+        const uint32_t offset = first * sizeof( float );
+        float* posX = (float*)( streamPtrs.pos + offset );
+        float* posY = (float*)( streamPtrs.pos + offset + pitch );
+        float* z = (float*)( streamPtrs.z + offset );
+        float* w = (float*)( streamPtrs.w + offset );
+        VFloat vx = LoadLanes( posX, lanesCount );
+        VFloat vy = LoadLanes( posY, lanesCount );
+        VFloat vz = LoadLanes( z, lanesCount );
+        const VFloat rcpw = Div( one, LoadLanes( w, lanesCount ) );
+
+        vx = MulAdd( vx, rcpw, one ); // x = x / w - (-1)
+        vx = MulAdd( vx, vHalfRasterizerWidth, half ); // Add 0.5 for rounding
+        const VInt xi = Add( ConvertToInt( Floor( vx ) ), vOffsetX );
+
+        vy = MulAdd( vy, rcpw, one ); // y = y / w - (-1)
+        vy = MulAdd( vy, vHalfRasterizerHeight, half ); // Add 0.5 for rounding
+        const VInt yi = Add( ConvertToInt( Floor( vy ) ), vOffsetY );
+
+        vz = Mul( vz, rcpw );
+
+        StoreLanes( posX, CastToFloat( xi ), lanesCount );
+        StoreLanes( posY, CastToFloat( yi ), lanesCount );
+        StoreLanes( z, vz, lanesCount );
+
+        if ( NeedRcpw )
+        { 
+            StoreLanes( w, rcpw, lanesCount );
+        }
+
+        if ( UseTexture )
+        {
+            uint8_t* texcoord = streamPtrs.texcoord + offset;
+            const VFloat texU = GatherVertexFloats( inTex, texStride, inIndices, first, lanesCount );
+            const VFloat texV = GatherVertexFloats( inComponentPitch + inTex, texStride, inIndices, first, lanesCount );
+            StoreLanes( (float*)texcoord, Mul( texU, rcpw ), lanesCount );
+            StoreLanes( (float*)( texcoord + pitch ), Mul( texV, rcpw ), lanesCount );
+        }
+        
+        if ( UseVertexColor )
+        {
+            uint8_t* color = streamPtrs.color + offset;
+            const VFloat colorR = GatherVertexFloats( inColor, colorStride, inIndices, first, lanesCount );
+            const VFloat colorG = GatherVertexFloats( inComponentPitch + inColor, colorStride, inIndices, first, lanesCount );
+            const VFloat colorB = GatherVertexFloats( inComponentPitch * 2 + inColor, colorStride, inIndices, first, lanesCount );
+            StoreLanes( (float*)color, Mul( colorR, rcpw ), lanesCount );
+            StoreLanes( (float*)( color + pitch ), Mul( colorG, rcpw ), lanesCount );
+            StoreLanes( (float*)( color + pitch * 2 ), Mul( colorB, rcpw ), lanesCount );
+        }
+        
+        if ( UseNormal )
+        {
+            MultiplyComponents3( streamPtrs.normal + offset, pitch, rcpw, lanesCount );
+        }
+        
+        if ( UseViewPos )
+        {
+            MultiplyComponents3( streamPtrs.viewPos + offset, pitch, rcpw, lanesCount );
+        }
+    }
+}
+
+// The top left edges of the triangles of every lane, the edges are the same direction as the edge functions of SetupTriangles
+static inline SIMDMath::VInt __vectorcall IsTopLeftEdge( SIMDMath::VInt x0, SIMDMath::VInt y0, SIMDMath::VInt x1, SIMDMath::VInt y1 )
+{
+    using namespace SIMDMath;
+    const VInt isTop = And( CmpEq( y0, y1 ), CmpGt( x0, x1 ) );
+    const VInt isLeft = CmpGt( y0, y1 );
+    return Or( isLeft, isTop );
+}
+
+static inline SIMDMath::VFloat __vectorcall BarycentricInterplation( SIMDMath::VFloat attr0, SIMDMath::VFloat attr1, SIMDMath::VFloat attr2,
+    SIMDMath::VFloat w0, SIMDMath::VFloat w1, SIMDMath::VFloat w2 )
+{
+    using namespace SIMDMath;
+    return MulAdd( attr0, w0, MulAdd( attr1, w1, Mul( attr2, w2 ) ) );
+}
+
+// Tests if the triangle fails the depth test everywhere in its bounding box, with the finer Hi-Z level if the bounding box covers few blocks
+static inline bool IsOccludedByHiZ( const SHiZBuffer& hiZ, int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, float minZ )
+{
+    const uint32_t blockMinX = minX / s_HiZBlockSize, blockMaxX = maxX / s_HiZBlockSize;
+    const uint32_t blockMinY = minY / s_HiZBlockSize, blockMaxY = maxY / s_HiZBlockSize;
+    if ( ( blockMaxX - blockMinX + 1 ) * ( blockMaxY - blockMinY + 1 ) <= 16 )
+    {
+        for ( uint32_t blockY = blockMinY; blockY <= blockMaxY; ++blockY )
+        {
+            for ( uint32_t blockX = blockMinX; blockX <= blockMaxX; ++blockX )
+            {
+                if ( minZ < hiZ.blockMaxZ[ blockY * hiZ.blocksCountX + blockX ] )
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    const uint32_t tileMinX = minX / s_TileSize, tileMaxX = maxX / s_TileSize;
+    const uint32_t tileMinY = minY / s_TileSize, tileMaxY = maxY / s_TileSize;
+    for ( uint32_t tileY = tileMinY; tileY <= tileMaxY; ++tileY )
+    {
+        for ( uint32_t tileX = tileMinX; tileX <= tileMaxX; ++tileX )
+        {
+            if ( minZ < hiZ.tileMaxZ[ tileY * hiZ.tilesCountX + tileX ] )
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Sets up SIMD_PIXEL_WIDTH triangles at a time, one per lane. The lanes of the triangles passing the culling are left-packed
+// so the output keeps the order of the input. The input vertices are structure of arrays, inputPitch is the bytes between the arrays
+// of the components of an attribute
+template <bool UseTexcoord, bool UseColor, bool UseNormal, bool UseViewPos>
+static uint32_t SetupTriangles( const SRenderState& state, const STriangleSetupInput& input,
+    const uint32_t* indices,
+    STriangleSetupOutput output,
+    uint32_t inputPitch, uint32_t outputStride, uint32_t trianglesCount )
+{
+    using namespace SIMDMath;
+
+    constexpr bool UseRcpw = UseTexcoord || UseColor || UseNormal || UseViewPos;
+    constexpr int32_t subpixelBits = 4;
+    static_assert( s_SubpixelStep == 1 << subpixelBits, "The sub-pixel step is applied with shifts" );
+
+    const VInt zero = Set1( 0 );
+    const VInt allOnes = Set1( -1 );
+    const VInt two = Set1( 2 );
+    const VInt signBit = Set1( int32_t( 0x80000000 ) );
+    const VInt rasterCoordStartX = Set1( state.rasterCoordStartX ), rasterCoordStartY = Set1( state.rasterCoordStartY );
+    const VInt rasterCoordEndX = Set1( state.rasterCoordEndX ), rasterCoordEndY = Set1( state.rasterCoordEndY );
+    const VInt pixelCenterRoundUp = Set1( s_SubpixelStep - 1 ), pixelCenterMask = Set1( ~( s_SubpixelStep - 1 ) );
+    const VInt viewportLeft = Set1( (int32_t)state.viewport.m_Left );
+    const VInt viewportBottom = Set1( int32_t( state.viewport.m_Top + state.viewport.m_Height - 1 ) ); // Image axis y is flipped
+    const VInt cullSign = Set1( state.cullMode == ECullMode::eCullCW ? 0 : int32_t( 0x80000000 ) );
+
+    const uint32_t* posX = (const uint32_t*)input.pos;
+    const uint32_t* posY = (const uint32_t*)( input.pos + inputPitch );
+    const uint32_t* posZ = (const uint32_t*)input.z;
+
+    uint32_t outputTrianglesCount = 0;
+    for ( uint32_t firstTriangle = 0; firstTriangle < trianglesCount; firstTriangle += SIMD_PIXEL_WIDTH )
+    {
+        // The lanes past the last triangle repeat it and are masked out
+        const uint32_t lanesCount = std::min( (uint32_t)SIMD_PIXEL_WIDTH, trianglesCount - firstTriangle );
+        alignas( SIMD_PIXEL_WIDTH * 4 ) int32_t laneIndices[ 3 ][ SIMD_PIXEL_WIDTH ];
+        for ( uint32_t lane = 0; lane < SIMD_PIXEL_WIDTH; ++lane )
+        {
+            const uint32_t* triangle = indices + ( firstTriangle + std::min( lane, lanesCount - 1 ) ) * 3;
+            laneIndices[ 0 ][ lane ] = triangle[ 0 ];
+            laneIndices[ 1 ][ lane ] = triangle[ 1 ];
+            laneIndices[ 2 ][ lane ] = triangle[ 2 ];
+        }
+        const VInt i0 = Load( laneIndices[ 0 ] ), i1 = Load( laneIndices[ 1 ] ), i2 = Load( laneIndices[ 2 ] );
+
+        const VInt x0 = Gather( posX, i0 ), y0 = Gather( posY, i0 );
+        const VInt x1 = Gather( posX, i1 ), y1 = Gather( posY, i1 );
+        const VInt x2 = Gather( posX, i2 ), y2 = Gather( posY, i2 );
+
+        VInt a01 = Sub( y0, y1 ), b01 = Sub( x1, x0 );
+        const VInt c01 = Sub( Mul( x0, y1 ), Mul( y0, x1 ) );
+        // Compute the signed area of the triangle for barycentric coordinates normalization
+        const VInt doubleSignedArea = Add( Add( Mul( a01, x2 ), Mul( b01, y2 ) ), c01 ); // Plug v2 into the edge function of edge01
+        const VInt faceSign = And( doubleSignedArea, signBit );
+        // If cull mode is none, each triangle compares with its own facing
+        const VInt laneCullSign = state.cullMode == ECullMode::eNone ? faceSign : cullSign;
+        VInt isCulled = CmpGt( zero, Xor( laneCullSign, doubleSignedArea ) );
+        // Degenerate triangles cover no pixel
+        isCulled = Or( isCulled, CmpEq( doubleSignedArea, zero ) );
+
+        // Calculate bounding box of the triangle and crop with the viewport
+        VInt minX = Max( rasterCoordStartX, Min( x0, Min( x1, x2 ) ) );
+        VInt minY = Max( rasterCoordStartY, Min( y0, Min( y1, y2 ) ) );
+        const VInt maxX = Min( rasterCoordEndX, Max( x0, Max( x1, x2 ) ) );
+        const VInt maxY = Min( rasterCoordEndY, Max( y0, Max( y1, y2 ) ) );
+        // Round up the minimum of the bounding box to the nearest pixel center, the distance to the start is never negative
+        minX = Add( And( Add( Sub( minX, rasterCoordStartX ), pixelCenterRoundUp ), pixelCenterMask ), rasterCoordStartX );
+        minY = Add( And( Add( Sub( minY, rasterCoordStartY ), pixelCenterRoundUp ), pixelCenterMask ), rasterCoordStartY );
+        // Cull if there is no pixel center inside the bounding box, it also means the triangle is outside of the viewport
+        isCulled = Or( isCulled, Or( CmpGt( minX, maxX ), CmpGt( minY, maxY ) ) );
+
+        uint32_t visibleMask = ( SIMD_PIXEL_FULL_MASK >> ( SIMD_PIXEL_WIDTH - lanesCount ) ) & ~MoveMask( isCulled );
+        if ( visibleMask == 0 )
+        {
+            continue;
+        }
+
+        // Compute the bounding box in image coordinate
+        const VInt imgMinX = Add( viewportLeft, ShiftRightLogical( Sub( minX, rasterCoordStartX ), subpixelBits ) );
+        const VInt imgMaxX = Add( imgMinX, ShiftRightLogical( Sub( maxX, minX ), subpixelBits ) );
+        const VInt imgMaxY = Sub( viewportBottom, ShiftRightLogical( Sub( minY, rasterCoordStartY ), subpixelBits ) );
+        const VInt imgMinY = Sub( imgMaxY, ShiftRightLogical( Sub( maxY, minY ), subpixelBits ) );
+
+        // The rasterizer coordinate y of the top most row in image
+        const VInt topY = Add( minY, ShiftLeft( Sub( imgMaxY, imgMinY ), subpixelBits ) );
+
+        VInt a12 = Sub( y1, y2 ), b12 = Sub( x2, x1 );
+        const VInt c12 = Sub( Mul( x1, y2 ), Mul( y1, x2 ) );
+        VInt a20 = Sub( y2, y0 ), b20 = Sub( x0, x2 );
+        const VInt c20 = Sub( Mul( x2, y0 ), Mul( y2, x0 ) );
+
+        VInt w0_row = Add( Add( Mul( a12, minX ), Mul( b12, topY ) ), c12 );
+        VInt w1_row = Add( Add( Mul( a20, minX ), Mul( b20, topY ) ), c20 );
+        VInt w2_row = Add( Add( Mul( a01, minX ), Mul( b01, topY ) ), c01 );
+
+        // Pre-multiply the edge function increments by sub-pixel steps
+        // Image axis y is flipped, stepping to the next row in image decreases the rasterizer coordinate y
+        a01 = ShiftLeft( a01, subpixelBits ); b01 = Sub( zero, ShiftLeft( b01, subpixelBits ) );
+        a12 = ShiftLeft( a12, subpixelBits ); b12 = Sub( zero, ShiftLeft( b12, subpixelBits ) );
+        a20 = ShiftLeft( a20, subpixelBits ); b20 = Sub( zero, ShiftLeft( b20, subpixelBits ) );
+
+        // Top left rule
+        // The following bias computing are facing agnostic, because if the triangle is CW
+        // 1) The IsTopLeftEdge test gives opposite result (IsBottomRightEdge) and...
+        // 2) top left edge bias should be -1, which yields positive (inside) when XOR'ed with the negative face sign and...
+        // 3) non-top left edge bias should be 0, which yields negative (outside) when XOR'ed with the negative face sign
+        // which is the same as if the triangle is CCW
+        const VInt topLeftBias0 = Xor( IsTopLeftEdge( x1, y1, x2, y2 ), allOnes );
+        const VInt topLeftBias1 = Xor( IsTopLeftEdge( x2, y2, x0, y0 ), allOnes );
+        const VInt topLeftBias2 = Xor( IsTopLeftEdge( x0, y0, x1, y1 ), allOnes );
+
+        // The bounding boxes of 2x2 pixels at most are tested pixel by pixel, the triangles covering none of them are culled
+        const uint32_t smallMask = visibleMask & MoveMask( And( CmpGt( two, Sub( imgMaxX, imgMinX ) ), CmpGt( two, Sub( imgMaxY, imgMinY ) ) ) );
+        if ( smallMask != 0 )
+        {
+            const VInt w0 = Add( w0_row, topLeftBias0 ), w1 = Add( w1_row, topLeftBias1 ), w2 = Add( w2_row, topLeftBias2 );
+            const VInt hasSecondColumn = CmpGt( imgMaxX, imgMinX ), hasSecondRow = CmpGt( imgMaxY, imgMinY );
+            VInt isCovered = zero;
+            for ( int32_t pixel = 0; pixel < 4; ++pixel )
+            {
+                const bool isSecondColumn = ( pixel & 1 ) != 0, isSecondRow = ( pixel & 2 ) != 0;
+                const VInt pw0 = Add( w0, Add( isSecondColumn ? a12 : zero, isSecondRow ? b12 : zero ) );
+                const VInt pw1 = Add( w1, Add( isSecondColumn ? a20 : zero, isSecondRow ? b20 : zero ) );
+                const VInt pw2 = Add( w2, Add( isSecondColumn ? a01 : zero, isSecondRow ? b01 : zero ) );
+                // "Inside" pixels yield positive
+                VInt isInside = CmpGt( Or( Or( Xor( faceSign, pw0 ), Xor( faceSign, pw1 ) ), Xor( faceSign, pw2 ) ), allOnes );
+                isInside = isSecondColumn ? And( isInside, hasSecondColumn ) : isInside;
+                isInside = isSecondRow ? And( isInside, hasSecondRow ) : isInside;
+                isCovered = Or( isCovered, isInside );
+            }
+            visibleMask &= ~( smallMask & ~MoveMask( isCovered ) );
+            if ( visibleMask == 0 )
+            {
+                continue;
+            }
+        }
+
+        const VFloat z0 = CastToFloat( Gather( posZ, i0 ) ), z1 = CastToFloat( Gather( posZ, i1 ) ), z2 = CastToFloat( Gather( posZ, i2 ) );
+        const VFloat minZ = Min( z0, Min( z1, z2 ) );
+        const VFloat maxZ = Max( z0, Max( z1, z2 ) );
+
+        alignas( SIMD_PIXEL_WIDTH * 4 ) int32_t laneImgMinX[ SIMD_PIXEL_WIDTH ], laneImgMaxX[ SIMD_PIXEL_WIDTH ], laneImgMinY[ SIMD_PIXEL_WIDTH ], laneImgMaxY[ SIMD_PIXEL_WIDTH ];
+        alignas( SIMD_PIXEL_WIDTH * 4 ) float laneMinZ[ SIMD_PIXEL_WIDTH ], laneMaxZ[ SIMD_PIXEL_WIDTH ];
+        Store( laneImgMinX, imgMinX ); Store( laneImgMaxX, imgMaxX );
+        Store( laneImgMinY, imgMinY ); Store( laneImgMaxY, imgMaxY );
+        Store( laneMinZ, minZ ); Store( laneMaxZ, maxZ );
+
+        // Cull the triangles behind what has been drawn in their bounding box
+        if ( state.hiZ != nullptr )
+        {
+            for ( uint32_t lane = 0; lane < SIMD_PIXEL_WIDTH; ++lane )
+            {
+                if ( ( visibleMask & ( 1 << lane ) ) && IsOccludedByHiZ( *state.hiZ, laneImgMinX[ lane ], laneImgMaxX[ lane ], laneImgMinY[ lane ], laneImgMaxY[ lane ], laneMinZ[ lane ] ) )
+                {
+                    visibleMask &= ~( 1 << lane );
+                }
+            }
+            if ( visibleMask == 0 )
+            {
+                continue;
+            }
+        }
+
+        // Left-pack the visible lanes
+        uint32_t visibleLanes[ SIMD_PIXEL_WIDTH ];
+        uint32_t visibleCount = 0;
+        for ( uint32_t lane = 0; lane < SIMD_PIXEL_WIDTH; ++lane )
+        {
+            visibleLanes[ visibleCount ] = lane;
+            visibleCount += ( visibleMask >> lane ) & 1;
+        }
+
+        const VFloat rcpDoubleSignedArea = Div( Set1( 1.0f ), ConvertToFloat( doubleSignedArea ) );
+
+        // Barycentric coordinates at minimum of the bounding box
+        const VFloat bw0_row = Mul( ConvertToFloat( w0_row ), rcpDoubleSignedArea );
+        const VFloat bw1_row = Mul( ConvertToFloat( w1_row ), rcpDoubleSignedArea );
+        const VFloat bw2_row = Mul( ConvertToFloat( w2_row ), rcpDoubleSignedArea );
+        // Horizontal barycentric coordinates increment 
+        const VFloat ba01 = Mul( ConvertToFloat( a01 ), rcpDoubleSignedArea );
+        const VFloat ba12 = Mul( ConvertToFloat( a12 ), rcpDoubleSignedArea );
+        const VFloat ba20 = Mul( ConvertToFloat( a20 ), rcpDoubleSignedArea );
+        // Vertical barycentric coordinates increment
+        const VFloat bb01 = Mul( ConvertToFloat( b01 ), rcpDoubleSignedArea );
+        const VFloat bb12 = Mul( ConvertToFloat( b12 ), rcpDoubleSignedArea );
+        const VFloat bb20 = Mul( ConvertToFloat( b20 ), rcpDoubleSignedArea );
+
+        // The barycentric coordinates are computed before the top left rule
+        w0_row = Add( w0_row, topLeftBias0 );
+        w1_row = Add( w1_row, topLeftBias1 );
+        w2_row = Add( w2_row, topLeftBias2 );
+
+        // Write all base attributes
+        alignas( SIMD_PIXEL_WIDTH * 4 ) int32_t laneEdges[ 9 ][ SIMD_PIXEL_WIDTH ];
+        alignas( SIMD_PIXEL_WIDTH * 4 ) int32_t laneFaceSign[ SIMD_PIXEL_WIDTH ];
+        Store( laneEdges[ 0 ], w0_row ); Store( laneEdges[ 1 ], w1_row ); Store( laneEdges[ 2 ], w2_row );
+        Store( laneEdges[ 3 ], a01 ); Store( laneEdges[ 4 ], a12 ); Store( laneEdges[ 5 ], a20 );
+        Store( laneEdges[ 6 ], b01 ); Store( laneEdges[ 7 ], b12 ); Store( laneEdges[ 8 ], b20 );
+        Store( laneFaceSign, faceSign );
+        for ( uint32_t i = 0; i < visibleCount; ++i )
+        {
+            const uint32_t lane = visibleLanes[ i ];
+            STriangleBaseAttributes* baseAttrs = (STriangleBaseAttributes*)( output.base + outputStride * i );
+            baseAttrs->minX = laneImgMinX[ lane ]; baseAttrs->maxX = laneImgMaxX[ lane ];
+            baseAttrs->minY = laneImgMinY[ lane ]; baseAttrs->maxY = laneImgMaxY[ lane ];
+            baseAttrs->w0_row = laneEdges[ 0 ][ lane ]; baseAttrs->w1_row = laneEdges[ 1 ][ lane ]; baseAttrs->w2_row = laneEdges[ 2 ][ lane ];
+            baseAttrs->a01 = laneEdges[ 3 ][ lane ]; baseAttrs->a12 = laneEdges[ 4 ][ lane ]; baseAttrs->a20 = laneEdges[ 5 ][ lane ];
+            baseAttrs->b01 = laneEdges[ 6 ][ lane ]; baseAttrs->b12 = laneEdges[ 7 ][ lane ]; baseAttrs->b20 = laneEdges[ 8 ][ lane ];
+            baseAttrs->minZ = laneMinZ[ lane ]; baseAttrs->maxZ = laneMaxZ[ lane ];
+            baseAttrs->faceSign = uint32_t( laneFaceSign[ lane ] ) >> 24; // 32bit to 8bit
+        }
+
+#define SETUP_ATTRIBUTE( name, offset, condition ) \
+        if ( condition ) \
+        { \
+            const uint32_t* srcAttr = (const uint32_t*)( input.name + inputPitch * offset ); \
+            const VFloat attr0 = CastToFloat( Gather( srcAttr, i0 ) ); \
+            const VFloat attr1 = CastToFloat( Gather( srcAttr, i1 ) ); \
+            const VFloat attr2 = CastToFloat( Gather( srcAttr, i2 ) ); \
+            alignas( SIMD_PIXEL_WIDTH * 4 ) float row[ SIMD_PIXEL_WIDTH ], a[ SIMD_PIXEL_WIDTH ], b[ SIMD_PIXEL_WIDTH ]; \
+            Store( row, BarycentricInterplation( attr0, attr1, attr2, bw0_row, bw1_row, bw2_row ) ); \
+            Store( a, BarycentricInterplation( attr0, attr1, attr2, ba12, ba20, ba01 ) ); \
+            Store( b, BarycentricInterplation( attr0, attr1, attr2, bb12, bb20, bb01 ) ); \
+            for ( uint32_t i = 0; i < visibleCount; ++i ) \
+            { \
+                const uint32_t lane = visibleLanes[ i ]; \
+                STriangleAttribute* dstAttr = (STriangleAttribute*)( output.name + outputStride * i ); \
+                dstAttr += offset; \
+                dstAttr->row = row[ lane ]; \
+                dstAttr->a = a[ lane ]; \
+                dstAttr->b = b[ lane ]; \
+            } \
+        }
+
+        SETUP_ATTRIBUTE( z, 0, true )
+    
+        SETUP_ATTRIBUTE( rcpw, 0, UseRcpw )
+
+        SETUP_ATTRIBUTE( texcoord, 0, UseTexcoord )
+        SETUP_ATTRIBUTE( texcoord, 1, UseTexcoord )
+
+        SETUP_ATTRIBUTE( color, 0, UseColor )
+        SETUP_ATTRIBUTE( color, 1, UseColor )
+        SETUP_ATTRIBUTE( color, 2, UseColor )
+
+        SETUP_ATTRIBUTE( normal, 0, UseNormal )
+        SETUP_ATTRIBUTE( normal, 1, UseNormal )
+        SETUP_ATTRIBUTE( normal, 2, UseNormal )
+
+        SETUP_ATTRIBUTE( viewPos, 0, UseViewPos )
+        SETUP_ATTRIBUTE( viewPos, 1, UseViewPos )
+        SETUP_ATTRIBUTE( viewPos, 2, UseViewPos )
+
+#undef SETUP_ATTRIBUTE
+
+        const uint32_t outputSize = outputStride * visibleCount;
+        output.base += outputSize;
+        output.z += outputSize;
+        if ( UseRcpw ) output.rcpw += outputSize;
+        if ( UseTexcoord ) output.texcoord += outputSize;
+        if ( UseColor ) output.color += outputSize;
+        if ( UseNormal ) output.normal += outputSize;
+        if ( UseViewPos ) output.viewPos += outputSize;
+        outputTrianglesCount += visibleCount;
+    }
+
+    return outputTrianglesCount;
+}
+
+// Pixel blocks straddling the right or bottom border of the tile only access the lanes inside of the tile,
+// the lanes outside of the tile may be out of the image
+static inline SIMDMath::VInt LoadPixelBlock( const uint32_t* topLeft, uint32_t pitch, uint32_t laneMask )
+{
+    if ( laneMask == SIMD_PIXEL_FULL_MASK )
+    {
+        return SIMDMath::LoadBlock( topLeft, pitch );
+    }
+
+    alignas( SIMD_PIXEL_WIDTH * 4 ) int32_t lanes[ SIMD_PIXEL_WIDTH ] = {};
+    for ( uint32_t i = 0; i < SIMD_PIXEL_WIDTH; ++i )
+    {
+        if ( laneMask & ( 1 << i ) )
+        {
+            lanes[ i ] = topLeft[ ( i / SIMD_PIXEL_BLOCK_WIDTH ) * pitch + i % SIMD_PIXEL_BLOCK_WIDTH ];
+        }
+    }
+    return SIMDMath::Load( lanes );
+}
+
+static inline void StorePixelBlock( uint32_t* topLeft, uint32_t pitch, uint32_t laneMask, SIMDMath::VInt value )
+{
+    if ( laneMask == SIMD_PIXEL_FULL_MASK )
+    {
+        SIMDMath::StoreBlock( topLeft, pitch, value );
+        return;
+    }
+
+    alignas( SIMD_PIXEL_WIDTH * 4 ) int32_t lanes[ SIMD_PIXEL_WIDTH ];
+    SIMDMath::Store( lanes, value );
+    for ( uint32_t i = 0; i < SIMD_PIXEL_WIDTH; ++i )
+    {
+        if ( laneMask & ( 1 << i ) )
+        {
+            topLeft[ ( i / SIMD_PIXEL_BLOCK_WIDTH ) * pitch + i % SIMD_PIXEL_BLOCK_WIDTH ] = lanes[ i ];
+        }
+    }
+}
+
+// Writes the depth of the lanes in the mask, the depth of the other lanes is read back from the depth target if it is not given
+static inline void StoreDepthBlock( uint32_t* topLeft, uint32_t pitch, uint32_t laneMask, SIMDMath::VInt mask, SIMDMath::VFloat z, const SIMDMath::VInt* depth )
+{
+    using namespace SIMDMath;
+    if ( depth != nullptr )
+    {
+        StorePixelBlock( topLeft, pitch, laneMask, Blend( *depth, CastToInt( z ), mask ) );
+    }
+    else if ( MoveMask( mask ) == SIMD_PIXEL_FULL_MASK )
+    {
+        StoreBlock( topLeft, pitch, CastToInt( z ) );
+    }
+    else
+    {
+        StorePixelBlock( topLeft, pitch, laneMask, Blend( LoadPixelBlock( topLeft, pitch, laneMask ), CastToInt( z ), mask ) );
+    }
+}
+
+// Recomputes the depth range of a Hi-Z block from the depth target
+static inline void UpdateHiZBlock( const SRenderState& state, uint32_t blockX, uint32_t blockY )
+{
+    const uint32_t minX = blockX * s_HiZBlockSize, minY = blockY * s_HiZBlockSize;
+    const uint32_t width = std::min( minX + s_HiZBlockSize, state.depthTarget.m_Width ) - minX;
+    const uint32_t height = std::min( minY + s_HiZBlockSize, state.depthTarget.m_Height ) - minY;
+    uint32_t depthPitch;
+    const float* depthBits = (const float*)GetTargetPixel( state.depthTarget, minX, minY, &depthPitch );
+
+    __m128 minZ = _mm_set1_ps( depthBits[ 0 ] );
+    __m128 maxZ = minZ;
+    for ( uint32_t y = 0; y < height; ++y )
+    {
+        const float* depthRow = depthBits + y * depthPitch;
+        uint32_t x = 0;
+        for ( ; x + 4 <= width; x += 4 )
+        {
+            const __m128 depth = _mm_loadu_ps( depthRow + x );
+            minZ = _mm_min_ps( minZ, depth );
+            maxZ = _mm_max_ps( maxZ, depth );
+        }
+        // Blocks cut by the image border
+        for ( ; x < width; ++x )
+        {
+            const __m128 depth = _mm_set1_ps( depthRow[ x ] );
+            minZ = _mm_min_ps( minZ, depth );
+            maxZ = _mm_max_ps( maxZ, depth );
+        }
+    }
+    minZ = _mm_min_ps( minZ, _mm_shuffle_ps( minZ, minZ, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    minZ = _mm_min_ps( minZ, _mm_movehl_ps( minZ, minZ ) );
+    maxZ = _mm_max_ps( maxZ, _mm_shuffle_ps( maxZ, maxZ, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    maxZ = _mm_max_ps( maxZ, _mm_movehl_ps( maxZ, maxZ ) );
+
+    const SHiZBuffer& hiZ = *state.hiZ;
+    const uint32_t blockIndex = blockY * hiZ.blocksCountX + blockX;
+    hiZ.blockMinZ[ blockIndex ] = _mm_cvtss_f32( minZ );
+    hiZ.blockMaxZ[ blockIndex ] = _mm_cvtss_f32( maxZ );
+}
+
+// Recomputes the depth range of the written Hi-Z blocks of a tile and then the tile itself,
+// bit ( y * s_HiZBlocksPerTile + x ) of the mask stands for the block ( x, y ) of the tile
+static void UpdateHiZTile( const SRenderState& state, const SRasterTile& tile, uint64_t writtenBlocks )
+{
+    const SHiZBuffer& hiZ = *state.hiZ;
+    const uint32_t minBlockX = tile.minX / s_HiZBlockSize, minBlockY = tile.minY / s_HiZBlockSize;
+    const uint32_t maxBlockX = tile.maxX / s_HiZBlockSize, maxBlockY = tile.maxY / s_HiZBlockSize;
+    float minZ = hiZ.blockMinZ[ minBlockY * hiZ.blocksCountX + minBlockX ];
+    float maxZ = hiZ.blockMaxZ[ minBlockY * hiZ.blocksCountX + minBlockX ];
+    for ( uint32_t blockY = minBlockY; blockY <= maxBlockY; ++blockY )
+    {
+        for ( uint32_t blockX = minBlockX; blockX <= maxBlockX; ++blockX )
+        {
+            if ( writtenBlocks & ( 1ull << ( ( blockY - minBlockY ) * s_HiZBlocksPerTile + blockX - minBlockX ) ) )
+            {
+                UpdateHiZBlock( state, blockX, blockY );
+            }
+            minZ = std::min( minZ, hiZ.blockMinZ[ blockY * hiZ.blocksCountX + blockX ] );
+            maxZ = std::max( maxZ, hiZ.blockMaxZ[ blockY * hiZ.blocksCountX + blockX ] );
+        }
+    }
+
+    const uint32_t tileIndex = ( tile.minY / s_TileSize ) * hiZ.tilesCountX + tile.minX / s_TileSize;
+    hiZ.tileMinZ[ tileIndex ] = minZ;
+    hiZ.tileMaxZ[ tileIndex ] = maxZ;
+}
+
+// Size of the blocks the 8x8 blocks partially covered by a triangle are split into, they hold whole SIMD pixel blocks
+static const int32_t s_SubBlockSize = 4;
+static_assert( s_HiZBlockSize % s_SubBlockSize == 0 && s_SubBlockSize % SIMD_PIXEL_BLOCK_WIDTH == 0 && s_SubBlockSize % SIMD_PIXEL_BLOCK_HEIGHT == 0,
+    "The pixel blocks must nest into each other" );
+
+// Edge function whose value is positive inside the triangle
+struct SEdgeFunction
+{
+    int32_t w; // Value at the top left pixel of the bounding box
+    int32_t a, b; // Increments per pixel along x and y
+};
+
+static inline SEdgeFunction MakeEdgeFunction( int32_t w, int32_t a, int32_t b, uint8_t faceSign )
+{
+    // Back faces are inside where the edge functions are negative, -w - 1 is positive exactly when w is negative
+    return faceSign != 0 ? SEdgeFunction{ -w - 1, -a, -b } : SEdgeFunction{ w, a, b };
+}
+
+enum class EBlockCoverage
+{
+    eOutside,
+    ePartial,
+    eInside
+};
+
+// Tests the pixels of the Size x Size block at ( dx, dy ) from the top left pixel of the bounding box against the edges,
+// the edge functions are linear so their extremes over the block are at its corners
+template <int32_t Size>
+static inline EBlockCoverage ClassifyBlock( const SEdgeFunction* edges, int32_t dx, int32_t dy )
+{
+    bool isInside = true;
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        const SEdgeFunction& edge = edges[ i ];
+        const int32_t w = edge.w + edge.a * dx + edge.b * dy;
+        const int32_t minW = w + ( std::min( edge.a, 0 ) + std::min( edge.b, 0 ) ) * ( Size - 1 );
+        const int32_t maxW = w + ( std::max( edge.a, 0 ) + std::max( edge.b, 0 ) ) * ( Size - 1 );
+        if ( maxW < 0 )
+        {
+            return EBlockCoverage::eOutside;
+        }
+        isInside = isInside && minW >= 0;
+    }
+    return isInside ? EBlockCoverage::eInside : EBlockCoverage::ePartial;
+}
+
+// Attributes of the pixels of a block, all but z are divided by w
+struct SPixelAttributes
+{
+    SIMDMath::VFloat z, rcpw;
+    SIMDMath::VFloat texU_w, texV_w;
+    SIMDMath::VFloat colorR_w, colorG_w, colorB_w;
+    SIMDMath::VFloat normalX_w, normalY_w, normalZ_w;
+    SIMDMath::VFloat viewPosX_w, viewPosY_w, viewPosZ_w;
+    // Increments of texU_w, texV_w and rcpw per pixel along x and y, the same for every pixel of the triangle
+    SIMDMath::VFloat texU_w_dx, texU_w_dy, texV_w_dx, texV_w_dy, rcpw_dx, rcpw_dy;
+};
+
+static inline void SetTexcoordGradients( const STriangleSetupOutput& input, uint32_t triangleOffset, SPixelAttributes* attributes )
+{
+    using namespace SIMDMath;
+    const STriangleAttribute* texcoordAttrs = (const STriangleAttribute*)( input.texcoord + triangleOffset );
+    const STriangleAttribute* rcpwAttr = (const STriangleAttribute*)( input.rcpw + triangleOffset );
+    attributes->texU_w_dx = Set1( texcoordAttrs[ 0 ].a );
+    attributes->texU_w_dy = Set1( texcoordAttrs[ 0 ].b );
+    attributes->texV_w_dx = Set1( texcoordAttrs[ 1 ].a );
+    attributes->texV_w_dy = Set1( texcoordAttrs[ 1 ].b );
+    attributes->rcpw_dx = Set1( rcpwAttr->a );
+    attributes->rcpw_dy = Set1( rcpwAttr->b );
+}
+
+// Level of detail of the texture samples, log2 of the longest derivative of the texcoords in texels along x or y.
+// The derivatives come from the planes of the attributes divided by w, which gives every pixel its exact level of detail
+static inline SIMDMath::VFloat __vectorcall ComputeTextureLod( const SRenderState& state, const SPixelAttributes& attributes,
+    SIMDMath::VFloat texU, SIMDMath::VFloat texV, SIMDMath::VFloat w )
+{
+    using namespace SIMDMath;
+    // d( texU_w * w ) = ( d( texU_w ) - texU * d( rcpw ) ) * w
+    const VFloat width = Set1( (float)state.textureMipLevels.widths[ 0 ] );
+    const VFloat height = Set1( (float)state.textureMipLevels.heights[ 0 ] );
+    const VFloat texUdx = Mul( Mul( Sub( attributes.texU_w_dx, Mul( texU, attributes.rcpw_dx ) ), w ), width );
+    const VFloat texUdy = Mul( Mul( Sub( attributes.texU_w_dy, Mul( texU, attributes.rcpw_dy ) ), w ), width );
+    const VFloat texVdx = Mul( Mul( Sub( attributes.texV_w_dx, Mul( texV, attributes.rcpw_dx ) ), w ), height );
+    const VFloat texVdy = Mul( Mul( Sub( attributes.texV_w_dy, Mul( texV, attributes.rcpw_dy ) ), w ), height );
+    const VFloat lengthSqrX = Add( Mul( texUdx, texUdx ), Mul( texVdx, texVdx ) );
+    const VFloat lengthSqrY = Add( Mul( texUdy, texUdy ), Mul( texVdy, texVdy ) );
+    // Half of log2 of the squared length, magnified samples get the first level
+    return Mul( Log2( Max( Max( lengthSqrX, lengthSqrY ), Set1( 1.f ) ) ), Set1( 0.5f ) );
+}
+
+// Samples the levels of detail of the lanes from the texture stored in Layout, or block compressed when IsCompressed is set
+template <ETextureFilter TextureFilter, ETextureLayout Layout, bool IsCompressed>
+static inline void __vectorcall SampleTextureLevels( const SRenderState& state, STextureBlockCache* textureBlockCache, SIMDMath::VFloat lod, SIMDMath::VFloat texU,
+    SIMDMath::VFloat texV, SIMDMath::VFloat* r, SIMDMath::VFloat* g, SIMDMath::VFloat* b, SIMDMath::VFloat* a )
+{
+    using namespace SIMDMath;
+
+    const STextureMipLevels& mipLevels = state.textureMipLevels;
+    if ( TextureFilter == ETextureFilter::eTrilinear )
+    {
+        // The level of detail is positive so the conversion rounds it down, the two levels are blended before unpacking
+        const VInt level0 = ConvertToInt( lod );
+        const VInt level1 = Min( Add( level0, Set1( 1 ) ), Set1( int32_t( std::max( mipLevels.count, 1u ) ) - 1 ) );
+        const VInt weight = ConvertToInt( Mul( Sub( lod, ConvertToFloat( level0 ) ), Set1( 256.f ) ) );
+        const VInt texels0 = SampleTexels_LinearClamp<Layout, IsCompressed>( state.texture, mipLevels, textureBlockCache, level0, texU, texV );
+        const VInt texels1 = SampleTexels_LinearClamp<Layout, IsCompressed>( state.texture, mipLevels, textureBlockCache, level1, texU, texV );
+        R8G8B8A8Unorm_To_Float( LerpTexels( texels0, texels1, weight ), r, g, b, a );
+        return;
+    }
+
+    const VInt level = ConvertToInt( Add( lod, Set1( 0.5f ) ) );
+    if ( TextureFilter == ETextureFilter::eBilinear )
+    {
+        SampleTexture_LinearClamp<Layout, IsCompressed>( state.texture, mipLevels, textureBlockCache, level, texU, texV, r, g, b, a );
+    }
+    else
+    {
+        SampleTexture_PointClamp<Layout, IsCompressed>( state.texture, mipLevels, textureBlockCache, level, texU, texV, r, g, b, a );
+    }
+}
+
+template <ETextureFilter TextureFilter>
+static inline void __vectorcall SampleTexture( const SRenderState& state, STextureBlockCache* textureBlockCache, const SPixelAttributes& attributes, SIMDMath::VFloat texU,
+    SIMDMath::VFloat texV, SIMDMath::VFloat w, SIMDMath::VFloat* r, SIMDMath::VFloat* g, SIMDMath::VFloat* b, SIMDMath::VFloat* a )
+{
+    using namespace SIMDMath;
+
+    const STextureMipLevels& mipLevels = state.textureMipLevels;
+    const ETextureLayout layout = state.texture.m_Layout;
+    const bool isCompressed = IsBlockCompressed( state.texture.m_Format );
+    if ( TextureFilter == ETextureFilter::ePoint && mipLevels.count <= 1 && layout == ETextureLayout::eLinear && !isCompressed )
+    {
+        SampleTexture_PointClamp( state.texture, texU, texV, r, g, b, a );
+        return;
+    }
+
+    const int32_t maxLevel = int32_t( std::max( mipLevels.count, 1u ) ) - 1;
+    VFloat lod = Set1( 0.f );
+    if ( maxLevel > 0 )
+    {
+        lod = Min( ComputeTextureLod( state, attributes, texU, texV, w ), Set1( (float)maxLevel ) );
+    }
+
+    // The layout of the block compressed textures is ignored
+    if ( isCompressed )
+    {
+        SampleTextureLevels<TextureFilter, ETextureLayout::eLinear, true>( state, textureBlockCache, lod, texU, texV, r, g, b, a );
+    }
+    else if ( layout == ETextureLayout::eSwizzled )
+    {
+        SampleTextureLevels<TextureFilter, ETextureLayout::eSwizzled, false>( state, textureBlockCache, lod, texU, texV, r, g, b, a );
+    }
+    else
+    {
+        SampleTextureLevels<TextureFilter, ETextureLayout::eLinear, false>( state, textureBlockCache, lod, texU, texV, r, g, b, a );
+    }
+}
+
+// Shades the pixels of the mask in the block whose top left pixel is ( imgX, imgY ), the lanes out of laneMask are never accessed.
+// The depth test is skipped unless testDepth is set, returns whether the depth of any pixel is written
+template <bool UseTexture, bool UseVertexColor, ELightingModel LightingModel, ELightType LightType, bool EnableAlphaTest, bool EnableAlphaBlend, ETextureFilter TextureFilter>
+static inline bool ShadeBlock( const SRenderState& state, STextureBlockCache* textureBlockCache, int32_t imgX, int32_t imgY, uint32_t laneMask, SIMDMath::VInt mask,
+    bool testDepth, const SPixelAttributes& attributes, [[maybe_unused]] SRasterStats* tileStats )
+{
+    using namespace SIMDMath;
+
+    constexpr bool NeedLighting = LightingModel != ELightingModel::eUnlit;
+    constexpr bool NeedViewPos = NeedLighting && ( LightingModel == ELightingModel::eBlinnPhong || LightType == ELightType::ePoint );
+    constexpr bool NeedRcpw = UseTexture || UseVertexColor || NeedLighting;
+
+    const VFloat zero = Set1( 0.f );
+    const VFloat one = Set1( 1.f );
+    const bool enableDepthWrite = state.enableDepthWrite;
+
+    RASTERIZER_STATS( tileStats->pixelsTested += CountBits( MoveMask( mask ) ); )
+
+    // The depth test is skipped if the Hi-Z tells the block passes it anyway
+    uint32_t depthPitch;
+    uint32_t* dstDepth = GetTargetPixel( state.depthTarget, imgX, imgY, &depthPitch );
+    VInt depth = Set1( 0 );
+    bool isDepthWritten = false;
+    if ( testDepth )
+    {
+        depth = LoadPixelBlock( dstDepth, depthPitch, laneMask );
+        mask = And( mask, CmpLt( attributes.z, CastToFloat( depth ) ) );
+        if ( MoveMask( mask ) == 0 )
+        {
+            return isDepthWritten;
+        }
+    }
+    RASTERIZER_STATS( tileStats->pixelsDepthPassed += CountBits( MoveMask( mask ) ); )
+
+    if ( !EnableAlphaTest && enableDepthWrite )
+    {
+        StoreDepthBlock( dstDepth, depthPitch, laneMask, mask, attributes.z, testDepth ? &depth : nullptr );
+        isDepthWritten = true;
+    }
+
+    VFloat w;
+    if ( NeedRcpw )
+    {
+        w = Div( one, attributes.rcpw );
+    }
+
+    VFloat r = one, g = one, b = one, a = one;
+    if ( UseTexture )
+    {
+        const VFloat texU = Mul( attributes.texU_w, w );
+        const VFloat texV = Mul( attributes.texV_w, w );
+        SampleTexture<TextureFilter>( state, textureBlockCache, attributes, texU, texV, w, &r, &g, &b, &a );
+    }
+
+    if ( UseVertexColor )
+    {
+        const VFloat vertexColorR = Mul( attributes.colorR_w, w );
+        const VFloat vertexColorG = Mul( attributes.colorG_w, w );
+        const VFloat vertexColorB = Mul( attributes.colorB_w, w );
+        r = Mul( r, vertexColorR );
+        g = Mul( g, vertexColorG );
+        b = Mul( b, vertexColorB );
+    }
+
+    r = Mul( r, Set1( state.material.m_Diffuse.m_X ) );
+    g = Mul( g, Set1( state.material.m_Diffuse.m_Y ) );
+    b = Mul( b, Set1( state.material.m_Diffuse.m_Z ) );
+    a = Mul( a, Set1( state.material.m_Diffuse.m_W ) );
+
+    if ( EnableAlphaTest )
+    {
+        const VInt a8 = ConvertToInt( Add( Mul( a, Set1( 255.f ) ), Set1( 0.5f ) ) );
+        const VInt alphaMask = CmpGt( a8, Set1( int32_t( state.alphaRef ) - 1 ) );
+        RASTERIZER_STATS( tileStats->pixelsAlphaKilled += CountBits( MoveMask( mask ) & ~MoveMask( alphaMask ) ); )
+        mask = And( mask, alphaMask );
+        if ( MoveMask( mask ) == 0 )
+        {
+            return isDepthWritten;
+        }
+
+        if ( enableDepthWrite )
+        {
+            StoreDepthBlock( dstDepth, depthPitch, laneMask, mask, attributes.z, testDepth ? &depth : nullptr );
+            isDepthWritten = true;
+        }
+    }
+
+    if ( NeedLighting )
+    {
+        VFloat normalX = Mul( attributes.normalX_w, w );
+        VFloat normalY = Mul( attributes.normalY_w, w );
+        VFloat normalZ = Mul( attributes.normalZ_w, w );
+        // Re-normalize the normal
+        VFloat length = Add( Add( Mul( normalX, normalX ), Mul( normalY, normalY ) ), Mul( normalZ, normalZ ) );
+        VFloat rcpDenorm = Div( one, Sqrt( length ) );
+        normalX = Mul( normalX, rcpDenorm );
+        normalY = Mul( normalY, rcpDenorm );
+        normalZ = Mul( normalZ, rcpDenorm );
+
+        VFloat viewPosX, viewPosY, viewPosZ;
+        if ( NeedViewPos )
+        {
+            viewPosX = Mul( attributes.viewPosX_w, w );
+            viewPosY = Mul( attributes.viewPosY_w, w );
+            viewPosZ = Mul( attributes.viewPosZ_w, w );
+        }
+
+        VFloat lightVecX, lightVecY, lightVecZ, lightDistanceSqr;
+        if ( LightType == ELightType::eDirectional )
+        {
+            lightVecX = Set1( state.light.m_Position.m_X );
+            lightVecY = Set1( state.light.m_Position.m_Y );
+            lightVecZ = Set1( state.light.m_Position.m_Z );
+        }
+        else if ( LightType == ELightType::ePoint )
+        {
+            lightVecX = Sub( Set1( state.light.m_Position.m_X ), viewPosX );
+            lightVecY = Sub( Set1( state.light.m_Position.m_Y ), viewPosY );
+            lightVecZ = Sub( Set1( state.light.m_Position.m_Z ), viewPosZ );
+            lightDistanceSqr = Add( Add( Mul( lightVecX, lightVecX ), Mul( lightVecY, lightVecY ) ), Mul( lightVecZ, lightVecZ ) );
+            // Normalize the light vector
+            rcpDenorm = Div( one, Sqrt( lightDistanceSqr ) );
+            lightVecX = Mul( lightVecX, rcpDenorm );
+            lightVecY = Mul( lightVecY, rcpDenorm );
+            lightVecZ = Mul( lightVecZ, rcpDenorm );
+        }
+
+        VFloat NdotL = Add( Add( Mul( normalX, lightVecX ), Mul( normalY, lightVecY ) ), Mul( normalZ, lightVecZ ) );
+        NdotL = Max( zero, NdotL );
+
+        const VFloat lambertR = Mul( Mul( r, Set1( state.light.m_Diffuse.m_X ) ), NdotL );
+        const VFloat lambertG = Mul( Mul( g, Set1( state.light.m_Diffuse.m_Y ) ), NdotL );
+        const VFloat lambertB = Mul( Mul( b, Set1( state.light.m_Diffuse.m_Z ) ), NdotL );
+
+        VFloat specularR = zero, specularG = zero, specularB = zero;
+        if ( LightingModel == ELightingModel::eBlinnPhong )
+        {
+            VFloat viewVecX = Sub( zero, viewPosX );
+            VFloat viewVecY = Sub( zero, viewPosY );
+            VFloat viewVecZ = Sub( zero, viewPosZ );
+            // Re-normalize the view vector
+            length = Add( Add( Mul( viewVecX, viewVecX ), Mul( viewVecY, viewVecY ) ), Mul( viewVecZ, viewVecZ ) );
+            rcpDenorm = Div( one, Sqrt( length ) );
+            viewVecX = Mul( viewVecX, rcpDenorm );
+            viewVecY = Mul( viewVecY, rcpDenorm );
+            viewVecZ = Mul( viewVecZ, rcpDenorm );
+
+            VFloat halfVecX = Add( lightVecX, viewVecX );
+            VFloat halfVecY = Add( lightVecY, viewVecY );
+            VFloat halfVecZ = Add( lightVecZ, viewVecZ );
+            // Re-normalize the half vector
+            length = Add( Add( Mul( halfVecX, halfVecX ), Mul( halfVecY, halfVecY ) ), Mul( halfVecZ, halfVecZ ) );
+            rcpDenorm = Div( one, Sqrt( length ) );
+            halfVecX = Mul( halfVecX, rcpDenorm );
+            halfVecY = Mul( halfVecY, rcpDenorm );
+            halfVecZ = Mul( halfVecZ, rcpDenorm );
+
+            VFloat NdotH = Add( Add( Mul( normalX, halfVecX ), Mul( normalY, halfVecY ) ), Mul( normalZ, halfVecZ ) );
+            NdotH = Max( zero, NdotH );
+
+            const VFloat blinnPhong = Blend( zero, Pow( NdotH, state.material.m_Power ), CmpGt( NdotL, zero ) );
+            specularR = Mul( Set1( state.material.m_Specular.m_X * state.light.m_Specular.m_X ), blinnPhong );
+            specularG = Mul( Set1( state.material.m_Specular.m_Y * state.light.m_Specular.m_Y ), blinnPhong );
+            specularB = Mul( Set1( state.material.m_Specular.m_Z * state.light.m_Specular.m_Z ), blinnPhong );
+        }
+
+        r = Add( lambertR, specularR );
+        g = Add( lambertG, specularG );
+        b = Add( lambertB, specularB );
+
+        if ( LightType == ELightType::ePoint )
+        {
+            const VFloat rcpDistanceSqr = Div( one, lightDistanceSqr );
+            r = Mul( r, rcpDistanceSqr );
+            g = Mul( g, rcpDistanceSqr );
+            b = Mul( b, rcpDistanceSqr );
+        }
+
+        r = Add( r, Set1( state.light.m_Ambient.m_X ) );
+        g = Add( g, Set1( state.light.m_Ambient.m_Y ) );
+        b = Add( b, Set1( state.light.m_Ambient.m_Z ) );
+    }
+
+    uint32_t colorPitch;
+    uint32_t* dstColor = GetTargetPixel( state.renderTarget, imgX, imgY, &colorPitch );
+    const VInt color = LoadPixelBlock( dstColor, colorPitch, laneMask );
+
+    if ( EnableAlphaBlend )
+    {
+        VFloat dstR, dstG, dstB, dstA;
+        R8G8B8A8Unorm_To_Float( color, &dstR, &dstG, &dstB, &dstA );
+
+        r = Add( Mul( Sub( r, dstR ), a ), dstR );
+        g = Add( Mul( Sub( g, dstG ), a ), dstG );
+        b = Add( Mul( Sub( b, dstB ), a ), dstB );
+    }
+
+    r = Min( r, one );
+    g = Min( g, one );
+    b = Min( b, one );
+
+    const VFloat unormScale = Set1( 255.f ), unormRounding = Set1( 0.5f );
+    const VInt r8 = ConvertToInt( Add( Mul( r, unormScale ), unormRounding ) );
+    const VInt g8 = ConvertToInt( Add( Mul( g, unormScale ), unormRounding ) );
+    const VInt b8 = ConvertToInt( Add( Mul( b, unormScale ), unormRounding ) );
+    const VInt rgba = Or( Or( Set1( int32_t( 0xFF000000 ) ), ShiftLeft( r8, 16 ) ), Or( ShiftLeft( g8, 8 ), b8 ) );
+    StorePixelBlock( dstColor, colorPitch, laneMask, Blend( color, rgba, mask ) );
+    RASTERIZER_STATS( tileStats->pixelsWritten += CountBits( MoveMask( mask ) ); )
+
+    return isDepthWritten;
+}
+
+// Rasterizes a triangle whose bounding box spans at most 2x2 pixels, the edge functions and the attributes are evaluated at the pixels
+// of the few blocks it overlaps instead of being stepped. Returns the Hi-Z blocks of the tile whose depth is written
+template <bool UseTexture, bool UseVertexColor, ELightingModel LightingModel, ELightType LightType, bool EnableAlphaTest, bool EnableAlphaBlend, ETextureFilter TextureFilter>
+static uint64_t RasterizeSmallTriangle( const SRenderState& state, STextureBlockCache* textureBlockCache, const STriangleSetupOutput& input, uint32_t triangleOffset,
+    const SRasterTile& tile, SRasterStats* tileStats )
+{
+    using namespace SIMDMath;
+
+    constexpr bool NeedLighting = LightingModel != ELightingModel::eUnlit;
+    constexpr bool NeedViewPos = NeedLighting && ( LightingModel == ELightingModel::eBlinnPhong || LightType == ELightType::ePoint );
+    constexpr bool NeedRcpw = UseTexture || UseVertexColor || NeedLighting;
+
+    const VInt laneOffsetX = LaneOffsetX();
+    const VInt laneOffsetY = LaneOffsetY();
+    const VFloat laneOffsetXf = ConvertToFloat( laneOffsetX );
+    const VFloat laneOffsetYf = ConvertToFloat( laneOffsetY );
+
+    const STriangleBaseAttributes* base = (const STriangleBaseAttributes*)( input.base + triangleOffset );
+    const int32_t minX = std::max( base->minX, tile.minX ), maxX = std::min( base->maxX, tile.maxX );
+    const int32_t minY = std::max( base->minY, tile.minY ), maxY = std::min( base->maxY, tile.maxY );
+    const int32_t blockMinX = tile.minX + ( ( minX - tile.minX ) & ~( SIMD_PIXEL_BLOCK_WIDTH - 1 ) );
+    const int32_t blockMinY = tile.minY + ( ( minY - tile.minY ) & ~( SIMD_PIXEL_BLOCK_HEIGHT - 1 ) );
+
+    const VInt faceSign = Set1( int32_t( base->faceSign << 24 ) ); // 8bit to 32bit
+
+    const uint32_t tileBlockX = tile.minX / s_HiZBlockSize, tileBlockY = tile.minY / s_HiZBlockSize;
+    uint64_t hiZWrittenBlocks = 0;
+
+    SPixelAttributes attributes;
+    if ( UseTexture )
+    {
+        SetTexcoordGradients( input, triangleOffset, &attributes );
+    }
+
+    for ( int32_t imgY = blockMinY; imgY <= maxY; imgY += SIMD_PIXEL_BLOCK_HEIGHT )
+    {
+        for ( int32_t imgX = blockMinX; imgX <= maxX; imgX += SIMD_PIXEL_BLOCK_WIDTH )
+        {
+            const VInt tileMask = And( CmpGt( Set1( tile.maxY - imgY + 1 ), laneOffsetY ), CmpGt( Set1( tile.maxX - imgX + 1 ), laneOffsetX ) );
+
+            // Offsets of the block from the top left pixel of the bounding box
+            const int32_t offsetX = imgX - base->minX, offsetY = imgY - base->minY;
+            const VInt w0 = Add( Set1( base->w0_row + base->a12 * offsetX + base->b12 * offsetY ), Add( Mul( Set1( base->a12 ), laneOffsetX ), Mul( Set1( base->b12 ), laneOffsetY ) ) );
+            const VInt w1 = Add( Set1( base->w1_row + base->a20 * offsetX + base->b20 * offsetY ), Add( Mul( Set1( base->a20 ), laneOffsetX ), Mul( Set1( base->b20 ), laneOffsetY ) ) );
+            const VInt w2 = Add( Set1( base->w2_row + base->a01 * offsetX + base->b01 * offsetY ), Add( Mul( Set1( base->a01 ), laneOffsetX ), Mul( Set1( base->b01 ), laneOffsetY ) ) );
+
+            // "Inside" fragments yields positive
+            const VInt edgeSigns = Or( Or( Xor( faceSign, w0 ), Xor( faceSign, w1 ) ), Xor( faceSign, w2 ) );
+            const VInt mask = And( tileMask, CmpGt( edgeSigns, Set1( -1 ) ) );
+            if ( MoveMask( mask ) == 0 )
+            {
+                continue;
+            }
+
+#define EVALUATE_ATTRIBUTE( dstName, srcName, offset, condition ) \
+            if ( condition ) \
+            { \
+                const STriangleAttribute* attr = (const STriangleAttribute*)( input.srcName + triangleOffset ); \
+                attr += offset; \
+                attributes.dstName = Add( Set1( attr->row + attr->a * offsetX + attr->b * offsetY ), Add( Mul( Set1( attr->a ), laneOffsetXf ), Mul( Set1( attr->b ), laneOffsetYf ) ) ); \
+            }
+
+            EVALUATE_ATTRIBUTE( z, z, 0, true )
+
+            EVALUATE_ATTRIBUTE( rcpw, rcpw, 0, NeedRcpw )
+
+            EVALUATE_ATTRIBUTE( texU_w, texcoord, 0, UseTexture )
+            EVALUATE_ATTRIBUTE( texV_w, texcoord, 1, UseTexture )
+
+            EVALUATE_ATTRIBUTE( colorR_w, color, 0, UseVertexColor )
+            EVALUATE_ATTRIBUTE( colorG_w, color, 1, UseVertexColor )
+            EVALUATE_ATTRIBUTE( colorB_w, color, 2, UseVertexColor )
+
+            EVALUATE_ATTRIBUTE( normalX_w, normal, 0, NeedLighting )
+            EVALUATE_ATTRIBUTE( normalY_w, normal, 1, NeedLighting )
+            EVALUATE_ATTRIBUTE( normalZ_w, normal, 2, NeedLighting )
+
+            EVALUATE_ATTRIBUTE( viewPosX_w, viewPos, 0, NeedViewPos )
+            EVALUATE_ATTRIBUTE( viewPosY_w, viewPos, 1, NeedViewPos )
+            EVALUATE_ATTRIBUTE( viewPosZ_w, viewPos, 2, NeedViewPos )
+
+#undef EVALUATE_ATTRIBUTE
+
+            // The triangle already passed the Hi-Z at setup, the few pixels are always depth tested
+            if ( ShadeBlock<UseTexture, UseVertexColor, LightingModel, LightType, EnableAlphaTest, EnableAlphaBlend, TextureFilter>( state, textureBlockCache, imgX, imgY, MoveMask( tileMask ), mask,
+                true, attributes, tileStats ) && state.hiZ != nullptr )
+            {
+                hiZWrittenBlocks |= uint64_t( 1 ) << ( ( imgY / s_HiZBlockSize - tileBlockY ) * s_HiZBlocksPerTile + imgX / s_HiZBlockSize - tileBlockX );
+            }
+        }
+    }
+
+    return hiZWrittenBlocks;
+}
+
+template <bool UseTexture, bool UseVertexColor, ELightingModel LightingModel, ELightType LightType, bool EnableAlphaTest, bool EnableAlphaBlend, ETextureFilter TextureFilter>
+static void RasterizeTriangles( const SRenderState& state, const STriangleSetupOutput& input, uint32_t inputStride, const uint32_t* triangleIndices, uint32_t trianglesCount, const SRasterTile& tile,
+    [[maybe_unused]] SRasterStats* stats )
+{
+    using namespace SIMDMath;
+
+    constexpr bool NeedLighting = LightingModel != ELightingModel::eUnlit;
+    constexpr bool NeedViewPos = NeedLighting && ( LightingModel == ELightingModel::eBlinnPhong || LightType == ELightType::ePoint );
+    constexpr bool NeedRcpw = UseTexture || UseVertexColor || NeedLighting;
+
+    // Every lane of the vectors shades one pixel of a block
+    const VInt laneOffsetX = LaneOffsetX();
+    const VInt laneOffsetY = LaneOffsetY();
+    const VFloat laneOffsetXf = ConvertToFloat( laneOffsetX );
+    const VFloat laneOffsetYf = ConvertToFloat( laneOffsetY );
+    const VFloat blockWidth = Set1( (float)SIMD_PIXEL_BLOCK_WIDTH );
+    const VFloat blockHeight = Set1( (float)SIMD_PIXEL_BLOCK_HEIGHT );
+
+    // The Hi-Z is aligned to the tiles when it is enabled. It is brought up to date once all triangles are rasterized,
+    // until then the written blocks only keep their maximum depth which is still conservative
+    const SHiZBuffer* hiZ = state.hiZ;
+    const uint32_t tileBlockX = tile.minX / s_HiZBlockSize, tileBlockY = tile.minY / s_HiZBlockSize;
+    uint64_t hiZWrittenBlocks = 0;
+
+    SRasterStats tileStats = {};
+
+    // Only the block compressed textures are decoded through the cache, it starts empty for every tile
+    STextureBlockCache textureBlockCache;
+    if ( UseTexture && IsBlockCompressed( state.texture.m_Format ) )
+    {
+        std::fill( std::begin( textureBlockCache.blocks ), std::end( textureBlockCache.blocks ), nullptr );
+    }
+
+    for ( uint32_t i = 0; i < trianglesCount; ++i )
+    {
+        const uint32_t triangleOffset = triangleIndices[ i ] * inputStride;
+        const STriangleBaseAttributes* base = (const STriangleBaseAttributes*)( input.base + triangleOffset );
+
+        if ( base->maxX - base->minX < 2 && base->maxY - base->minY < 2 )
+        {
+            hiZWrittenBlocks |= RasterizeSmallTriangle<UseTexture, UseVertexColor, LightingModel, LightType, EnableAlphaTest, EnableAlphaBlend, TextureFilter>( state, &textureBlockCache, input, triangleOffset, tile,
+                &tileStats );
+            continue;
+        }
+
+        // Crop the bounding box of the triangle with the tile, tiles never overlap so no other thread touches the same pixels
+        const int32_t minX = std::max( base->minX, tile.minX ), maxX = std::min( base->maxX, tile.maxX );
+        const int32_t minY = std::max( base->minY, tile.minY ), maxY = std::min( base->maxY, tile.maxY );
+        // Pixel blocks are aligned to the tile so a block never crosses the border between two tiles
+        const int32_t blockMinX = tile.minX + ( ( minX - tile.minX ) & ~( SIMD_PIXEL_BLOCK_WIDTH - 1 ) );
+        const int32_t blockMinY = tile.minY + ( ( minY - tile.minY ) & ~( SIMD_PIXEL_BLOCK_HEIGHT - 1 ) );
+        const int32_t offsetX = blockMinX - base->minX, offsetY = blockMinY - base->minY;
+
+        // Fetch all base attributes, edge functions of every lane at the first block and their increments per block
+        const int32_t a01 = base->a01, a12 = base->a12, a20 = base->a20;
+        const int32_t b01 = base->b01, b12 = base->b12, b20 = base->b20;
+        VInt w0_row = Add( Set1( base->w0_row + a12 * offsetX + b12 * offsetY ), Add( Mul( Set1( a12 ), laneOffsetX ), Mul( Set1( b12 ), laneOffsetY ) ) );
+        VInt w1_row = Add( Set1( base->w1_row + a20 * offsetX + b20 * offsetY ), Add( Mul( Set1( a20 ), laneOffsetX ), Mul( Set1( b20 ), laneOffsetY ) ) );
+        VInt w2_row = Add( Set1( base->w2_row + a01 * offsetX + b01 * offsetY ), Add( Mul( Set1( a01 ), laneOffsetX ), Mul( Set1( b01 ), laneOffsetY ) ) );
+        const VInt w0_a = Set1( a12 * SIMD_PIXEL_BLOCK_WIDTH ), w1_a = Set1( a20 * SIMD_PIXEL_BLOCK_WIDTH ), w2_a = Set1( a01 * SIMD_PIXEL_BLOCK_WIDTH );
+        const VInt w0_b = Set1( b12 * SIMD_PIXEL_BLOCK_HEIGHT ), w1_b = Set1( b20 * SIMD_PIXEL_BLOCK_HEIGHT ), w2_b = Set1( b01 * SIMD_PIXEL_BLOCK_HEIGHT );
+
+        const VInt faceSign = Set1( int32_t( base->faceSign << 24 ) ); // 8bit to 32bit
+
+#define FETCH_ATTRIBUTE( dstName, srcName, offset, condition ) \
+        VFloat dstName##_row, dstName##_a, dstName##_b; \
+        if ( condition ) \
+        { \
+            const STriangleAttribute* attr = (const STriangleAttribute*)( input.srcName + triangleOffset ); \
+            attr += offset; \
+            const VFloat a = Set1( attr->a ), b = Set1( attr->b ); \
+            dstName##_row = Add( Set1( attr->row + attr->a * offsetX + attr->b * offsetY ), Add( Mul( a, laneOffsetXf ), Mul( b, laneOffsetYf ) ) ); \
+            dstName##_a = Mul( a, blockWidth ); \
+            dstName##_b = Mul( b, blockHeight ); \
+        }
+
+        FETCH_ATTRIBUTE( z, z, 0, true )
+    
+        FETCH_ATTRIBUTE( rcpw, rcpw, 0, NeedRcpw )
+
+        FETCH_ATTRIBUTE( texU_w, texcoord, 0, UseTexture )
+        FETCH_ATTRIBUTE( texV_w, texcoord, 1, UseTexture )
+
+        FETCH_ATTRIBUTE( colorR_w, color, 0, UseVertexColor )
+        FETCH_ATTRIBUTE( colorG_w, color, 1, UseVertexColor )
+        FETCH_ATTRIBUTE( colorB_w, color, 2, UseVertexColor )
+
+        FETCH_ATTRIBUTE( normalX_w, normal, 0, NeedLighting )
+        FETCH_ATTRIBUTE( normalY_w, normal, 1, NeedLighting )
+        FETCH_ATTRIBUTE( normalZ_w, normal, 2, NeedLighting )
+
+        FETCH_ATTRIBUTE( viewPosX_w, viewPos, 0, NeedViewPos )
+        FETCH_ATTRIBUTE( viewPosY_w, viewPos, 1, NeedViewPos )
+        FETCH_ATTRIBUTE( viewPosZ_w, viewPos, 2, NeedViewPos )
+
+#undef FETCH_ATTRIBUTE
+
+        // Depth range of the triangle plane over a Hi-Z block, relative to the depth at the top left pixel of the block
+        const STriangleAttribute* zAttr = (const STriangleAttribute*)( input.z + triangleOffset );
+        const float zBlockMinOffset = ( std::min( zAttr->a, 0.f ) + std::min( zAttr->b, 0.f ) ) * ( s_HiZBlockSize - 1 );
+        const float zBlockMaxOffset = ( std::max( zAttr->a, 0.f ) + std::max( zAttr->b, 0.f ) ) * ( s_HiZBlockSize - 1 );
+
+        SPixelAttributes attributes;
+        if ( UseTexture )
+        {
+            SetTexcoordGradients( input, triangleOffset, &attributes );
+        }
+
+        const SEdgeFunction edges[ 3 ] = { MakeEdgeFunction( base->w0_row, a12, b12, base->faceSign ), MakeEdgeFunction( base->w1_row, a20, b20, base->faceSign ),
+            MakeEdgeFunction( base->w2_row, a01, b01, base->faceSign ) };
+
+        // Every bit stands for a 8x8 Hi-Z block in the current row of blocks
+        uint32_t visibleMask = 0; // Blocks with covered pixels which may pass the depth test
+        uint32_t coveredMask = 0; // Blocks whose pixels are all covered
+        uint32_t hiZFrontMask = 0; // Blocks where the triangle passes the depth test everywhere
+        uint32_t hiZWrittenMask = 0; // Blocks whose depth is written
+        int32_t hiZBlockY = -1;
+
+        // Every bit stands for a 4x4 sub-block in the current row of sub-blocks
+        uint32_t subBlockVisibleMask = 0;
+        uint32_t subBlockCoveredMask = 0;
+        int32_t subBlockY = -1;
+
+        for ( int32_t imgY = blockMinY; imgY <= maxY; imgY += SIMD_PIXEL_BLOCK_HEIGHT )
+        {
+            if ( imgY / s_HiZBlockSize != hiZBlockY )
+            {
+                if ( hiZWrittenMask != 0 && hiZ != nullptr )
+                {
+                    hiZWrittenBlocks |= uint64_t( hiZWrittenMask ) << ( ( hiZBlockY - tileBlockY ) * s_HiZBlocksPerTile );
+                }
+                hiZWrittenMask = 0;
+
+                // Trivially reject the blocks in the row out of an edge and accept the ones inside all edges,
+                // then test the depth range of the triangle over the remaining blocks against the Hi-Z
+                hiZBlockY = imgY / s_HiZBlockSize;
+                visibleMask = 0;
+                coveredMask = 0;
+                hiZFrontMask = 0;
+                for ( int32_t blockX = minX / s_HiZBlockSize; blockX <= maxX / s_HiZBlockSize; ++blockX )
+                {
+                    const int32_t blockPixelX = blockX * s_HiZBlockSize, blockPixelY = hiZBlockY * s_HiZBlockSize;
+                    const uint32_t blockBit = 1u << ( blockX - tileBlockX );
+                    const EBlockCoverage coverage = ClassifyBlock<s_HiZBlockSize>( edges, blockPixelX - base->minX, blockPixelY - base->minY );
+                    if ( coverage == EBlockCoverage::eOutside )
+                    {
+                        continue;
+                    }
+                    coveredMask |= coverage == EBlockCoverage::eInside ? blockBit : 0;
+
+                    if ( hiZ == nullptr )
+                    {
+                        visibleMask |= blockBit;
+                        continue;
+                    }
+
+                    const float zTopLeft = zAttr->row + zAttr->a * ( blockPixelX - base->minX ) + zAttr->b * ( blockPixelY - base->minY );
+                    const float zMin = std::max( zTopLeft + zBlockMinOffset, base->minZ );
+                    const float zMax = std::min( zTopLeft + zBlockMaxOffset, base->maxZ );
+                    const uint32_t blockIndex = hiZBlockY * hiZ->blocksCountX + blockX;
+                    visibleMask |= zMin < hiZ->blockMaxZ[ blockIndex ] ? blockBit : 0;
+                    // The minimum depth of a written block is out of date
+                    const bool isBlockWritten = ( hiZWrittenBlocks & ( uint64_t( blockBit ) << ( ( hiZBlockY - tileBlockY ) * s_HiZBlocksPerTile ) ) ) != 0;
+                    hiZFrontMask |= !isBlockWritten && zMax < hiZ->blockMinZ[ blockIndex ] ? blockBit : 0;
+                }
+            }
+
+            if ( imgY / s_SubBlockSize != subBlockY )
+            {
+                // Split the partially covered blocks of the row into sub-blocks and classify them the same way
+                subBlockY = imgY / s_SubBlockSize;
+                subBlockVisibleMask = 0;
+                subBlockCoveredMask = 0;
+                for ( int32_t blockX = minX / s_SubBlockSize; blockX <= maxX / s_SubBlockSize; ++blockX )
+                {
+                    const uint32_t parentBlockBit = 1u << ( blockX * s_SubBlockSize / s_HiZBlockSize - tileBlockX );
+                    const uint32_t blockBit = 1u << ( blockX - tile.minX / s_SubBlockSize );
+                    if ( ( visibleMask & parentBlockBit ) == 0 )
+                    {
+                        continue;
+                    }
+
+                    EBlockCoverage coverage = EBlockCoverage::eInside;
+                    if ( ( coveredMask & parentBlockBit ) == 0 )
+                    {
+                        coverage = ClassifyBlock<s_SubBlockSize>( edges, blockX * s_SubBlockSize - base->minX, subBlockY * s_SubBlockSize - base->minY );
+                    }
+                    subBlockVisibleMask |= coverage != EBlockCoverage::eOutside ? blockBit : 0;
+                    subBlockCoveredMask |= coverage == EBlockCoverage::eInside ? blockBit : 0;
+                }
+            }
+
+            VInt w0 = w0_row;
+            VInt w1 = w1_row;
+            VInt w2 = w2_row;
+
+#define ROW_INIT_ATTRIBUTE( name, condition ) \
+            if ( condition ) \
+            { \
+                attributes.name = name##_row; \
+            }
+
+            ROW_INIT_ATTRIBUTE( z, true )
+        
+            ROW_INIT_ATTRIBUTE( rcpw, NeedRcpw )
+
+            ROW_INIT_ATTRIBUTE( texU_w, UseTexture )
+            ROW_INIT_ATTRIBUTE( texV_w, UseTexture )
+
+            ROW_INIT_ATTRIBUTE( colorR_w, UseVertexColor )
+            ROW_INIT_ATTRIBUTE( colorG_w, UseVertexColor )
+            ROW_INIT_ATTRIBUTE( colorB_w, UseVertexColor )
+
+            ROW_INIT_ATTRIBUTE( normalX_w, NeedLighting )
+            ROW_INIT_ATTRIBUTE( normalY_w, NeedLighting )
+            ROW_INIT_ATTRIBUTE( normalZ_w, NeedLighting )
+
+            ROW_INIT_ATTRIBUTE( viewPosX_w, NeedViewPos )
+            ROW_INIT_ATTRIBUTE( viewPosY_w, NeedViewPos )
+            ROW_INIT_ATTRIBUTE( viewPosZ_w, NeedViewPos )
+
+#undef ROW_INIT_ATTRIBUTE
+
+            // Lanes below the bottom of the tile are masked off
+            const VInt rowMask = CmpGt( Set1( tile.maxY - imgY + 1 ), laneOffsetY );
+
+            for ( int32_t imgX = blockMinX; imgX <= maxX; imgX += SIMD_PIXEL_BLOCK_WIDTH )
+            {
+                {
+                    // Skip the blocks out of the triangle or rejected by the Hi-Z before any other work
+                    const uint32_t subBlockBit = 1u << ( ( imgX - tile.minX ) / s_SubBlockSize );
+                    if ( ( subBlockVisibleMask & subBlockBit ) == 0 )
+                    {
+                        goto NextBlock;
+                    }
+                    const uint32_t hiZBlockBit = 1u << ( imgX / s_HiZBlockSize - tileBlockX );
+
+                    // Lanes right to the tile are masked off
+                    const VInt tileMask = And( rowMask, CmpGt( Set1( tile.maxX - imgX + 1 ), laneOffsetX ) );
+                    const uint32_t laneMask = MoveMask( tileMask );
+
+                    // The pixels of fully covered blocks skip the edge tests
+                    VInt mask = tileMask;
+                    if ( ( subBlockCoveredMask & subBlockBit ) == 0 )
+                    {
+                        // "Inside" fragments yields positive
+                        const VInt edgeSigns = Or( Or( Xor( faceSign, w0 ), Xor( faceSign, w1 ) ), Xor( faceSign, w2 ) );
+                        mask = And( tileMask, CmpGt( edgeSigns, Set1( -1 ) ) );
+                        if ( MoveMask( mask ) == 0 )
+                        {
+                            goto NextBlock;
+                        }
+                    }
+                    if ( ShadeBlock<UseTexture, UseVertexColor, LightingModel, LightType, EnableAlphaTest, EnableAlphaBlend, TextureFilter>( state, &textureBlockCache, imgX, imgY, laneMask, mask,
+                        ( hiZFrontMask & hiZBlockBit ) == 0, attributes, &tileStats ) )
+                    {
+                        hiZWrittenMask |= hiZBlockBit;
+                    }
+                }
+
+NextBlock:
+                w0 = Add( w0, w0_a );
+                w1 = Add( w1, w1_a );
+                w2 = Add( w2, w2_a );
+
+#define ROW_INC_ATTRIBUTE( name, condition ) \
+                if ( condition ) \
+                { \
+                    attributes.name = Add( attributes.name, name##_a ); \
+                }
+
+                ROW_INC_ATTRIBUTE( z, true )
+
+                ROW_INC_ATTRIBUTE( rcpw, NeedRcpw )
+
+                ROW_INC_ATTRIBUTE( texU_w, UseTexture )
+                ROW_INC_ATTRIBUTE( texV_w, UseTexture )
+
+                ROW_INC_ATTRIBUTE( colorR_w, UseVertexColor )
+                ROW_INC_ATTRIBUTE( colorG_w, UseVertexColor )
+                ROW_INC_ATTRIBUTE( colorB_w, UseVertexColor )
+
+                ROW_INC_ATTRIBUTE( normalX_w, NeedLighting )
+                ROW_INC_ATTRIBUTE( normalY_w, NeedLighting )
+                ROW_INC_ATTRIBUTE( normalZ_w, NeedLighting )
+
+                ROW_INC_ATTRIBUTE( viewPosX_w, NeedViewPos )
+                ROW_INC_ATTRIBUTE( viewPosY_w, NeedViewPos )
+                ROW_INC_ATTRIBUTE( viewPosZ_w, NeedViewPos )
+
+#undef ROW_INC_ATTRIBUTE
+            }
+
+            w0_row = Add( w0_row, w0_b );
+            w1_row = Add( w1_row, w1_b );
+            w2_row = Add( w2_row, w2_b );
+
+#define VERTICAL_INC_ATTRIBUTE( name, condition ) \
+            if ( condition ) \
+            { \
+                name##_row = Add( name##_row, name##_b ); \
+            }
+
+            VERTICAL_INC_ATTRIBUTE( z, true )
+
+            VERTICAL_INC_ATTRIBUTE( rcpw, NeedRcpw )
+
+            VERTICAL_INC_ATTRIBUTE( texU_w, UseTexture )
+            VERTICAL_INC_ATTRIBUTE( texV_w, UseTexture )
+
+            VERTICAL_INC_ATTRIBUTE( colorR_w, UseVertexColor )
+            VERTICAL_INC_ATTRIBUTE( colorG_w, UseVertexColor )
+            VERTICAL_INC_ATTRIBUTE( colorB_w, UseVertexColor )
+
+            VERTICAL_INC_ATTRIBUTE( normalX_w, NeedLighting )
+            VERTICAL_INC_ATTRIBUTE( normalY_w, NeedLighting )
+            VERTICAL_INC_ATTRIBUTE( normalZ_w, NeedLighting )
+
+            VERTICAL_INC_ATTRIBUTE( viewPosX_w, NeedViewPos )
+            VERTICAL_INC_ATTRIBUTE( viewPosY_w, NeedViewPos )
+            VERTICAL_INC_ATTRIBUTE( viewPosZ_w, NeedViewPos )
+
+#undef VERTICAL_INC_ATTRIBUTE
+        }
+
+        if ( hiZ != nullptr && hiZWrittenMask != 0 )
+        {
+            hiZWrittenBlocks |= uint64_t( hiZWrittenMask ) << ( ( hiZBlockY - tileBlockY ) * s_HiZBlocksPerTile );
+        }
+    }
+
+    if ( hiZWrittenBlocks != 0 )
+    {
+        UpdateHiZTile( state, tile, hiZWrittenBlocks );
+    }
+
+    RASTERIZER_STATS(
+        stats->pixelsTested += tileStats.pixelsTested;
+        stats->pixelsDepthPassed += tileStats.pixelsDepthPassed;
+        stats->pixelsAlphaKilled += tileStats.pixelsAlphaKilled;
+        stats->pixelsWritten += tileStats.pixelsWritten; )
+}
+
+// Copies the rows of a tile of a tiled target to the linear image, width and height are the pixels of the tile inside of the image.
+// The linear image is only read once the frame is done, so its rows are streamed past the caches when they start on a cache line.
+// Streaming rows that cover cache lines partially would be slower than storing them, every line would be written to memory in pieces
+static void ResolveTile( const uint32_t* tile, uint32_t* dst, uint32_t dstPitch, uint32_t width, uint32_t height )
+{
+    using namespace SIMDMath;
+
+    const bool streamRows = uintptr_t( dst ) % 64 == 0 && dstPitch % 16 == 0;
+    for ( uint32_t y = 0; y < height; ++y )
+    {
+        const uint32_t* srcRow = tile + y * s_TileSize;
+        uint32_t* dstRow = dst + y * dstPitch;
+        uint32_t x = 0;
+        if ( streamRows )
+        {
+            for ( ; x + SIMD_PIXEL_WIDTH <= width; x += SIMD_PIXEL_WIDTH )
+            {
+                StoreStream( dstRow + x, LoadUnaligned( srcRow + x ) );
+            }
+        }
+        else
+        {
+            for ( ; x + SIMD_PIXEL_WIDTH <= width; x += SIMD_PIXEL_WIDTH )
+            {
+                StoreUnaligned( dstRow + x, LoadUnaligned( srcRow + x ) );
+            }
+        }
+        // Tiles cut by the image border
+        for ( ; x < width; ++x )
+        {
+            dstRow[ x ] = srcRow[ x ];
+        }
+    }
+    // The streamed stores are weakly ordered, they have to be visible before the thread waiting for the resolve reads them
+    _mm_sfence();
+}
+
+#define RASTERIZATION_KERNELS_NAMESPACE_NAME( instructionSet ) RasterizationKernels_##instructionSet
+#define RASTERIZATION_KERNELS_NAMESPACE( instructionSet ) RASTERIZATION_KERNELS_NAMESPACE_NAME( instructionSet )
+
+void RASTERIZATION_KERNELS_NAMESPACE( RASTERIZATION_KERNELS_INSTRUCTION_SET )::FillFunctionTables( VertexTransformFunctionPtr* vertexTransformTable,
+    PerspectiveDivisionFunctionPtr* perspectiveDivisionTable, TriangleSetupFunctionPtr* triangleSetupTable, RasterizingFunctionPtr* rasterizingTable,
+    ResolveTileFunctionPtr* resolveTileFunction )
+{
+    *resolveTileFunction = ResolveTile;
+
+#define SET_VERTEX_TRANSFORM_FUNCTION_TABLE( useNormal, useViewPos ) \
+    vertexTransformTable[ MakeFunctionIndex_VertexTransform( useNormal, useViewPos ) ] = TransformVertices<useNormal, useViewPos>;
+
+    SET_VERTEX_TRANSFORM_FUNCTION_TABLE( false, false )
+    SET_VERTEX_TRANSFORM_FUNCTION_TABLE( true, false )
+    SET_VERTEX_TRANSFORM_FUNCTION_TABLE( true, true )
+#undef SET_VERTEX_TRANSFORM_FUNCTION_TABLE
+
+#define SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( useTexture, useColor, useNormal, useViewPos ) \
+    perspectiveDivisionTable[ MakeFunctionIndex_PerspectiveDivision( useTexture, useColor, useNormal, useViewPos ) ] = PerspectiveDivision<useTexture, useColor, useNormal, useViewPos>;
+
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, false, false, false )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, false, true, false )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, false, true, true )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, true, false, false )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, true, true, false )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( false, true, true, true )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, false, false, false )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, false, true, false )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, false, true, true )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, true, false, false )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, true, true, false )
+    SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE( true, true, true, true )
+#undef SET_PERSPECTIVE_DIVISION_FUNCTION_TABLE
+
+#define SET_TRIANGLE_SETUP_FUNCTION_TABLE( useTexture, useColor, useNormal, useViewPos ) \
+    triangleSetupTable[ MakeFunctionIndex_TriangleSetup( useTexture, useColor, useNormal, useViewPos ) ] = SetupTriangles<useTexture, useColor, useNormal, useViewPos>;
+
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, false, false, false )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, false, true, false )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, false, true, true )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, true, false, false )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, true, true, false )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( false, true, true, true )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, false, false, false )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, false, true, false )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, false, true, true )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, true, false, false )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, true, true, false )
+    SET_TRIANGLE_SETUP_FUNCTION_TABLE( true, true, true, true )
+#undef SET_TRIANGLE_SETUP_FUNCTION_TABLE
+
+#define SET_RASTERIZING_FUNCTION_TABLE( useTexture, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend, textureFilter ) \
+    rasterizingTable[ MakeFunctionIndex_RasterizeTriangles( useTexture, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend, textureFilter ) ] = RasterizeTriangles<useTexture, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend, textureFilter>;
+#define SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend ) \
+    SET_RASTERIZING_FUNCTION_TABLE( true, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend, ETextureFilter::ePoint ) \
+    SET_RASTERIZING_FUNCTION_TABLE( true, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend, ETextureFilter::eBilinear ) \
+    SET_RASTERIZING_FUNCTION_TABLE( true, useColor, lightingModel, lightType, enableAlphaTest, enableAlphaBlend, ETextureFilter::eTrilinear )
+    
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eUnlit, ELightType::eDirectional, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::eDirectional, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::ePoint, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::ePoint, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eUnlit, ELightType::eDirectional, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::eDirectional, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::ePoint, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::ePoint, false, false, ETextureFilter::ePoint );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eUnlit, ELightType::eDirectional, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eLambert, ELightType::eDirectional, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eLambert, ELightType::ePoint, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eBlinnPhong, ELightType::ePoint, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eUnlit, ELightType::eDirectional, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eLambert, ELightType::eDirectional, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eLambert, ELightType::ePoint, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eBlinnPhong, ELightType::ePoint, false, false );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eUnlit, ELightType::eDirectional, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::eDirectional, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::ePoint, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::ePoint, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eUnlit, ELightType::eDirectional, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::eDirectional, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::ePoint, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, false, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::ePoint, true, false, ETextureFilter::ePoint );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eUnlit, ELightType::eDirectional, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eLambert, ELightType::eDirectional, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eLambert, ELightType::ePoint, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eBlinnPhong, ELightType::ePoint, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eUnlit, ELightType::eDirectional, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eLambert, ELightType::eDirectional, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eLambert, ELightType::ePoint, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, false );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eBlinnPhong, ELightType::ePoint, true, false );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eUnlit, ELightType::eDirectional, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::eDirectional, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::ePoint, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::ePoint, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eUnlit, ELightType::eDirectional, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::eDirectional, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::ePoint, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::ePoint, false, true, ETextureFilter::ePoint );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eUnlit, ELightType::eDirectional, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eLambert, ELightType::eDirectional, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eLambert, ELightType::ePoint, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eBlinnPhong, ELightType::ePoint, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eUnlit, ELightType::eDirectional, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eLambert, ELightType::eDirectional, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eLambert, ELightType::ePoint, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eBlinnPhong, ELightType::eDirectional, false, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eBlinnPhong, ELightType::ePoint, false, true );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eUnlit, ELightType::eDirectional, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::eDirectional, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eLambert, ELightType::ePoint, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, false, ELightingModel::eBlinnPhong, ELightType::ePoint, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eUnlit, ELightType::eDirectional, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::eDirectional, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eLambert, ELightType::ePoint, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, true, ETextureFilter::ePoint );
+    SET_RASTERIZING_FUNCTION_TABLE( false, true, ELightingModel::eBlinnPhong, ELightType::ePoint, true, true, ETextureFilter::ePoint );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eUnlit, ELightType::eDirectional, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eLambert, ELightType::eDirectional, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eLambert, ELightType::ePoint, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( false, ELightingModel::eBlinnPhong, ELightType::ePoint, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eUnlit, ELightType::eDirectional, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eLambert, ELightType::eDirectional, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eLambert, ELightType::ePoint, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eBlinnPhong, ELightType::eDirectional, true, true );
+    SET_TEXTURED_RASTERIZING_FUNCTION_TABLE( true, ELightingModel::eBlinnPhong, ELightType::ePoint, true, true );
+
+#undef SET_TEXTURED_RASTERIZING_FUNCTION_TABLE
+#undef SET_RASTERIZING_FUNCTION_TABLE
+}
+
+#undef RASTERIZATION_KERNELS_NAMESPACE
+#undef RASTERIZATION_KERNELS_NAMESPACE_NAME
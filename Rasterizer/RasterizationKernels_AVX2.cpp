@@ -0,0 +1,10 @@
+#include "PCH.h"
+#include "RasterizationKernels.h"
+
+// Compiled with /arch:AVX2, or -mavx2 -mfma with GCC and Clang
+#if !defined( __AVX2__ ) || defined( __AVX512F__ )
+#error The AVX2 kernels must be compiled with AVX2 enabled
+#endif
+
+#define RASTERIZATION_KERNELS_INSTRUCTION_SET AVX2
+#include "RasterizationKernels.inl"
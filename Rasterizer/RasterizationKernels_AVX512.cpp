@@ -0,0 +1,10 @@
+#include "PCH.h"
+#include "RasterizationKernels.h"
+
+// Compiled with /arch:AVX512, or -mavx512f -mavx512cd -mavx512bw -mavx512dq -mavx512vl -mfma with GCC and Clang
+#if !defined( __AVX512F__ )
+#error The AVX-512 kernels must be compiled with AVX-512 enabled
+#endif
+
+#define RASTERIZATION_KERNELS_INSTRUCTION_SET AVX512
+#include "RasterizationKernels.inl"
@@ -0,0 +1,10 @@
+#include "PCH.h"
+#include "RasterizationKernels.h"
+
+// Compiled with the default options of the project, the baseline every host supports
+#if defined( __AVX__ )
+#error The SSE4.1 kernels must not be compiled with AVX enabled
+#endif
+
+#define RASTERIZATION_KERNELS_INSTRUCTION_SET SSE41
+#include "RasterizationKernels.inl"
@@ -2,30 +2,332 @@
 
 #include <immintrin.h>
 
+// All functions have internal linkage because this file is compiled with different instruction sets by the kernels,
+// the linker must not pick a function compiled for another instruction set
 namespace SIMDMath
 { 
-    inline void __vectorcall Vec3DotVec3( __m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz, __m128& out )
+    // a * b + c, fused when FMA is available. FMA comes with AVX2 on every CPU the kernels target.
+    static inline __m128 __vectorcall MulAdd( __m128 a, __m128 b, __m128 c )
     {
-        out = _mm_fmadd_ps( ax, bx, _mm_fmadd_ps( ay, by, _mm_mul_ps( az, bz ) ) );
+#if defined( __AVX2__ )
+        return _mm_fmadd_ps( a, b, c );
+#else
+        return _mm_add_ps( _mm_mul_ps( a, b ), c );
+#endif
     }
+}
+
+// Vectors of the pixel pipeline, each vector holds a block of pixels
+// SSE processes 2x2 pixels per vector, AVX2 processes 4x2 pixels per vector, AVX-512 processes 4x4 pixels per vector
+// The vertex transform, the perspective division and the triangle setup use the same vectors with one vertex or one triangle per lane
+#if defined( __AVX512F__ )
+#define SIMD_PIXEL_WIDTH 16
+#define SIMD_PIXEL_BLOCK_WIDTH 4
+#define SIMD_PIXEL_BLOCK_HEIGHT 4
+#elif defined( __AVX2__ )
+#define SIMD_PIXEL_WIDTH 8
+#define SIMD_PIXEL_BLOCK_WIDTH 4
+#define SIMD_PIXEL_BLOCK_HEIGHT 2
+#else
+#define SIMD_PIXEL_WIDTH 4
+#define SIMD_PIXEL_BLOCK_WIDTH 2
+#define SIMD_PIXEL_BLOCK_HEIGHT 2
+#endif
+#define SIMD_PIXEL_FULL_MASK ( ( 1u << SIMD_PIXEL_WIDTH ) - 1 )
+
+namespace SIMDMath
+{
+#if defined( __AVX512F__ )
+    // Masks are kept in vectors like the narrower instruction sets, so the kernels are written once for all of them
+    typedef __m512 VFloat;
+    typedef __m512i VInt;
+
+    static inline VInt __vectorcall MaskToVector( __mmask16 mask ) { return _mm512_maskz_mov_epi32( mask, _mm512_set1_epi32( -1 ) ); }
+    static inline __mmask16 __vectorcall VectorToMask( VInt mask ) { return _mm512_cmplt_epi32_mask( mask, _mm512_setzero_si512() ); }
+
+    static inline VFloat __vectorcall Set1( float v ) { return _mm512_set1_ps( v ); }
+    static inline VInt __vectorcall Set1( int32_t v ) { return _mm512_set1_epi32( v ); }
+
+    static inline VFloat __vectorcall Load( const float* p ) { return _mm512_load_ps( p ); }
+    static inline VInt __vectorcall Load( const int32_t* p ) { return _mm512_load_si512( p ); }
+    static inline void __vectorcall Store( float* p, VFloat v ) { _mm512_store_ps( p, v ); }
+    static inline void __vectorcall Store( int32_t* p, VInt v ) { _mm512_store_si512( p, v ); }
+    static inline VInt __vectorcall LoadUnaligned( const uint32_t* p ) { return _mm512_loadu_si512( p ); }
+    static inline void __vectorcall StoreUnaligned( uint32_t* p, VInt v ) { _mm512_storeu_si512( p, v ); }
+    static inline void __vectorcall StoreStream( uint32_t* p, VInt v ) { _mm512_stream_si512( (__m512i*)p, v ); } // Aligned, bypasses the caches
+    static inline VFloat __vectorcall LoadUnaligned( const float* p ) { return _mm512_loadu_ps( p ); }
+    static inline void __vectorcall StoreUnaligned( float* p, VFloat v ) { _mm512_storeu_ps( p, v ); }
+
+    static inline VFloat __vectorcall Add( VFloat a, VFloat b ) { return _mm512_add_ps( a, b ); }
+    static inline VFloat __vectorcall Sub( VFloat a, VFloat b ) { return _mm512_sub_ps( a, b ); }
+    static inline VFloat __vectorcall Mul( VFloat a, VFloat b ) { return _mm512_mul_ps( a, b ); }
+    static inline VFloat __vectorcall MulAdd( VFloat a, VFloat b, VFloat c ) { return _mm512_fmadd_ps( a, b, c ); }
+    static inline VFloat __vectorcall Div( VFloat a, VFloat b ) { return _mm512_div_ps( a, b ); }
+    static inline VFloat __vectorcall Min( VFloat a, VFloat b ) { return _mm512_min_ps( a, b ); }
+    static inline VFloat __vectorcall Max( VFloat a, VFloat b ) { return _mm512_max_ps( a, b ); }
+    static inline VFloat __vectorcall Sqrt( VFloat a ) { return _mm512_sqrt_ps( a ); }
+    static inline VFloat __vectorcall Floor( VFloat a ) { return _mm512_roundscale_ps( a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC ); }
+    static inline VInt __vectorcall CmpLt( VFloat a, VFloat b ) { return MaskToVector( _mm512_cmp_ps_mask( a, b, _CMP_LT_OQ ) ); }
+    static inline VInt __vectorcall CmpGt( VFloat a, VFloat b ) { return MaskToVector( _mm512_cmp_ps_mask( a, b, _CMP_GT_OQ ) ); }
+    static inline VFloat __vectorcall Blend( VFloat a, VFloat b, VInt mask ) { return _mm512_mask_blend_ps( VectorToMask( mask ), a, b ); }
+
+    static inline VInt __vectorcall Add( VInt a, VInt b ) { return _mm512_add_epi32( a, b ); }
+    static inline VInt __vectorcall Sub( VInt a, VInt b ) { return _mm512_sub_epi32( a, b ); }
+    static inline VInt __vectorcall Mul( VInt a, VInt b ) { return _mm512_mullo_epi32( a, b ); }
+    static inline VInt __vectorcall Mul16( VInt a, VInt b ) { return _mm512_mullo_epi16( a, b ); } // Low 16 bits of the products of the 16 bit halves
+    static inline VInt __vectorcall Min( VInt a, VInt b ) { return _mm512_min_epi32( a, b ); }
+    static inline VInt __vectorcall Max( VInt a, VInt b ) { return _mm512_max_epi32( a, b ); }
+    static inline VInt __vectorcall And( VInt a, VInt b ) { return _mm512_and_si512( a, b ); }
+    static inline VInt __vectorcall Or( VInt a, VInt b ) { return _mm512_or_si512( a, b ); }
+    static inline VInt __vectorcall Xor( VInt a, VInt b ) { return _mm512_xor_si512( a, b ); }
+    static inline VInt __vectorcall CmpGt( VInt a, VInt b ) { return MaskToVector( _mm512_cmpgt_epi32_mask( a, b ) ); }
+    static inline VInt __vectorcall CmpEq( VInt a, VInt b ) { return MaskToVector( _mm512_cmpeq_epi32_mask( a, b ) ); }
+    static inline VInt __vectorcall ShiftLeft( VInt a, int count ) { return _mm512_slli_epi32( a, count ); }
+    static inline VInt __vectorcall ShiftRightLogical( VInt a, int count ) { return _mm512_srli_epi32( a, count ); }
+    static inline VInt __vectorcall Blend( VInt a, VInt b, VInt mask ) { return _mm512_mask_blend_epi32( VectorToMask( mask ), a, b ); }
+    static inline uint32_t __vectorcall MoveMask( VInt mask ) { return (uint32_t)VectorToMask( mask ); }
 
-    inline void __vectorcall Vec3DotVec4( __m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz, __m128 bw, __m128& out )
+    static inline VFloat __vectorcall ConvertToFloat( VInt a ) { return _mm512_cvtepi32_ps( a ); }
+    static inline VInt __vectorcall ConvertToInt( VFloat a ) { return _mm512_cvttps_epi32( a ); } // Truncates toward zero
+    static inline VFloat __vectorcall CastToFloat( VInt a ) { return _mm512_castsi512_ps( a ); }
+    static inline VInt __vectorcall CastToInt( VFloat a ) { return _mm512_castps_si512( a ); }
+
+    static inline VInt __vectorcall Gather( const uint32_t* base, VInt indices ) { return _mm512_i32gather_epi32( indices, (const int*)base, 4 ); }
+    static inline VFloat __vectorcall GatherStrided( const uint8_t* base, uint32_t stride ) // One float per lane, stride bytes apart
+    {
+        return _mm512_i32gather_ps( _mm512_mullo_epi32( _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ), _mm512_set1_epi32( stride ) ), base, 1 );
+    }
+    static inline VFloat __vectorcall GatherIndexed( const uint8_t* base, const uint32_t* indices, uint32_t stride ) // One float per lane, indices[ lane ] * stride bytes from base, below 2 GB
+    {
+        return _mm512_i32gather_ps( _mm512_mullo_epi32( _mm512_loadu_si512( indices ), _mm512_set1_epi32( stride ) ), base, 1 );
+    }
+
+    // Lane coordinates inside of a pixel block
+    static inline VInt LaneOffsetX() { return _mm512_setr_epi32( 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3 ); }
+    static inline VInt LaneOffsetY() { return _mm512_setr_epi32( 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3 ); }
+
+    // Loads/stores a pixel block whose rows are pitch elements apart
+    static inline VInt __vectorcall LoadBlock( const uint32_t* topLeft, uint32_t pitch )
     {
-        out = _mm_fmadd_ps( ax, bx, _mm_fmadd_ps( ay, by, _mm_fmadd_ps( az, bz, bw ) ) );
+        VInt v = _mm512_castsi128_si512( _mm_loadu_si128( (const __m128i*)topLeft ) );
+        v = _mm512_inserti32x4( v, _mm_loadu_si128( (const __m128i*)( topLeft + pitch ) ), 1 );
+        v = _mm512_inserti32x4( v, _mm_loadu_si128( (const __m128i*)( topLeft + pitch * 2 ) ), 2 );
+        return _mm512_inserti32x4( v, _mm_loadu_si128( (const __m128i*)( topLeft + pitch * 3 ) ), 3 );
     }
 
-    inline void __vectorcall Vec3MulMatrix4x4( __m128 x, __m128 y, __m128 z,
-                      __m128 m00, __m128 m01, __m128 m02, __m128 m03,
-                      __m128 m10, __m128 m11, __m128 m12, __m128 m13,
-                      __m128 m20, __m128 m21, __m128 m22, __m128 m23,
-                      __m128 m30, __m128 m31, __m128 m32, __m128 m33,
-                      __m128& outX, __m128& outY, __m128& outZ, __m128& outW )
+    static inline void __vectorcall StoreBlock( uint32_t* topLeft, uint32_t pitch, VInt v )
     {
-        outX = _mm_fmadd_ps( x, m00, _mm_fmadd_ps( y, m10, _mm_fmadd_ps( z, m20, m30 ) ) );
-        outY = _mm_fmadd_ps( x, m01, _mm_fmadd_ps( y, m11, _mm_fmadd_ps( z, m21, m31 ) ) );
-        outZ = _mm_fmadd_ps( x, m02, _mm_fmadd_ps( y, m12, _mm_fmadd_ps( z, m22, m32 ) ) );
-        outW = _mm_fmadd_ps( x, m03, _mm_fmadd_ps( y, m13, _mm_fmadd_ps( z, m23, m33 ) ) );
+        _mm_storeu_si128( (__m128i*)topLeft, _mm512_castsi512_si128( v ) );
+        _mm_storeu_si128( (__m128i*)( topLeft + pitch ), _mm512_extracti32x4_epi32( v, 1 ) );
+        _mm_storeu_si128( (__m128i*)( topLeft + pitch * 2 ), _mm512_extracti32x4_epi32( v, 2 ) );
+        _mm_storeu_si128( (__m128i*)( topLeft + pitch * 3 ), _mm512_extracti32x4_epi32( v, 3 ) );
     }
-}
-    
+#elif defined( __AVX2__ )
+    typedef __m256 VFloat;
+    typedef __m256i VInt;
+
+    static inline VFloat __vectorcall Set1( float v ) { return _mm256_set1_ps( v ); }
+    static inline VInt __vectorcall Set1( int32_t v ) { return _mm256_set1_epi32( v ); }
+
+    static inline VFloat __vectorcall Load( const float* p ) { return _mm256_load_ps( p ); }
+    static inline VInt __vectorcall Load( const int32_t* p ) { return _mm256_load_si256( (const __m256i*)p ); }
+    static inline void __vectorcall Store( float* p, VFloat v ) { _mm256_store_ps( p, v ); }
+    static inline void __vectorcall Store( int32_t* p, VInt v ) { _mm256_store_si256( (__m256i*)p, v ); }
+    static inline VInt __vectorcall LoadUnaligned( const uint32_t* p ) { return _mm256_loadu_si256( (const __m256i*)p ); }
+    static inline void __vectorcall StoreUnaligned( uint32_t* p, VInt v ) { _mm256_storeu_si256( (__m256i*)p, v ); }
+    static inline void __vectorcall StoreStream( uint32_t* p, VInt v ) { _mm256_stream_si256( (__m256i*)p, v ); } // Aligned, bypasses the caches
+    static inline VFloat __vectorcall LoadUnaligned( const float* p ) { return _mm256_loadu_ps( p ); }
+    static inline void __vectorcall StoreUnaligned( float* p, VFloat v ) { _mm256_storeu_ps( p, v ); }
+
+    static inline VFloat __vectorcall Add( VFloat a, VFloat b ) { return _mm256_add_ps( a, b ); }
+    static inline VFloat __vectorcall Sub( VFloat a, VFloat b ) { return _mm256_sub_ps( a, b ); }
+    static inline VFloat __vectorcall Mul( VFloat a, VFloat b ) { return _mm256_mul_ps( a, b ); }
+    static inline VFloat __vectorcall MulAdd( VFloat a, VFloat b, VFloat c ) { return _mm256_fmadd_ps( a, b, c ); }
+    static inline VFloat __vectorcall Div( VFloat a, VFloat b ) { return _mm256_div_ps( a, b ); }
+    static inline VFloat __vectorcall Min( VFloat a, VFloat b ) { return _mm256_min_ps( a, b ); }
+    static inline VFloat __vectorcall Max( VFloat a, VFloat b ) { return _mm256_max_ps( a, b ); }
+    static inline VFloat __vectorcall Sqrt( VFloat a ) { return _mm256_sqrt_ps( a ); }
+    static inline VFloat __vectorcall Floor( VFloat a ) { return _mm256_floor_ps( a ); }
+    static inline VInt __vectorcall CmpLt( VFloat a, VFloat b ) { return _mm256_castps_si256( _mm256_cmp_ps( a, b, _CMP_LT_OQ ) ); }
+    static inline VInt __vectorcall CmpGt( VFloat a, VFloat b ) { return _mm256_castps_si256( _mm256_cmp_ps( a, b, _CMP_GT_OQ ) ); }
+    static inline VFloat __vectorcall Blend( VFloat a, VFloat b, VInt mask ) { return _mm256_blendv_ps( a, b, _mm256_castsi256_ps( mask ) ); }
+
+    static inline VInt __vectorcall Add( VInt a, VInt b ) { return _mm256_add_epi32( a, b ); }
+    static inline VInt __vectorcall Sub( VInt a, VInt b ) { return _mm256_sub_epi32( a, b ); }
+    static inline VInt __vectorcall Mul( VInt a, VInt b ) { return _mm256_mullo_epi32( a, b ); }
+    static inline VInt __vectorcall Mul16( VInt a, VInt b ) { return _mm256_mullo_epi16( a, b ); } // Low 16 bits of the products of the 16 bit halves
+    static inline VInt __vectorcall Min( VInt a, VInt b ) { return _mm256_min_epi32( a, b ); }
+    static inline VInt __vectorcall Max( VInt a, VInt b ) { return _mm256_max_epi32( a, b ); }
+    static inline VInt __vectorcall And( VInt a, VInt b ) { return _mm256_and_si256( a, b ); }
+    static inline VInt __vectorcall Or( VInt a, VInt b ) { return _mm256_or_si256( a, b ); }
+    static inline VInt __vectorcall Xor( VInt a, VInt b ) { return _mm256_xor_si256( a, b ); }
+    static inline VInt __vectorcall CmpGt( VInt a, VInt b ) { return _mm256_cmpgt_epi32( a, b ); }
+    static inline VInt __vectorcall CmpEq( VInt a, VInt b ) { return _mm256_cmpeq_epi32( a, b ); }
+    static inline VInt __vectorcall ShiftLeft( VInt a, int count ) { return _mm256_slli_epi32( a, count ); }
+    static inline VInt __vectorcall ShiftRightLogical( VInt a, int count ) { return _mm256_srli_epi32( a, count ); }
+    static inline VInt __vectorcall Blend( VInt a, VInt b, VInt mask ) { return _mm256_blendv_epi8( a, b, mask ); }
+    static inline uint32_t __vectorcall MoveMask( VInt mask ) { return (uint32_t)_mm256_movemask_ps( _mm256_castsi256_ps( mask ) ); }
+
+    static inline VFloat __vectorcall ConvertToFloat( VInt a ) { return _mm256_cvtepi32_ps( a ); }
+    static inline VInt __vectorcall ConvertToInt( VFloat a ) { return _mm256_cvttps_epi32( a ); } // Truncates toward zero
+    static inline VFloat __vectorcall CastToFloat( VInt a ) { return _mm256_castsi256_ps( a ); }
+    static inline VInt __vectorcall CastToInt( VFloat a ) { return _mm256_castps_si256( a ); }
+
+    static inline VInt __vectorcall Gather( const uint32_t* base, VInt indices ) { return _mm256_i32gather_epi32( (const int*)base, indices, 4 ); }
+    static inline VFloat __vectorcall GatherStrided( const uint8_t* base, uint32_t stride ) // One float per lane, stride bytes apart
+    {
+        return _mm256_i32gather_ps( (const float*)base, _mm256_mullo_epi32( _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ), _mm256_set1_epi32( stride ) ), 1 );
+    }
+    static inline VFloat __vectorcall GatherIndexed( const uint8_t* base, const uint32_t* indices, uint32_t stride ) // One float per lane, indices[ lane ] * stride bytes from base, below 2 GB
+    {
+        return _mm256_i32gather_ps( (const float*)base, _mm256_mullo_epi32( _mm256_loadu_si256( (const __m256i*)indices ), _mm256_set1_epi32( stride ) ), 1 );
+    }
+
+    // Lane coordinates inside of a pixel block
+    static inline VInt LaneOffsetX() { return _mm256_setr_epi32( 0, 1, 2, 3, 0, 1, 2, 3 ); }
+    static inline VInt LaneOffsetY() { return _mm256_setr_epi32( 0, 0, 0, 0, 1, 1, 1, 1 ); }
+
+    // Loads/stores a pixel block whose rows are pitch elements apart
+    static inline VInt __vectorcall LoadBlock( const uint32_t* topLeft, uint32_t pitch )
+    {
+        const __m128i row0 = _mm_loadu_si128( (const __m128i*)topLeft );
+        const __m128i row1 = _mm_loadu_si128( (const __m128i*)( topLeft + pitch ) );
+        return _mm256_inserti128_si256( _mm256_castsi128_si256( row0 ), row1, 1 );
+    }
+
+    static inline void __vectorcall StoreBlock( uint32_t* topLeft, uint32_t pitch, VInt v )
+    {
+        _mm_storeu_si128( (__m128i*)topLeft, _mm256_castsi256_si128( v ) );
+        _mm_storeu_si128( (__m128i*)( topLeft + pitch ), _mm256_extracti128_si256( v, 1 ) );
+    }
+#else
+    typedef __m128 VFloat;
+    typedef __m128i VInt;
 
+    // MulAdd is the __m128 one at the top, shared with the vertex pipeline
+
+    static inline VFloat __vectorcall Set1( float v ) { return _mm_set1_ps( v ); }
+    static inline VInt __vectorcall Set1( int32_t v ) { return _mm_set1_epi32( v ); }
+
+    static inline VFloat __vectorcall Load( const float* p ) { return _mm_load_ps( p ); }
+    static inline VInt __vectorcall Load( const int32_t* p ) { return _mm_load_si128( (const __m128i*)p ); }
+    static inline void __vectorcall Store( float* p, VFloat v ) { _mm_store_ps( p, v ); }
+    static inline void __vectorcall Store( int32_t* p, VInt v ) { _mm_store_si128( (__m128i*)p, v ); }
+    static inline VInt __vectorcall LoadUnaligned( const uint32_t* p ) { return _mm_loadu_si128( (const __m128i*)p ); }
+    static inline void __vectorcall StoreUnaligned( uint32_t* p, VInt v ) { _mm_storeu_si128( (__m128i*)p, v ); }
+    static inline void __vectorcall StoreStream( uint32_t* p, VInt v ) { _mm_stream_si128( (__m128i*)p, v ); } // Aligned, bypasses the caches
+    static inline VFloat __vectorcall LoadUnaligned( const float* p ) { return _mm_loadu_ps( p ); }
+    static inline void __vectorcall StoreUnaligned( float* p, VFloat v ) { _mm_storeu_ps( p, v ); }
+
+    static inline VFloat __vectorcall Add( VFloat a, VFloat b ) { return _mm_add_ps( a, b ); }
+    static inline VFloat __vectorcall Sub( VFloat a, VFloat b ) { return _mm_sub_ps( a, b ); }
+    static inline VFloat __vectorcall Mul( VFloat a, VFloat b ) { return _mm_mul_ps( a, b ); }
+    static inline VFloat __vectorcall Div( VFloat a, VFloat b ) { return _mm_div_ps( a, b ); }
+    static inline VFloat __vectorcall Min( VFloat a, VFloat b ) { return _mm_min_ps( a, b ); }
+    static inline VFloat __vectorcall Max( VFloat a, VFloat b ) { return _mm_max_ps( a, b ); }
+    static inline VFloat __vectorcall Sqrt( VFloat a ) { return _mm_sqrt_ps( a ); }
+    static inline VFloat __vectorcall Floor( VFloat a ) { return _mm_floor_ps( a ); }
+    static inline VInt __vectorcall CmpLt( VFloat a, VFloat b ) { return _mm_castps_si128( _mm_cmplt_ps( a, b ) ); }
+    static inline VInt __vectorcall CmpGt( VFloat a, VFloat b ) { return _mm_castps_si128( _mm_cmpgt_ps( a, b ) ); }
+    static inline VFloat __vectorcall Blend( VFloat a, VFloat b, VInt mask ) { return _mm_blendv_ps( a, b, _mm_castsi128_ps( mask ) ); }
+
+    static inline VInt __vectorcall Add( VInt a, VInt b ) { return _mm_add_epi32( a, b ); }
+    static inline VInt __vectorcall Sub( VInt a, VInt b ) { return _mm_sub_epi32( a, b ); }
+    static inline VInt __vectorcall Mul( VInt a, VInt b ) { return _mm_mullo_epi32( a, b ); }
+    static inline VInt __vectorcall Mul16( VInt a, VInt b ) { return _mm_mullo_epi16( a, b ); } // Low 16 bits of the products of the 16 bit halves
+    static inline VInt __vectorcall Min( VInt a, VInt b ) { return _mm_min_epi32( a, b ); }
+    static inline VInt __vectorcall Max( VInt a, VInt b ) { return _mm_max_epi32( a, b ); }
+    static inline VInt __vectorcall And( VInt a, VInt b ) { return _mm_and_si128( a, b ); }
+    static inline VInt __vectorcall Or( VInt a, VInt b ) { return _mm_or_si128( a, b ); }
+    static inline VInt __vectorcall Xor( VInt a, VInt b ) { return _mm_xor_si128( a, b ); }
+    static inline VInt __vectorcall CmpGt( VInt a, VInt b ) { return _mm_cmpgt_epi32( a, b ); }
+    static inline VInt __vectorcall CmpEq( VInt a, VInt b ) { return _mm_cmpeq_epi32( a, b ); }
+    static inline VInt __vectorcall ShiftLeft( VInt a, int count ) { return _mm_slli_epi32( a, count ); }
+    static inline VInt __vectorcall ShiftRightLogical( VInt a, int count ) { return _mm_srli_epi32( a, count ); }
+    static inline VInt __vectorcall Blend( VInt a, VInt b, VInt mask ) { return _mm_blendv_epi8( a, b, mask ); }
+    static inline uint32_t __vectorcall MoveMask( VInt mask ) { return (uint32_t)_mm_movemask_ps( _mm_castsi128_ps( mask ) ); }
+
+    static inline VFloat __vectorcall ConvertToFloat( VInt a ) { return _mm_cvtepi32_ps( a ); }
+    static inline VInt __vectorcall ConvertToInt( VFloat a ) { return _mm_cvttps_epi32( a ); } // Truncates toward zero
+    static inline VFloat __vectorcall CastToFloat( VInt a ) { return _mm_castsi128_ps( a ); }
+    static inline VInt __vectorcall CastToInt( VFloat a ) { return _mm_castps_si128( a ); }
+
+    static inline VInt __vectorcall Gather( const uint32_t* base, VInt indices )
+    {
+        alignas( 16 ) int32_t lanes[ 4 ];
+        _mm_store_si128( (__m128i*)lanes, indices );
+        return _mm_setr_epi32( base[ lanes[ 0 ] ], base[ lanes[ 1 ] ], base[ lanes[ 2 ] ], base[ lanes[ 3 ] ] );
+    }
+
+    static inline VFloat __vectorcall GatherStrided( const uint8_t* base, uint32_t stride ) // One float per lane, stride bytes apart
+    {
+        alignas( 16 ) float lanes[ 4 ];
+        lanes[ 0 ] = *(const float*)base;
+        lanes[ 1 ] = *(const float*)( base + stride );
+        lanes[ 2 ] = *(const float*)( base + stride * 2 );
+        lanes[ 3 ] = *(const float*)( base + stride * 3 );
+        return _mm_load_ps( lanes );
+    }
+
+    static inline VFloat __vectorcall GatherIndexed( const uint8_t* base, const uint32_t* indices, uint32_t stride ) // One float per lane, indices[ lane ] * stride bytes from base, below 2 GB
+    {
+        alignas( 16 ) float lanes[ 4 ];
+        lanes[ 0 ] = *(const float*)( base + size_t( indices[ 0 ] ) * stride );
+        lanes[ 1 ] = *(const float*)( base + size_t( indices[ 1 ] ) * stride );
+        lanes[ 2 ] = *(const float*)( base + size_t( indices[ 2 ] ) * stride );
+        lanes[ 3 ] = *(const float*)( base + size_t( indices[ 3 ] ) * stride );
+        return _mm_load_ps( lanes );
+    }
+
+    // Lane coordinates inside of a pixel block
+    static inline VInt LaneOffsetX() { return _mm_setr_epi32( 0, 1, 0, 1 ); }
+    static inline VInt LaneOffsetY() { return _mm_setr_epi32( 0, 0, 1, 1 ); }
+
+    // Loads/stores a pixel block whose rows are pitch elements apart
+    static inline VInt __vectorcall LoadBlock( const uint32_t* topLeft, uint32_t pitch )
+    {
+        const __m128i row0 = _mm_loadl_epi64( (const __m128i*)topLeft );
+        const __m128i row1 = _mm_loadl_epi64( (const __m128i*)( topLeft + pitch ) );
+        return _mm_unpacklo_epi64( row0, row1 );
+    }
+
+    static inline void __vectorcall StoreBlock( uint32_t* topLeft, uint32_t pitch, VInt v )
+    {
+        _mm_storel_epi64( (__m128i*)topLeft, v );
+        _mm_storel_epi64( (__m128i*)( topLeft + pitch ), _mm_unpackhi_epi64( v, v ) );
+    }
+#endif
+
+    // Dot products of 3 component vectors, one vector per lane. The second one of Vec3DotVec4 is a row of a matrix with w as the translation
+    static inline VFloat __vectorcall Vec3DotVec3( VFloat ax, VFloat ay, VFloat az, VFloat bx, VFloat by, VFloat bz )
+    {
+        return MulAdd( ax, bx, MulAdd( ay, by, Mul( az, bz ) ) );
+    }
+
+    static inline VFloat __vectorcall Vec3DotVec4( VFloat ax, VFloat ay, VFloat az, VFloat bx, VFloat by, VFloat bz, VFloat bw )
+    {
+        return MulAdd( ax, bx, MulAdd( ay, by, MulAdd( az, bz, bw ) ) );
+    }
+
+    // Approximation of log2 for positive normal numbers, the exponent is read from the float bits and log2 of the mantissa
+    // is fitted by a parabola through its exact values at 1 and 2, within 0.01 of the exact result
+    static inline VFloat __vectorcall Log2( VFloat a )
+    {
+        const VInt bits = CastToInt( a );
+        const VFloat exponent = ConvertToFloat( Sub( ShiftRightLogical( bits, 23 ), Set1( 127 ) ) );
+        const VFloat fraction = Sub( CastToFloat( Or( And( bits, Set1( 0x007FFFFF ) ), Set1( 0x3F800000 ) ) ), Set1( 1.f ) );
+        return Add( exponent, Mul( fraction, Sub( Set1( 1.3466f ), Mul( fraction, Set1( 0.3466f ) ) ) ) );
+    }
+
+    // There is no vector instruction for pow, the lanes are evaluated one by one
+    static inline VFloat __vectorcall Pow( VFloat base, float exponent )
+    {
+        alignas( SIMD_PIXEL_WIDTH * 4 ) float lanes[ SIMD_PIXEL_WIDTH ];
+        Store( lanes, base );
+        for ( uint32_t i = 0; i < SIMD_PIXEL_WIDTH; ++i )
+        {
+            lanes[ i ] = std::pow( lanes[ i ], exponent );
+        }
+        return Load( lanes );
+    }
+}
@@ -0,0 +1,117 @@
+#include "PCH.h"
+#include "Rasterizer.h"
+#include "RasterizationKernels.h"
+
+using namespace Rasterizer;
+
+uint32_t Rasterizer::GetMipLevelsCount( uint32_t width, uint32_t height )
+{
+    uint32_t levelsCount = 1;
+    for ( uint32_t size = std::max( width, height ); size > 1; size >>= 1 )
+    {
+        ++levelsCount;
+    }
+    return levelsCount;
+}
+
+// Texels of a mip level, the swizzled levels are padded to whole 4x4 blocks and the tiled ones to whole tiles
+static size_t GetLevelTexelsCount( uint32_t width, uint32_t height, uint32_t level, ETextureLayout layout )
+{
+    const size_t levelWidth = std::max( width >> level, 1u );
+    const size_t levelHeight = std::max( height >> level, 1u );
+    if ( layout == ETextureLayout::eSwizzled )
+    {
+        return ( ( levelWidth + 3 ) / 4 ) * ( ( levelHeight + 3 ) / 4 ) * 16;
+    }
+    if ( layout == ETextureLayout::eTiled )
+    {
+        return ( ( levelWidth + s_TileSize - 1 ) / s_TileSize ) * ( ( levelHeight + s_TileSize - 1 ) / s_TileSize ) * s_TileSize * s_TileSize;
+    }
+    return levelWidth * levelHeight;
+}
+
+// Position of a texel in its swizzled level, the rows of blocks are blocksCountX * 16 texels apart and the bits of x and y
+// inside of the block are interleaved
+static inline uint32_t GetSwizzledTexelIndex( uint32_t x, uint32_t y, uint32_t blocksCountX )
+{
+    const uint32_t blockIndex = ( y >> 2 ) * blocksCountX + ( x >> 2 );
+    const uint32_t mortonIndex = ( x & 1 ) | ( ( y & 1 ) << 1 ) | ( ( x & 2 ) << 1 ) | ( ( y & 2 ) << 2 );
+    return blockIndex * 16 + mortonIndex;
+}
+
+size_t Rasterizer::GetImageByteSize( uint32_t width, uint32_t height, uint32_t mipLevelsCount, ETextureLayout layout, ETextureFormat format )
+{
+    if ( IsBlockCompressed( format ) )
+    {
+        // Padded to whole blocks like the swizzled layout, with the byte size of the format for each block
+        return GetImageByteSize( width, height, mipLevelsCount, ETextureLayout::eSwizzled ) / 64 * GetBlockByteSize( format );
+    }
+
+    size_t texelsCount = 0;
+    for ( uint32_t level = 0; level < std::max( mipLevelsCount, 1u ); ++level )
+    {
+        texelsCount += GetLevelTexelsCount( width, height, level, layout );
+    }
+    return texelsCount * 4;
+}
+
+void Rasterizer::GenerateMips( const SImage& image )
+{
+    assert( image.m_Layout == ETextureLayout::eLinear && image.m_Format == ETextureFormat::eB8G8R8A8 );
+    const uint32_t* srcTexels = (const uint32_t*)image.m_Bits;
+    uint32_t srcWidth = image.m_Width, srcHeight = image.m_Height;
+    for ( uint32_t level = 1; level < image.m_MipLevelsCount; ++level )
+    {
+        const uint32_t dstWidth = std::max( srcWidth >> 1, 1u ), dstHeight = std::max( srcHeight >> 1, 1u );
+        uint32_t* dstTexels = (uint32_t*)srcTexels + srcWidth * srcHeight;
+        for ( uint32_t y = 0; y < dstHeight; ++y )
+        {
+            // The last row and column of odd sized levels are only averaged with their neighbors
+            const uint32_t* srcRow0 = srcTexels + ( y * 2 ) * srcWidth;
+            const uint32_t* srcRow1 = srcTexels + std::min( y * 2 + 1, srcHeight - 1 ) * srcWidth;
+            for ( uint32_t x = 0; x < dstWidth; ++x )
+            {
+                const uint32_t x0 = x * 2, x1 = std::min( x * 2 + 1, srcWidth - 1 );
+                uint32_t texel = 0;
+                for ( uint32_t shift = 0; shift < 32; shift += 8 )
+                {
+                    const uint32_t sum = ( srcRow0[ x0 ] >> shift & 0xFF ) + ( srcRow0[ x1 ] >> shift & 0xFF ) + ( srcRow1[ x0 ] >> shift & 0xFF ) + ( srcRow1[ x1 ] >> shift & 0xFF );
+                    texel |= ( ( sum + 2 ) >> 2 ) << shift;
+                }
+                dstTexels[ y * dstWidth + x ] = texel;
+            }
+        }
+
+        srcTexels = dstTexels;
+        srcWidth = dstWidth;
+        srcHeight = dstHeight;
+    }
+}
+
+SImage Rasterizer::SwizzleImage( const SImage& image, uint8_t* bits )
+{
+    assert( image.m_Layout == ETextureLayout::eLinear && image.m_Format == ETextureFormat::eB8G8R8A8 );
+    const uint32_t* srcTexels = (const uint32_t*)image.m_Bits;
+    uint32_t* dstTexels = (uint32_t*)bits;
+    for ( uint32_t level = 0; level < std::max( image.m_MipLevelsCount, 1u ); ++level )
+    {
+        const uint32_t width = std::max( image.m_Width >> level, 1u ), height = std::max( image.m_Height >> level, 1u );
+        const uint32_t blocksCountX = ( width + 3 ) / 4, blocksCountY = ( height + 3 ) / 4;
+        for ( uint32_t y = 0; y < blocksCountY * 4; ++y )
+        {
+            const uint32_t* srcRow = srcTexels + std::min( y, height - 1 ) * width;
+            for ( uint32_t x = 0; x < blocksCountX * 4; ++x )
+            {
+                dstTexels[ GetSwizzledTexelIndex( x, y, blocksCountX ) ] = srcRow[ std::min( x, width - 1 ) ];
+            }
+        }
+
+        srcTexels += GetLevelTexelsCount( image.m_Width, image.m_Height, level, ETextureLayout::eLinear );
+        dstTexels += GetLevelTexelsCount( image.m_Width, image.m_Height, level, ETextureLayout::eSwizzled );
+    }
+
+    SImage swizzledImage = image;
+    swizzledImage.m_Bits = bits;
+    swizzledImage.m_Layout = ETextureLayout::eSwizzled;
+    return swizzledImage;
+}
@@ -0,0 +1,581 @@
+#include "PCH.h"
+#include "Rasterizer.h"
+#include "RasterizationKernels.h"
+
+using namespace Rasterizer;
+
+static inline uint32_t PackTexel( uint32_t r, uint32_t g, uint32_t b, uint32_t a )
+{
+    return ( a << 24 ) | ( r << 16 ) | ( g << 8 ) | b;
+}
+
+// Expands a 5:6:5 color to 8 bits per channel by repeating the high bits in the low ones
+static inline void UnpackColor565( uint32_t color, uint32_t* rgb )
+{
+    const uint32_t r = color >> 11 & 0x1F, g = color >> 5 & 0x3F, b = color & 0x1F;
+    rgb[ 0 ] = ( r << 3 ) | ( r >> 2 );
+    rgb[ 1 ] = ( g << 2 ) | ( g >> 4 );
+    rgb[ 2 ] = ( b << 3 ) | ( b >> 2 );
+}
+
+// Colors of the 2 bit indices of a BC1 color block. Unless fourColors is set, color0 <= color1 selects 3 colors and transparent black
+static void MakeColorPalette( uint32_t color0, uint32_t color1, bool fourColors, uint32_t* palette )
+{
+    uint32_t rgb0[ 3 ], rgb1[ 3 ], rgb2[ 3 ], rgb3[ 3 ];
+    UnpackColor565( color0, rgb0 );
+    UnpackColor565( color1, rgb1 );
+    const bool opaque = fourColors || color0 > color1;
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        rgb2[ i ] = opaque ? ( rgb0[ i ] * 2 + rgb1[ i ] + 1 ) / 3 : ( rgb0[ i ] + rgb1[ i ] + 1 ) / 2;
+        rgb3[ i ] = ( rgb0[ i ] + rgb1[ i ] * 2 + 1 ) / 3;
+    }
+    palette[ 0 ] = PackTexel( rgb0[ 0 ], rgb0[ 1 ], rgb0[ 2 ], 255 );
+    palette[ 1 ] = PackTexel( rgb1[ 0 ], rgb1[ 1 ], rgb1[ 2 ], 255 );
+    palette[ 2 ] = PackTexel( rgb2[ 0 ], rgb2[ 1 ], rgb2[ 2 ], 255 );
+    palette[ 3 ] = opaque ? PackTexel( rgb3[ 0 ], rgb3[ 1 ], rgb3[ 2 ], 255 ) : 0;
+}
+
+// Alphas of the 3 bit indices of a BC3 alpha block, alpha0 <= alpha1 selects 6 alphas along with 0 and 255
+static void MakeAlphaPalette( uint32_t alpha0, uint32_t alpha1, uint32_t* palette )
+{
+    palette[ 0 ] = alpha0;
+    palette[ 1 ] = alpha1;
+    if ( alpha0 > alpha1 )
+    {
+        for ( uint32_t i = 2; i < 8; ++i )
+        {
+            palette[ i ] = ( ( 8 - i ) * alpha0 + ( i - 1 ) * alpha1 + 3 ) / 7;
+        }
+    }
+    else
+    {
+        for ( uint32_t i = 2; i < 6; ++i )
+        {
+            palette[ i ] = ( ( 6 - i ) * alpha0 + ( i - 1 ) * alpha1 + 2 ) / 5;
+        }
+        palette[ 6 ] = 0;
+        palette[ 7 ] = 255;
+    }
+}
+
+static void DecodeColorBlock( const uint8_t* block, bool fourColors, uint32_t* texels )
+{
+    uint32_t palette[ 4 ];
+    MakeColorPalette( block[ 0 ] | ( block[ 1 ] << 8 ), block[ 2 ] | ( block[ 3 ] << 8 ), fourColors, palette );
+    const uint32_t indices = block[ 4 ] | ( block[ 5 ] << 8 ) | ( block[ 6 ] << 16 ) | ( (uint32_t)block[ 7 ] << 24 );
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        texels[ i ] = palette[ indices >> ( i * 2 ) & 0x3 ];
+    }
+}
+
+static void DecodeAlphaBlock( const uint8_t* block, uint32_t* texels )
+{
+    uint32_t palette[ 8 ];
+    MakeAlphaPalette( block[ 0 ], block[ 1 ], palette );
+    uint64_t indices = 0;
+    for ( uint32_t i = 0; i < 6; ++i )
+    {
+        indices |= (uint64_t)block[ 2 + i ] << ( i * 8 );
+    }
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        texels[ i ] = ( texels[ i ] & 0x00FFFFFF ) | ( palette[ indices >> ( i * 3 ) & 0x7 ] << 24 );
+    }
+}
+
+// BC7 tables of the specification. The partitions of 2 subsets hold 1 bit per texel, the ones of 3 subsets 2 bits per texel
+static const uint16_t s_BC7Partitions2[ 64 ] =
+{
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+static const uint32_t s_BC7Partitions3[ 64 ] =
+{
+    0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+    0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+    0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+    0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+    0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+    0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+    0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+    0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+};
+
+// Texels whose index has one bit less, the first texel is the anchor of the first subset
+static const uint8_t s_BC7AnchorsOfSubset2Of2[ 64 ] =
+{
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+static const uint8_t s_BC7AnchorsOfSubset2Of3[ 64 ] =
+{
+     3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+     3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+     8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+     3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+};
+
+static const uint8_t s_BC7AnchorsOfSubset3Of3[ 64 ] =
+{
+    15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+    15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+    15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+    15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+};
+
+static const uint8_t s_BC7Weights2[ 4 ] = { 0, 21, 43, 64 };
+static const uint8_t s_BC7Weights3[ 8 ] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint8_t s_BC7Weights4[ 16 ] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct SBC7Mode
+{
+    uint8_t subsetsCount;
+    uint8_t partitionBits;
+    uint8_t rotationBits;
+    uint8_t indexSelectionBits;
+    uint8_t colorBits;
+    uint8_t alphaBits;
+    uint8_t endpointPBits; // One p-bit per endpoint
+    uint8_t sharedPBits; // One p-bit per subset
+    uint8_t indexBits;
+    uint8_t secondaryIndexBits;
+};
+
+static const SBC7Mode s_BC7Modes[ 8 ] =
+{
+    { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+    { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+    { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+    { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+    { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+    { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+    { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+    { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+};
+
+// Reads the fields of a block from its least significant bit on
+class CBitReader
+{
+public:
+    explicit CBitReader( const uint8_t* block )
+    {
+        memcpy( m_Bits, block, 16 );
+    }
+
+    uint32_t Read( uint32_t count )
+    {
+        uint32_t value = 0;
+        for ( uint32_t i = 0; i < count; ++i, ++m_Position )
+        {
+            value |= ( m_Bits[ m_Position >> 3 ] >> ( m_Position & 7 ) & 1 ) << i;
+        }
+        return value;
+    }
+
+private:
+    uint8_t m_Bits[ 16 ];
+    uint32_t m_Position = 0;
+};
+
+static inline uint32_t ExpandBC7Endpoint( uint32_t value, uint32_t bits )
+{
+    value <<= 8 - bits;
+    return value | ( value >> bits );
+}
+
+static inline uint32_t InterpolateBC7( uint32_t endpoint0, uint32_t endpoint1, uint32_t weight )
+{
+    return ( ( 64 - weight ) * endpoint0 + weight * endpoint1 + 32 ) >> 6;
+}
+
+static const uint8_t* GetBC7Weights( uint32_t indexBits )
+{
+    return indexBits == 2 ? s_BC7Weights2 : ( indexBits == 3 ? s_BC7Weights3 : s_BC7Weights4 );
+}
+
+static void DecodeBC7Block( const uint8_t* block, uint32_t* texels )
+{
+    // The mode is the position of the first bit set, the blocks of the reserved mode 8 are transparent black
+    uint32_t modeIndex = 0;
+    while ( modeIndex < 8 && ( block[ 0 ] >> modeIndex & 1 ) == 0 )
+    {
+        ++modeIndex;
+    }
+    if ( modeIndex == 8 )
+    {
+        memset( texels, 0, 16 * 4 );
+        return;
+    }
+
+    const SBC7Mode& mode = s_BC7Modes[ modeIndex ];
+    CBitReader reader( block );
+    reader.Read( modeIndex + 1 );
+    const uint32_t partition = reader.Read( mode.partitionBits );
+    const uint32_t rotation = reader.Read( mode.rotationBits );
+    const uint32_t indexSelection = reader.Read( mode.indexSelectionBits );
+
+    // Endpoints of every subset as RGBA, the channels are stored one after the other
+    const uint32_t endpointsCount = mode.subsetsCount * 2;
+    uint32_t endpoints[ 6 ][ 4 ];
+    for ( uint32_t channel = 0; channel < 4; ++channel )
+    {
+        const uint32_t bits = channel < 3 ? mode.colorBits : mode.alphaBits;
+        for ( uint32_t i = 0; i < endpointsCount; ++i )
+        {
+            endpoints[ i ][ channel ] = reader.Read( bits );
+        }
+    }
+
+    uint32_t pBits[ 6 ] = {};
+    if ( mode.endpointPBits )
+    {
+        for ( uint32_t i = 0; i < endpointsCount; ++i )
+        {
+            pBits[ i ] = reader.Read( 1 );
+        }
+    }
+    else if ( mode.sharedPBits )
+    {
+        for ( uint32_t subset = 0; subset < mode.subsetsCount; ++subset )
+        {
+            pBits[ subset * 2 ] = pBits[ subset * 2 + 1 ] = reader.Read( 1 );
+        }
+    }
+
+    const bool hasPBits = mode.endpointPBits || mode.sharedPBits;
+    for ( uint32_t i = 0; i < endpointsCount; ++i )
+    {
+        for ( uint32_t channel = 0; channel < 4; ++channel )
+        {
+            const uint32_t bits = channel < 3 ? mode.colorBits : mode.alphaBits;
+            if ( bits == 0 )
+            {
+                endpoints[ i ][ channel ] = 255;
+                continue;
+            }
+            uint32_t value = endpoints[ i ][ channel ];
+            if ( hasPBits )
+            {
+                value = ( value << 1 ) | pBits[ i ];
+            }
+            endpoints[ i ][ channel ] = ExpandBC7Endpoint( value, bits + ( hasPBits ? 1 : 0 ) );
+        }
+    }
+
+    // Subset of every texel and the anchors of the subsets
+    uint32_t subsets[ 16 ] = {};
+    uint32_t anchors[ 3 ] = { 0, 0, 0 };
+    if ( mode.subsetsCount == 2 )
+    {
+        for ( uint32_t i = 0; i < 16; ++i )
+        {
+            subsets[ i ] = s_BC7Partitions2[ partition ] >> i & 1;
+        }
+        anchors[ 1 ] = s_BC7AnchorsOfSubset2Of2[ partition ];
+    }
+    else if ( mode.subsetsCount == 3 )
+    {
+        for ( uint32_t i = 0; i < 16; ++i )
+        {
+            subsets[ i ] = s_BC7Partitions3[ partition ] >> ( i * 2 ) & 3;
+        }
+        anchors[ 1 ] = s_BC7AnchorsOfSubset2Of3[ partition ];
+        anchors[ 2 ] = s_BC7AnchorsOfSubset3Of3[ partition ];
+    }
+
+    // The anchor texels drop the high bit of their indices, which is always 0
+    uint32_t indices[ 16 ];
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        const bool isAnchor = i == anchors[ subsets[ i ] ];
+        indices[ i ] = reader.Read( isAnchor ? mode.indexBits - 1 : mode.indexBits );
+    }
+    uint32_t secondaryIndices[ 16 ] = {};
+    if ( mode.secondaryIndexBits )
+    {
+        for ( uint32_t i = 0; i < 16; ++i )
+        {
+            secondaryIndices[ i ] = reader.Read( i == 0 ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits );
+        }
+    }
+
+    // The modes with secondary indices interpolate the alpha with them, or the color when the index selection bit is set
+    const uint32_t* colorIndices = indices;
+    const uint32_t* alphaIndices = mode.secondaryIndexBits ? secondaryIndices : indices;
+    uint32_t colorIndexBits = mode.indexBits;
+    uint32_t alphaIndexBits = mode.secondaryIndexBits ? mode.secondaryIndexBits : mode.indexBits;
+    if ( indexSelection )
+    {
+        std::swap( colorIndices, alphaIndices );
+        std::swap( colorIndexBits, alphaIndexBits );
+    }
+    const uint8_t* colorWeights = GetBC7Weights( colorIndexBits );
+    const uint8_t* alphaWeights = GetBC7Weights( alphaIndexBits );
+
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        const uint32_t* endpoint0 = endpoints[ subsets[ i ] * 2 ];
+        const uint32_t* endpoint1 = endpoints[ subsets[ i ] * 2 + 1 ];
+        uint32_t rgba[ 4 ];
+        for ( uint32_t channel = 0; channel < 3; ++channel )
+        {
+            rgba[ channel ] = InterpolateBC7( endpoint0[ channel ], endpoint1[ channel ], colorWeights[ colorIndices[ i ] ] );
+        }
+        rgba[ 3 ] = InterpolateBC7( endpoint0[ 3 ], endpoint1[ 3 ], alphaWeights[ alphaIndices[ i ] ] );
+
+        // The rotation swaps the alpha with one of the colors
+        if ( rotation != 0 )
+        {
+            std::swap( rgba[ 3 ], rgba[ rotation - 1 ] );
+        }
+        texels[ i ] = PackTexel( rgba[ 0 ], rgba[ 1 ], rgba[ 2 ], rgba[ 3 ] );
+    }
+}
+
+void DecodeTextureBlock( ETextureFormat format, const uint8_t* block, uint32_t* texels )
+{
+    switch ( format )
+    {
+    case ETextureFormat::eBC1:
+        DecodeColorBlock( block, false, texels );
+        break;
+    case ETextureFormat::eBC3:
+        DecodeColorBlock( block + 8, true, texels );
+        DecodeAlphaBlock( block, texels );
+        break;
+    case ETextureFormat::eBC7:
+        DecodeBC7Block( block, texels );
+        break;
+    default:
+        assert( false );
+        break;
+    }
+}
+
+static inline uint32_t PackColor565( const uint32_t* rgb )
+{
+    return ( ( rgb[ 0 ] * 31 + 127 ) / 255 ) << 11 | ( ( rgb[ 1 ] * 63 + 127 ) / 255 ) << 5 | ( rgb[ 2 ] * 31 + 127 ) / 255;
+}
+
+static inline uint32_t ColorDistance( uint32_t texel0, uint32_t texel1 )
+{
+    uint32_t distance = 0;
+    for ( uint32_t shift = 0; shift < 24; shift += 8 )
+    {
+        const int32_t delta = int32_t( texel0 >> shift & 0xFF ) - int32_t( texel1 >> shift & 0xFF );
+        distance += uint32_t( delta * delta );
+    }
+    return distance;
+}
+
+// Encodes the colors of the texels of a block between the corners of their bounding box. The 3 colors mode is used when
+// punchThrough is set and some texels have an alpha below 128, they get the transparent black index
+static void EncodeColorBlock( const uint32_t* texels, bool punchThrough, uint8_t* block )
+{
+    uint32_t minRgb[ 3 ] = { 255, 255, 255 }, maxRgb[ 3 ] = { 0, 0, 0 };
+    bool hasTransparentTexels = false;
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        if ( punchThrough && ( texels[ i ] >> 24 ) < 128 )
+        {
+            hasTransparentTexels = true;
+            continue;
+        }
+        for ( uint32_t channel = 0; channel < 3; ++channel )
+        {
+            const uint32_t value = texels[ i ] >> ( 16 - channel * 8 ) & 0xFF;
+            minRgb[ channel ] = std::min( minRgb[ channel ], value );
+            maxRgb[ channel ] = std::max( maxRgb[ channel ], value );
+        }
+    }
+    if ( minRgb[ 0 ] > maxRgb[ 0 ] )
+    {
+        minRgb[ 0 ] = minRgb[ 1 ] = minRgb[ 2 ] = maxRgb[ 0 ] = maxRgb[ 1 ] = maxRgb[ 2 ] = 0;
+    }
+
+    // The endpoints take the diagonal of the box the colors lie along, a channel decreasing while the widest one increases
+    // has its bounds swapped
+    uint32_t widestChannel = 0;
+    for ( uint32_t channel = 1; channel < 3; ++channel )
+    {
+        if ( maxRgb[ channel ] - minRgb[ channel ] > maxRgb[ widestChannel ] - minRgb[ widestChannel ] )
+        {
+            widestChannel = channel;
+        }
+    }
+    int32_t covariances[ 3 ] = {};
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        if ( punchThrough && ( texels[ i ] >> 24 ) < 128 )
+        {
+            continue;
+        }
+        const int32_t widestDelta = int32_t( texels[ i ] >> ( 16 - widestChannel * 8 ) & 0xFF ) * 2 - int32_t( minRgb[ widestChannel ] + maxRgb[ widestChannel ] );
+        for ( uint32_t channel = 0; channel < 3; ++channel )
+        {
+            covariances[ channel ] += widestDelta * ( int32_t( texels[ i ] >> ( 16 - channel * 8 ) & 0xFF ) * 2 - int32_t( minRgb[ channel ] + maxRgb[ channel ] ) );
+        }
+    }
+    for ( uint32_t channel = 0; channel < 3; ++channel )
+    {
+        if ( covariances[ channel ] < 0 )
+        {
+            std::swap( minRgb[ channel ], maxRgb[ channel ] );
+        }
+    }
+
+    // The 4 colors mode needs color0 > color1, the 3 colors mode color0 <= color1
+    uint32_t color0 = PackColor565( maxRgb ), color1 = PackColor565( minRgb );
+    if ( hasTransparentTexels == ( color0 > color1 ) )
+    {
+        std::swap( color0, color1 );
+    }
+
+    uint32_t palette[ 4 ];
+    MakeColorPalette( color0, color1, false, palette );
+    const uint32_t colorsCount = color0 > color1 ? 4 : 3;
+    uint32_t indices = 0;
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        uint32_t bestIndex = 3;
+        if ( !( punchThrough && ( texels[ i ] >> 24 ) < 128 ) )
+        {
+            bestIndex = 0;
+            for ( uint32_t index = 1; index < colorsCount; ++index )
+            {
+                if ( ColorDistance( texels[ i ], palette[ index ] ) < ColorDistance( texels[ i ], palette[ bestIndex ] ) )
+                {
+                    bestIndex = index;
+                }
+            }
+        }
+        indices |= bestIndex << ( i * 2 );
+    }
+
+    block[ 0 ] = uint8_t( color0 );
+    block[ 1 ] = uint8_t( color0 >> 8 );
+    block[ 2 ] = uint8_t( color1 );
+    block[ 3 ] = uint8_t( color1 >> 8 );
+    memcpy( block + 4, &indices, 4 );
+}
+
+static void EncodeAlphaBlock( const uint32_t* texels, uint8_t* block )
+{
+    uint32_t minAlpha = 255, maxAlpha = 0;
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        minAlpha = std::min( minAlpha, texels[ i ] >> 24 );
+        maxAlpha = std::max( maxAlpha, texels[ i ] >> 24 );
+    }
+
+    // alpha0 > alpha1 selects the 8 alphas mode, equal alphas only need the first index
+    uint32_t palette[ 8 ];
+    MakeAlphaPalette( maxAlpha, minAlpha, palette );
+    const uint32_t alphasCount = maxAlpha > minAlpha ? 8 : 1;
+    uint64_t indices = 0;
+    for ( uint32_t i = 0; i < 16; ++i )
+    {
+        const int32_t alpha = int32_t( texels[ i ] >> 24 );
+        uint32_t bestIndex = 0;
+        for ( uint32_t index = 1; index < alphasCount; ++index )
+        {
+            if ( std::abs( alpha - int32_t( palette[ index ] ) ) < std::abs( alpha - int32_t( palette[ bestIndex ] ) ) )
+            {
+                bestIndex = index;
+            }
+        }
+        indices |= (uint64_t)bestIndex << ( i * 3 );
+    }
+
+    block[ 0 ] = uint8_t( maxAlpha );
+    block[ 1 ] = uint8_t( minAlpha );
+    for ( uint32_t i = 0; i < 6; ++i )
+    {
+        block[ 2 + i ] = uint8_t( indices >> ( i * 8 ) );
+    }
+}
+
+SImage Rasterizer::CompressImage( const SImage& image, ETextureFormat format, uint8_t* bits )
+{
+    assert( image.m_Layout == ETextureLayout::eLinear && image.m_Format == ETextureFormat::eB8G8R8A8 );
+    assert( format == ETextureFormat::eBC1 || format == ETextureFormat::eBC3 );
+    const uint32_t* srcTexels = (const uint32_t*)image.m_Bits;
+    uint8_t* block = bits;
+    for ( uint32_t level = 0; level < std::max( image.m_MipLevelsCount, 1u ); ++level )
+    {
+        // The texels padding the blocks repeat the last row and column
+        const uint32_t width = std::max( image.m_Width >> level, 1u ), height = std::max( image.m_Height >> level, 1u );
+        for ( uint32_t blockY = 0; blockY < height; blockY += 4 )
+        {
+            for ( uint32_t blockX = 0; blockX < width; blockX += 4 )
+            {
+                uint32_t texels[ 16 ];
+                for ( uint32_t i = 0; i < 16; ++i )
+                {
+                    const uint32_t x = std::min( blockX + ( i & 3 ), width - 1 ), y = std::min( blockY + ( i >> 2 ), height - 1 );
+                    texels[ i ] = srcTexels[ y * width + x ];
+                }
+
+                if ( format == ETextureFormat::eBC3 )
+                {
+                    EncodeAlphaBlock( texels, block );
+                    EncodeColorBlock( texels, false, block + 8 );
+                }
+                else
+                {
+                    EncodeColorBlock( texels, true, block );
+                }
+                block += GetBlockByteSize( format );
+            }
+        }
+        srcTexels += width * height;
+    }
+
+    SImage compressedImage = image;
+    compressedImage.m_Bits = bits;
+    compressedImage.m_Format = format;
+    return compressedImage;
+}
+
+SImage Rasterizer::DecompressImage( const SImage& image, uint8_t* bits )
+{
+    assert( IsBlockCompressed( image.m_Format ) );
+    const uint8_t* block = image.m_Bits;
+    uint32_t* dstTexels = (uint32_t*)bits;
+    for ( uint32_t level = 0; level < std::max( image.m_MipLevelsCount, 1u ); ++level )
+    {
+        // The texels padding the blocks are dropped
+        const uint32_t width = std::max( image.m_Width >> level, 1u ), height = std::max( image.m_Height >> level, 1u );
+        for ( uint32_t blockY = 0; blockY < height; blockY += 4 )
+        {
+            for ( uint32_t blockX = 0; blockX < width; blockX += 4 )
+            {
+                uint32_t texels[ 16 ] = {};
+                DecodeTextureBlock( image.m_Format, block, texels );
+                for ( uint32_t i = 0; i < 16; ++i )
+                {
+                    const uint32_t x = blockX + ( i & 3 ), y = blockY + ( i >> 2 );
+                    if ( x < width && y < height )
+                    {
+                        dstTexels[ y * width + x ] = texels[ i ];
+                    }
+                }
+                block += GetBlockByteSize( image.m_Format );
+            }
+        }
+        dstTexels += width * height;
+    }
+
+    SImage decompressedImage = image;
+    decompressedImage.m_Bits = bits;
+    decompressedImage.m_Format = ETextureFormat::eB8G8R8A8;
+    return decompressedImage;
+}
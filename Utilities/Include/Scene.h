@@ -57,6 +57,7 @@ struct SSceneImage
 {
     uint32_t m_Width = 0;
     uint32_t m_Height = 0;
+    uint32_t m_MipLevelsCount = 1; // The mip levels follow the first one in m_Data
     uint8_t* m_Data = nullptr;
 };
 
@@ -1,6 +1,7 @@
 #include "UtilitiesPCH.h"
 #include "SceneLoader.h"
 #include "Scene.h"
+#include "Rasterizer.h"
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -68,8 +69,14 @@ bool DecodeImageFromMemory( const uint8_t* data, uint32_t byteSize, SSceneImage*
 
     image->m_Width = width;
     image->m_Height = height;
-    image->m_Data = (uint8_t*)malloc( width * height * 4 );
-    return SUCCEEDED( convertedFrame->CopyPixels( nullptr, width * 4, width * height * 4, (BYTE*)image->m_Data ) );
+    image->m_MipLevelsCount = Rasterizer::GetMipLevelsCount( width, height );
+    image->m_Data = (uint8_t*)malloc( Rasterizer::GetImageByteSize( width, height, image->m_MipLevelsCount ) );
+    if ( FAILED( convertedFrame->CopyPixels( nullptr, width * 4, width * height * 4, (BYTE*)image->m_Data ) ) )
+    {
+        return false;
+    }
+    Rasterizer::GenerateMips( { image->m_Data, width, height, image->m_MipLevelsCount } );
+    return true;
 }
 
 static void GetStream( const tinygltf::Model& model, const tinygltf::Accessor& accessor, SSceneStream* stream, uint32_t defaultStride )
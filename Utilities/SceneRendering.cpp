@@ -47,6 +47,9 @@ inline static Rasterizer::SImage TranslateSceneImage( const CScene& scene, int32
         out.m_Bits = image.m_Data;
         out.m_Width = image.m_Width;
         out.m_Height = image.m_Height;
+        out.m_MipLevelsCount = image.m_MipLevelsCount;
+        out.m_Layout = Rasterizer::ETextureLayout::eLinear;
+        out.m_Format = Rasterizer::ETextureFormat::eB8G8R8A8;
     }
     else
     {